@@ -60,6 +60,7 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 LOCAL_SRC_FILES := $(call all-c-files-under, $(HALIMPL)) \
     $(call all-cpp-files-under, $(HALIMPL)) \
     src/adaptation/CrcChecksum.cpp \
+    src/adaptation/NvStore.cpp \
     src//nfca_version.c
 LOCAL_SHARED_LIBRARIES := liblog libcutils libhardware_legacy libstlport
 LOCAL_MODULE_TAGS := optional
@@ -30,6 +30,7 @@
 #include "config.h"
 #include "nfc_hal_int.h"
 #include "nfc_hal_post_reset.h"
+#include "NvStore.h"
 #include <errno.h>
 #include <pthread.h>
 #include <cutils/properties.h>
@@ -230,6 +231,7 @@ int HaiTerminateLibrary ()
     ALOGD ("%s: enter", __FUNCTION__);
 
     HAL_NfcTerminate ();
+    nvStoreFlush ();
     gAndroidHalCallback = NULL;
     gAndroidHalDataCallback = NULL;
     GKI_shutdown ();
@@ -325,6 +327,7 @@ int HaiClose (const bcm2079x_dev_t* device)
     SyncEventGuard guard (gCloseCompletedEvent);
     HAL_NfcClose ();
     gCloseCompletedEvent.wait ();
+    nvStoreFlush ();
     retval = 0;
     ALOGD ("%s: exit %d", __FUNCTION__, retval);
     return retval;
@@ -25,6 +25,7 @@ extern "C"
 }
 #include "config.h"
 #include "CrcChecksum.h"
+#include "NvStore.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -35,9 +36,29 @@ extern "C"
 //directory of HAL's non-volatile storage
 static const char* default_location = "/data/nfc";
 static const char* filename_prefix = "/halStorage.bin";
+static const char* patch_record_filename = "/halPatchRecord.bin";
 static const std::string get_storage_location ();
 void delete_hal_non_volatile_store (bool forceDelete);
 void verify_hal_non_volatile_store ();
+bool read_hal_patch_record (UINT8 *p_buf, UINT16 nbytes);
+void write_hal_patch_record (const UINT8 *p_buf, UINT16 nbytes);
+void delete_hal_patch_record ();
+
+
+/*******************************************************************************
+**
+** Function         nfc_hal_nv_co_read_done
+**
+** Description      Completion of a read by the NV I/O thread.
+**
+** Returns          none
+**
+*******************************************************************************/
+static void nfc_hal_nv_co_read_done (UINT16 nbytes, BOOLEAN isOk, UINT8 block)
+{
+    ALOGD ("%s: data size=%u", __FUNCTION__, nbytes);
+    nfc_hal_nv_ci_read (nbytes, isOk ? NFC_HAL_NV_CO_OK : NFC_HAL_NV_CO_FAIL, block);
+}
 
 
 /*******************************************************************************
@@ -74,29 +95,7 @@ void nfc_hal_nv_co_read (UINT8 *p_buf, UINT16 nbytes, UINT8 block)
     snprintf (filename, sizeof(filename), "%s%u", fn.c_str(), block);
 
     ALOGD ("%s: buffer len=%u; file=%s", __FUNCTION__, nbytes, filename);
-    int fileStream = open (filename, O_RDONLY);
-    if (fileStream >= 0)
-    {
-        unsigned short checksum = 0;
-        size_t actualReadCrc = read (fileStream, &checksum, sizeof(checksum));
-        size_t actualReadData = read (fileStream, p_buf, nbytes);
-        close (fileStream);
-        if (actualReadData > 0)
-        {
-            ALOGD ("%s: data size=%u", __FUNCTION__, actualReadData);
-            nfc_hal_nv_ci_read (actualReadData, NFC_HAL_NV_CO_OK, block);
-        }
-        else
-        {
-            ALOGE ("%s: fail to read", __FUNCTION__);
-            nfc_hal_nv_ci_read (0, NFC_HAL_NV_CO_FAIL, block);
-        }
-    }
-    else
-    {
-        ALOGD ("%s: fail to open", __FUNCTION__);
-        nfc_hal_nv_ci_read (0, NFC_HAL_NV_CO_FAIL, block);
-    }
+    nvStoreRead (filename, p_buf, nbytes, block, nfc_hal_nv_co_read_done);
 }
 
 
@@ -122,7 +121,6 @@ void nfc_hal_nv_co_write (const UINT8 *p_buf, UINT16 nbytes, UINT8 block)
 {
     std::string fn = get_storage_location();
     char filename[256];
-    int fileStream = 0;
 
     fn.append (filename_prefix);
     if (fn.length() > 200)
@@ -133,29 +131,10 @@ void nfc_hal_nv_co_write (const UINT8 *p_buf, UINT16 nbytes, UINT8 block)
     snprintf (filename, sizeof(filename), "%s%u", fn.c_str(), block);
     ALOGD ("%s: bytes=%u; file=%s", __FUNCTION__, nbytes, filename);
 
-    fileStream = open (filename, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-    if (fileStream >= 0)
-    {
-        unsigned short checksum = crcChecksumCompute (p_buf, nbytes);
-        size_t actualWrittenCrc = write (fileStream, &checksum, sizeof(checksum));
-        size_t actualWrittenData = write (fileStream, p_buf, nbytes);
-        ALOGD ("%s: %d bytes written", __FUNCTION__, actualWrittenData);
-        if ((actualWrittenData == nbytes) && (actualWrittenCrc == sizeof(checksum)))
-        {
-            nfc_hal_nv_ci_write (NFC_HAL_NV_CO_OK);
-        }
-        else
-        {
-            ALOGE ("%s: fail to write", __FUNCTION__);
-            nfc_hal_nv_ci_write (NFC_HAL_NV_CO_FAIL);
-        }
-        close (fileStream);
-    }
+    if (nvStoreWrite (filename, p_buf, nbytes))
+        nfc_hal_nv_ci_write (NFC_HAL_NV_CO_OK);
     else
-    {
-        ALOGE ("%s: fail to open, error = %d", __FUNCTION__, errno);
         nfc_hal_nv_ci_write (NFC_HAL_NV_CO_FAIL);
-    }
 }
 
 
@@ -204,6 +183,7 @@ void delete_hal_non_volatile_store (bool forceDelete)
     firstTime = false;
 
     ALOGD ("%s", __FUNCTION__);
+    nvStoreFlush ();
 
     fn.append (filename_prefix);
     if (fn.length() > 200)
@@ -243,6 +223,8 @@ void verify_hal_non_volatile_store ()
     char filename[256];
     bool isValid = false;
 
+    nvStoreFlush ();
+
     fn.append (filename_prefix);
     if (fn.length() > 200)
     {
@@ -273,3 +255,106 @@ void verify_hal_non_volatile_store ()
     if (isValid == false)
         delete_hal_non_volatile_store (true);
 }
+
+
+/*******************************************************************************
+**
+** Function         read_hal_patch_record
+**
+** Description      Read the record of the last patch file the controller was
+**                  found to be running. The record is kept apart from the
+**                  NV blocks, so it survives delete_hal_non_volatile_store.
+**
+** Parameters       p_buf   - buffer to read the record into.
+**                  nbytes  - size of the record.
+**
+** Returns          True if a record of exactly nbytes with a good checksum
+**                  was read.
+**
+*******************************************************************************/
+bool read_hal_patch_record (UINT8 *p_buf, UINT16 nbytes)
+{
+    std::string fn = get_storage_location();
+    unsigned short checksum = 0;
+    UINT8 extra;
+    bool isValid = false;
+
+    fn.append (patch_record_filename);
+    int fileStream = open (fn.c_str(), O_RDONLY);
+    if (fileStream < 0)
+        return false;
+
+    if (  (read (fileStream, &checksum, sizeof(checksum)) == sizeof(checksum))
+        &&(read (fileStream, p_buf, nbytes) == nbytes)
+        &&(read (fileStream, &extra, sizeof(extra)) == 0)  )
+        isValid = (checksum == crcChecksumCompute (p_buf, nbytes));
+    close (fileStream);
+
+    if (!isValid)
+        ALOGE ("%s: ignoring bad record %s", __FUNCTION__, fn.c_str());
+    return isValid;
+}
+
+
+/*******************************************************************************
+**
+** Function         write_hal_patch_record
+**
+** Description      Save the record of the patch file the controller runs.
+**                  The record is written to a temporary file and renamed,
+**                  so a reader never sees a partial record.
+**
+** Parameters       p_buf   - record to save.
+**                  nbytes  - size of the record.
+**
+** Returns          none
+**
+*******************************************************************************/
+void write_hal_patch_record (const UINT8 *p_buf, UINT16 nbytes)
+{
+    std::string fn = get_storage_location();
+    std::string tmp;
+    bool isWritten = false;
+
+    fn.append (patch_record_filename);
+    tmp = fn + ".tmp";
+
+    int fileStream = open (tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fileStream < 0)
+    {
+        ALOGE ("%s: fail to open, error = %d", __FUNCTION__, errno);
+        return;
+    }
+
+    unsigned short checksum = crcChecksumCompute (p_buf, nbytes);
+    isWritten = (write (fileStream, &checksum, sizeof(checksum)) == sizeof(checksum))
+             && (write (fileStream, p_buf, nbytes) == nbytes);
+    close (fileStream);
+
+    if (!isWritten || (rename (tmp.c_str(), fn.c_str()) != 0))
+    {
+        ALOGE ("%s: fail to write, error = %d", __FUNCTION__, errno);
+        remove (tmp.c_str());
+    }
+}
+
+
+/*******************************************************************************
+**
+** Function         delete_hal_patch_record
+**
+** Description      Forget the patch file the controller runs, so the next
+**                  initialization goes through the full patch version check.
+**
+** Parameters       none
+**
+** Returns          none
+**
+*******************************************************************************/
+void delete_hal_patch_record ()
+{
+    std::string fn = get_storage_location();
+
+    fn.append (patch_record_filename);
+    remove (fn.c_str());
+}
@@ -24,9 +24,16 @@ extern "C"
     #include "nfc_hal_post_reset.h"
 }
 #include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <cutils/properties.h>
 #include "spdhelper.h"
 #include "StartupConfig.h"
+#include "CrcChecksum.h"
 
 #define LOG_TAG "NfcNciHal"
 
@@ -38,7 +45,37 @@ extern "C"
 static char sPrePatchFn[MAX_BUFFER+1];
 static char sPatchFn[MAX_BUFFER+1];
 static void * sPrmBuf = NULL;
+static size_t sPrmBufLen = 0;
 static void * sI2cFixPrmBuf = NULL;
+static size_t sI2cFixPrmBufLen = 0;
+
+/* Record of the patch file the controller was last found to be running,
+** kept in the HAL's storage location (see NonVolatileStore.cpp) */
+#define PATCH_RECORD_MAGIC  0x50524d32      /* "PRM2" */
+
+/* Patchfile layout, as parsed by nfc_hal_prm_spd_check_version */
+#define PATCHFILE_HDR_LEN       8           /* project id, major, minor, RFU, patch count */
+#define PATCHFILE_DESC_LEN      8           /* power mode, patch length, RFU */
+#define PATCH_POWER_MODE_LPM    0
+#define PATCH_POWER_MODE_FPM    1
+typedef struct
+{
+    UINT32 magic;
+    UINT32 chipid;
+    UINT32 file_ino;
+    UINT32 file_size;
+    UINT32 file_mtime;
+    UINT32 file_mtime_nsec;
+    UINT16 file_crc;
+    UINT16 project_id;                  /* version of the patches in the file */
+    UINT16 ver_major;
+    UINT16 ver_minor;
+    UINT32 patch_mask;                  /* power modes of the patches in the file */
+} tPATCH_RECORD;
+static tPATCH_RECORD sPatchRecord;      /* describes the file being downloaded */
+extern bool read_hal_patch_record (UINT8 *p_buf, UINT16 nbytes);
+extern void write_hal_patch_record (const UINT8 *p_buf, UINT16 nbytes);
+extern void delete_hal_patch_record ();
 
 #define CONFIG_MAX_LEN 256
 static UINT8 sConfig [CONFIG_MAX_LEN];
@@ -107,21 +144,226 @@ tNFC_POST_RESET_CB nfc_post_reset_cb =
 
 /*******************************************************************************
 **
-** Function         getFileLength
+** Function         getTimeMs
 **
-** Description      return the size of a file
+** Description      read the monotonic clock, for timing patch file handling
 **
-** Returns          file size in number of bytes
+** Returns          time in ms
 **
 *******************************************************************************/
-static long getFileLength(FILE* fp)
+static UINT32 getTimeMs()
 {
-    long sz;
-    fseek(fp, 0L, SEEK_END);
-    sz = ftell(fp);
-    fseek(fp, 0L, SEEK_SET);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT32)now.tv_sec * 1000 + (UINT32)(now.tv_nsec / 1000000);
+}
 
-    return (sz > 0) ? sz : 0;
+/*******************************************************************************
+**
+** Function         mapPatchFile
+**
+** Description      map a patch file read-only into memory. The HAL reads
+**                  the segments straight out of the mapping, so it must stay
+**                  mapped until the download completes.
+**
+** Returns          pointer to the file contents, or NULL if the file cannot
+**                  be opened or mapped; *pLen is set to the file size
+**
+*******************************************************************************/
+static void* mapPatchFile(const char* pFilename, size_t* pLen)
+{
+    struct stat st;
+    void* pBuf = NULL;
+    UINT32 startMs = getTimeMs();
+    int fd = open(pFilename, O_RDONLY);
+
+    *pLen = 0;
+    if (fd < 0)
+        return NULL;
+
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+    {
+        pBuf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pBuf == MAP_FAILED)
+        {
+            ALOGE("%s: mmap %s failed, errno=%d", __FUNCTION__, pFilename, errno);
+            pBuf = NULL;
+        }
+        else
+        {
+            *pLen = st.st_size;
+            madvise(pBuf, *pLen, MADV_WILLNEED);
+        }
+    }
+    close(fd);
+
+    ALOGD("%s: %s (%zu bytes) mapped in %u ms", __FUNCTION__, pFilename, *pLen, (unsigned) (getTimeMs() - startMs));
+    return pBuf;
+}
+
+/*******************************************************************************
+**
+** Function         unmapPatchFiles
+**
+** Description      release the patch file mappings once the HAL is done
+**                  with them
+**
+** Returns          none
+**
+*******************************************************************************/
+static void unmapPatchFiles()
+{
+    if (sI2cFixPrmBuf != NULL)
+    {
+        /* Make sure the HAL does not keep a pointer into the mapping */
+        HAL_NfcPrmSetI2cPatch(NULL, 0, 0);
+        munmap(sI2cFixPrmBuf, sI2cFixPrmBufLen);
+        sI2cFixPrmBuf = NULL;
+        sI2cFixPrmBufLen = 0;
+    }
+    if (sPrmBuf != NULL)
+    {
+        munmap(sPrmBuf, sPrmBufLen);
+        sPrmBuf = NULL;
+        sPrmBufLen = 0;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         isPatchInNvm
+**
+** Description      check whether the patches described by a record are the
+**                  ones the controller reported in NVM; this is the test
+**                  nfc_hal_prm_spd_check_version uses to skip a download
+**
+** Returns          TRUE if the controller already runs the patches
+**
+*******************************************************************************/
+static BOOLEAN isPatchInNvm(const tPATCH_RECORD& rec)
+{
+    UINT32 nvmMask = 0;
+
+    if (nfc_hal_cb.nvm_cb.flags & NFC_HAL_NVM_FLAGS_NO_NVM)
+        return FALSE;   /* patch is in RAM only and must be downloaded every time */
+
+    if (nfc_hal_cb.nvm_cb.lpm_size && !(nfc_hal_cb.nvm_cb.flags & NFC_HAL_NVM_FLAGS_LPM_BAD))
+        nvmMask |= (1 << PATCH_POWER_MODE_LPM);
+    if (nfc_hal_cb.nvm_cb.fpm_size && !(nfc_hal_cb.nvm_cb.flags & NFC_HAL_NVM_FLAGS_FPM_BAD))
+        nvmMask |= (1 << PATCH_POWER_MODE_FPM);
+
+    return (nfc_hal_cb.nvm_cb.project_id != 0)
+        && (nfc_hal_cb.nvm_cb.project_id == rec.project_id)
+        && (nfc_hal_cb.nvm_cb.ver_major == rec.ver_major)
+        && (nfc_hal_cb.nvm_cb.ver_minor == rec.ver_minor)
+        && ((nvmMask | rec.patch_mask) == nvmMask);
+}
+
+/*******************************************************************************
+**
+** Function         isPatchCurrent
+**
+** Description      check the saved patch record against the patch file and
+**                  the controller, without opening the patch file
+**
+** Returns          TRUE if the controller already runs the patch file, so
+**                  the download can be skipped
+**
+*******************************************************************************/
+static BOOLEAN isPatchCurrent(UINT32 chipid)
+{
+    tPATCH_RECORD rec;
+    struct stat st;
+    UINT8 force = 0;
+
+    if (GetNumValue(NAME_SPD_FORCE_PATCH_CHECK, &force, sizeof(force)) && (force != 0))
+    {
+        ALOGD("%s: forced patch check", __FUNCTION__);
+        delete_hal_patch_record();
+        return FALSE;
+    }
+
+    if (  (stat(sPatchFn, &st) != 0)
+        ||!read_hal_patch_record((UINT8*)&rec, sizeof(rec))
+        ||(rec.magic != PATCH_RECORD_MAGIC)
+        ||(rec.chipid != chipid)
+        ||(rec.file_ino != (UINT32)st.st_ino)
+        ||(rec.file_size != (UINT32)st.st_size)
+        ||(rec.file_mtime != (UINT32)st.st_mtim.tv_sec)
+        ||(rec.file_mtime_nsec != (UINT32)st.st_mtim.tv_nsec)  )
+        return FALSE;
+
+    return isPatchInNvm(rec);
+}
+
+/*******************************************************************************
+**
+** Function         preparePatchRecord
+**
+** Description      describe the mapped patch file in sPatchRecord, to be
+**                  saved once the controller is known to run it
+**
+** Returns          none
+**
+*******************************************************************************/
+static void preparePatchRecord(UINT32 chipid)
+{
+    const UINT8* p = (const UINT8*)sPrmBuf;
+    struct stat st;
+    UINT8 count, i;
+
+    memset(&sPatchRecord, 0, sizeof(sPatchRecord));
+    if ((stat(sPatchFn, &st) != 0) || (sPrmBufLen < PATCHFILE_HDR_LEN))
+        return;
+
+    /* Patchfile header: project id, major and minor version, RFU, patch count */
+    STREAM_TO_UINT16(sPatchRecord.project_id, p);
+    STREAM_TO_UINT16(sPatchRecord.ver_major, p);
+    STREAM_TO_UINT16(sPatchRecord.ver_minor, p);
+    p++;
+    STREAM_TO_UINT8(count, p);
+
+    /* One descriptor per patch, starting with its power mode */
+    if ((count > NFC_HAL_PRM_MAX_PATCH_COUNT) || (sPrmBufLen < PATCHFILE_HDR_LEN + count * PATCHFILE_DESC_LEN))
+        return;
+    for (i = 0; i < count; i++, p += PATCHFILE_DESC_LEN)
+        sPatchRecord.patch_mask |= ((UINT32)1 << p[0]);
+
+    sPatchRecord.chipid     = chipid;
+    sPatchRecord.file_ino        = (UINT32)st.st_ino;
+    sPatchRecord.file_size       = (UINT32)st.st_size;
+    sPatchRecord.file_mtime      = (UINT32)st.st_mtim.tv_sec;
+    sPatchRecord.file_mtime_nsec = (UINT32)st.st_mtim.tv_nsec;
+    sPatchRecord.file_crc        = crcChecksumCompute((const unsigned char*)sPrmBuf, sPrmBufLen);
+    sPatchRecord.magic           = PATCH_RECORD_MAGIC;
+}
+
+/*******************************************************************************
+**
+** Function         isPatchContentCurrent
+**
+** Description      the patch file was touched since the record was saved;
+**                  if its content is unchanged, the record still holds
+**
+** Returns          TRUE if the controller already runs the patch file
+**
+*******************************************************************************/
+static BOOLEAN isPatchContentCurrent()
+{
+    tPATCH_RECORD rec;
+
+    if (  (sPatchRecord.magic != PATCH_RECORD_MAGIC)
+        ||!read_hal_patch_record((UINT8*)&rec, sizeof(rec))
+        ||(rec.magic != PATCH_RECORD_MAGIC)
+        ||(rec.chipid != sPatchRecord.chipid)
+        ||(rec.file_size != sPatchRecord.file_size)
+        ||(rec.file_crc != sPatchRecord.file_crc)
+        ||!isPatchInNvm(rec)  )
+        return FALSE;
+
+    /* Refresh the file time, so the next check does not need to open the file */
+    write_hal_patch_record((const UINT8*)&sPatchRecord, sizeof(sPatchRecord));
+    return TRUE;
 }
 
 /*******************************************************************************
@@ -206,10 +448,12 @@ static void continueAfterSetSnoozeMode(tHAL_NFC_STATUS status)
 static void postDownloadPatchram(tHAL_NFC_STATUS status)
 {
     ALOGD("%s: status=%i", __FUNCTION__, status);
+    unmapPatchFiles();
     GetStrValue (NAME_SNOOZE_MODE_CFG, (char*)&gSnoozeModeCfg, sizeof(gSnoozeModeCfg));
     if (status != HAL_NFC_STATUS_OK)
     {
         ALOGE("%s: Patch download failed", __FUNCTION__);
+        delete_hal_patch_record();
         if (status == HAL_NFC_STATUS_REFUSED)
         {
             SpdHelper::setPatchAsBad();
@@ -272,6 +516,9 @@ void prmCallback(UINT8 event)
         break;
 
     case NFC_HAL_PRM_COMPLETE_EVT:
+        /* Controller now runs the patch file (or already did) */
+        if (sPatchRecord.magic == PATCH_RECORD_MAGIC)
+            write_hal_patch_record((const UINT8*)&sPatchRecord, sizeof(sPatchRecord));
         postDownloadPatchram(HAL_NFC_STATUS_OK);
         break;
 
@@ -415,75 +662,61 @@ static void StartPatchDownload(UINT32 chipid)
     findPatchramFile(FW_PATCH, sPatchFn, sizeof(sPatchFn));
     findPatchramFile(FW_PRE_PATCH, sPrePatchFn, sizeof(sPatchFn));
 
+    /* Release the files mapped for a previous download attempt */
+    unmapPatchFiles();
+    sPatchRecord.magic = 0;
+
+    /* Skip both patch files if the controller already runs this patch */
+    if ((sPatchFn[0] != '\0') && isPatchCurrent(chipid))
+    {
+        ALOGD("%s: controller already runs %s; skipping patch download", __FUNCTION__, sPatchFn);
+        postDownloadPatchram(HAL_NFC_STATUS_OK);
+        ALOGD ("%s: exit", __FUNCTION__);
+        return;
+    }
+
     {
-        FILE *fd;
         /* If an I2C fix patch file was specified, then tell the stack about it */
         if (sPrePatchFn[0] != '\0')
         {
-            if ((fd = fopen(sPrePatchFn, "rb")) != NULL)
+            if ((sI2cFixPrmBuf = mapPatchFile(sPrePatchFn, &sI2cFixPrmBufLen)) != NULL)
             {
-                UINT32 lenPrmBuffer = getFileLength(fd);
-
-                if ((sI2cFixPrmBuf = malloc(lenPrmBuffer)) != NULL)
-                {
-                    size_t actualLen = fread(sI2cFixPrmBuf, 1, lenPrmBuffer, fd);
-                    if (actualLen == lenPrmBuffer)
-                    {
-                        ALOGD("%s Setting I2C fix to %s (size: %lu)", __FUNCTION__, sPrePatchFn, lenPrmBuffer);
-                        HAL_NfcPrmSetI2cPatch((UINT8*)sI2cFixPrmBuf, (UINT16)lenPrmBuffer, 0);
-                    }
-                    else
-                        ALOGE("%s fail reading i2c fix; actual len=%u; expected len=%lu", __FUNCTION__, actualLen, lenPrmBuffer);
-                }
-                else
-                {
-                    ALOGE("%s Unable to get buffer to i2c fix (%lu bytes)", __FUNCTION__, lenPrmBuffer);
-                }
-
-                fclose(fd);
+                ALOGD("%s Setting I2C fix to %s (size: %zu)", __FUNCTION__, sPrePatchFn, sI2cFixPrmBufLen);
+                HAL_NfcPrmSetI2cPatch((UINT8*)sI2cFixPrmBuf, (UINT16)sI2cFixPrmBufLen, 0);
             }
             else
             {
-                ALOGE("%s Unable to open i2c fix patchfile %s", __FUNCTION__, sPrePatchFn);
+                ALOGE("%s Unable to map i2c fix patchfile %s", __FUNCTION__, sPrePatchFn);
             }
         }
     }
 
     {
-        FILE *fd;
-
         /* If a patch file was specified, then download it now */
         if (sPatchFn[0] != '\0')
         {
             UINT32 bDownloadStarted = false;
 
-            /* open patchfile, read it into a buffer */
-            if ((fd = fopen(sPatchFn, "rb")) != NULL)
+            /* map patchfile; the HAL sends its segments straight from the mapping */
+            if ((sPrmBuf = mapPatchFile(sPatchFn, &sPrmBufLen)) != NULL)
             {
-                UINT32 lenPrmBuffer = getFileLength(fd);
-                ALOGD("%s Downloading patchfile %s (size: %lu) format=%u", __FUNCTION__, sPatchFn, lenPrmBuffer, NFC_HAL_PRM_FORMAT_NCD);
-                if ((sPrmBuf = malloc(lenPrmBuffer)) != NULL)
+                ALOGD("%s Downloading patchfile %s (size: %zu) format=%u", __FUNCTION__, sPatchFn, sPrmBufLen, NFC_HAL_PRM_FORMAT_NCD);
+                preparePatchRecord(chipid);
+                if (isPatchContentCurrent())
                 {
-                    size_t actualLen = fread(sPrmBuf, 1, lenPrmBuffer, fd);
-                    if (actualLen == lenPrmBuffer)
-                    {
-                        if (!SpdHelper::isPatchBad((UINT8*)sPrmBuf, lenPrmBuffer))
-                        {
-                            /* Download patch using static memeory mode */
-                            HAL_NfcPrmDownloadStart(NFC_HAL_PRM_FORMAT_NCD, 0, (UINT8*)sPrmBuf, lenPrmBuffer, 0, prmCallback);
-                            bDownloadStarted = true;
-                        }
-                    }
-                    else
-                        ALOGE("%s fail reading patchram", __FUNCTION__);
+                    ALOGD("%s: patchfile content unchanged; skipping patch download", __FUNCTION__);
+                    postDownloadPatchram(HAL_NFC_STATUS_OK);
+                    bDownloadStarted = true;
+                }
+                else if (!SpdHelper::isPatchBad((UINT8*)sPrmBuf, sPrmBufLen))
+                {
+                    /* Download patch using static memeory mode */
+                    HAL_NfcPrmDownloadStart(NFC_HAL_PRM_FORMAT_NCD, 0, (UINT8*)sPrmBuf, sPrmBufLen, 0, prmCallback);
+                    bDownloadStarted = true;
                 }
-                else
-                    ALOGE("%s Unable to buffer to hold patchram (%lu bytes)", __FUNCTION__, lenPrmBuffer);
-
-                fclose(fd);
             }
             else
-                ALOGE("%s Unable to open patchfile %s", __FUNCTION__, sPatchFn);
+                ALOGE("%s Unable to map patchfile %s", __FUNCTION__, sPatchFn);
 
             /* If the download never got started */
             if (!bDownloadStarted)
@@ -32,6 +32,7 @@
 #include <gki_int.h>
 #include "hcidefs.h"
 #include <poll.h>
+#include <sys/uio.h>
 #include "upio.h"
 #include "bcm2079x.h"
 #include "config.h"
@@ -46,6 +47,7 @@
 #ifndef BTE_APPL_MAX_USERIAL_DEV_NAME
 #define BTE_APPL_MAX_USERIAL_DEV_NAME           (256)
 #endif
+#define USERIAL_MAX_IOV                     16  /* max buffers written with one writev() */
 extern UINT8 appl_trace_level;
 
 
@@ -56,6 +58,7 @@ int uart_port  = 0;
 int isLowSpeedTransport = 0;
 int nfc_wake_delay = 0;
 int nfc_write_delay = 0;
+int nfc_tx_coalesce = 0;    /* max bytes batched by USERIAL_WriteBuf(), 0 to write each buffer at once */
 int gPowerOnDelay = 300;
 static int gPrePowerOffDelay = 0;    // default value
 static int gPostPowerOffDelay = 0;     // default value
@@ -158,6 +161,14 @@ static UINT8 set_nfc_off_cmd[5] = {
  */
 #define MIN_BUFSIZE 259
 #define     POLL_TIMEOUT    1000
+/* read serial devices in bulk and slice complete packets out of a ring buffer */
+#ifndef USERIAL_BULK_FRAMING
+#define USERIAL_BULK_FRAMING        TRUE
+#endif
+/* size of the receive ring, must be a power of 2 and hold at least 2 full sized packets */
+#ifndef USERIAL_RX_RING_SIZE
+#define USERIAL_RX_RING_SIZE        2048
+#endif
 /* priority of the reader thread */
 #define USERIAL_READ_TRHEAD_PRIO 90
 /* time (ms) to wait before trying to allocate again a GKI buffer */
@@ -237,9 +248,9 @@ void perf_log(tPERF_DATA* t)
     if (t->lapse)
     {
         if (t->bytes)
-            ALOGD( "%s:%s, bytes=%ld, lapse=%ld (%d.%02d kbps) (bus data rate %d.%02d kbps) overhead %d(%d percent)\n",
+            ALOGD( "%s:%s, bytes=%ld (%ld per call), lapse=%ld (%d.%02d kbps) (bus data rate %d.%02d kbps) overhead %d(%d percent)\n",
                     __func__,
-                    t->label, t->bytes, t->lapse,
+                    t->label, t->bytes, t->bytes / t->count, t->lapse,
                     (int)(8 * t->bytes / t->lapse), (int)(800 * t->bytes / (t->lapse)) % 100,
                     (int)(9 * (t->bytes + t->count * t->overhead) / t->lapse), (int)(900 * (t->bytes + t->count * t->overhead) / (t->lapse)) % 100,
                     (int)(t->count * t->overhead), (int)(t->count * t->overhead * 100 / t->bytes)
@@ -518,6 +529,8 @@ static inline int is_signaled(struct pollfd* set)
 typedef unsigned char uchar;
 
 BUFFER_Q Userial_in_q;
+static BUFFER_Q Userial_out_q;      /* buffers batched by USERIAL_WriteBuf() */
+static UINT16   userial_out_len;    /* number of bytes in Userial_out_q */
 
 /*******************************************************************************
  **
@@ -596,9 +609,117 @@ UDRV_API void    USERIAL_Init(void * p_cfg)
     linux_cb.sock_power_control = -1;
     linux_cb.client_device_address = 0;
     GKI_init_q(&Userial_in_q);
+    GKI_init_q(&Userial_out_q);
+    userial_out_len = 0;
     pthread_mutex_unlock(&close_thread_mutex);
 }
 
+#if (USERIAL_BULK_FRAMING == TRUE)
+static UINT8  userial_rx_ring[USERIAL_RX_RING_SIZE];
+static UINT32 userial_rx_head;      /* total bytes read from the device */
+static UINT32 userial_rx_tail;      /* total bytes handed out as packets */
+
+#define USERIAL_RX_RING_BYTE(i)     userial_rx_ring[(i) & (USERIAL_RX_RING_SIZE - 1)]
+
+/*******************************************************************************
+ **
+ ** Function           userial_rx_fill
+ **
+ ** Description        Read as many bytes as the driver has available into the
+ **                    free space of the receive ring with a single readv().
+ **
+ ** Returns            number of bytes read or the read() result on error
+ **
+ *******************************************************************************/
+static int userial_rx_fill(int fd)
+{
+    struct iovec iov[2];
+    UINT32 pos = userial_rx_head & (USERIAL_RX_RING_SIZE - 1);
+    UINT32 space = USERIAL_RX_RING_SIZE - (userial_rx_head - userial_rx_tail);
+    int n = 1;
+    int ret;
+    clock_t t;
+
+    iov[0].iov_base = &userial_rx_ring[pos];
+    iov[0].iov_len  = space;
+    if (pos + space > USERIAL_RX_RING_SIZE)
+    {
+        iov[0].iov_len  = USERIAL_RX_RING_SIZE - pos;
+        iov[1].iov_base = userial_rx_ring;
+        iov[1].iov_len  = space - iov[0].iov_len;
+        n = 2;
+    }
+
+    t = clock();
+    ret = readv(fd, iov, n);
+    if (ret > 0)
+    {
+        perf_update(&perf_read, clock()-t, ret);
+        userial_rx_head += ret;
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ **
+ ** Function           userial_rx_frame
+ **
+ ** Description        Copy the complete NCI/BT packets at the front of the
+ **                    receive ring into pbuf, as many as fit in len bytes.
+ **                    A partial packet stays in the ring for the next read.
+ **                    Bytes that do not start a known HCIT type are dropped.
+ **
+ ** Returns            number of bytes copied into pbuf
+ **
+ *******************************************************************************/
+static int userial_rx_frame(UINT8 *pbuf, int len)
+{
+    UINT32 avail, plen, pos, first;
+    int    out = 0;
+
+    while ((avail = userial_rx_head - userial_rx_tail) > 0)
+    {
+        if (USERIAL_RX_RING_BYTE(userial_rx_tail) == HCIT_TYPE_NFC)
+        {
+            if (avail < 4)
+                break;
+            plen = USERIAL_RX_RING_BYTE(userial_rx_tail + 3) + 4;
+        }
+        else if (USERIAL_RX_RING_BYTE(userial_rx_tail) == HCIT_TYPE_EVENT)
+        {
+            if (avail < 3)
+                break;
+            plen = USERIAL_RX_RING_BYTE(userial_rx_tail + 2) + 3;
+        }
+        else
+        {
+            ALOGD( "%s: unknown HCIT type header %x, dropped\n", __func__, USERIAL_RX_RING_BYTE(userial_rx_tail));
+            userial_rx_tail++;
+            continue;
+        }
+
+        if ((avail < plen) || (out + (int) plen > len))
+            break;
+
+        pos   = userial_rx_tail & (USERIAL_RX_RING_SIZE - 1);
+        first = USERIAL_RX_RING_SIZE - pos;
+        if (first >= plen)
+            memcpy(pbuf + out, &userial_rx_ring[pos], plen);
+        else
+        {
+            memcpy(pbuf + out, &userial_rx_ring[pos], first);
+            memcpy(pbuf + out + first, userial_rx_ring, plen - first);
+        }
+        if (USERIAL_Debug_verbose)
+            scru_dump_hex(pbuf + out, NULL, plen, 0, 0);
+
+        out += plen;
+        userial_rx_tail += plen;
+    }
+    return out;
+}
+#endif
+
 /*******************************************************************************
  **
  ** Function           my_read
@@ -619,10 +740,21 @@ int my_read(int fd, uchar *pbuf, int len)
     int count = 0;
     int offset = 0;
     clock_t t1, t2;
+    BOOLEAN framing = FALSE;
 
     if (!isLowSpeedTransport && _timeout != POLL_TIMEOUT)
         ALOGD_IF((appl_trace_level>=BT_TRACE_LEVEL_DEBUG), "%s: enter, pbuf=%lx, len = %d\n", __func__, (unsigned long)pbuf, len);
-    memset(pbuf, 0, len);
+#if (USERIAL_BULK_FRAMING == TRUE)
+    if (bSerialPortDevice && !isLowSpeedTransport && len >= MIN_BUFSIZE)
+    {
+        /* packets left over from the previous read are returned without polling */
+        if ((ret = userial_rx_frame(pbuf, len)) > 0)
+            return ret;
+        framing = TRUE;
+    }
+#endif
+    if (!framing)
+        memset(pbuf, 0, len);
     /* need to use select in order to avoid collistion between read and close on same fd */
     /* Initialize the input set */
     fds[0].fd = fd;
@@ -655,6 +787,19 @@ int my_read(int fd, uchar *pbuf, int len)
         reset_signal();
         return -1;
     }
+#if (USERIAL_BULK_FRAMING == TRUE)
+    if (framing)
+    {
+        ret = userial_rx_fill(fd);
+        if (ret > 0)
+        {
+            /* nothing to return until the rest of a partial packet arrives */
+            if ((ret = userial_rx_frame(pbuf, len)) == 0)
+                ret = -EAGAIN;
+        }
+        goto done;
+    }
+#endif
     if (!bSerialPortDevice || len < MIN_BUFSIZE)
         count = len;
     else
@@ -768,6 +913,9 @@ UINT32 userial_read_thread(UINT32 arg)
 
     ALOGD( "start userial_read_thread, id=%lx", worker_thread1);
     _timeout = POLL_TIMEOUT;
+#if (USERIAL_BULK_FRAMING == TRUE)
+    userial_rx_head = userial_rx_tail = 0;
+#endif
 
     for (;linux_cb.sock > 0;)
     {
@@ -986,6 +1134,8 @@ UDRV_API void USERIAL_Open(tUSERIAL_PORT port, tUSERIAL_OPEN_CFG *p_cfg, tUSERIA
         nfc_write_delay = num;
     if ( GetNumValue ( NAME_PERF_MEASURE_FREQ, &num, sizeof ( num ) ) )
         perf_log_every_count = num;
+    if ( GetNumValue ( NAME_NFC_TX_COALESCE, &num, sizeof ( num ) ) )
+        nfc_tx_coalesce = num;
     if ( GetNumValue ( NAME_POWER_ON_DELAY, &num, sizeof ( num ) ) )
         gPowerOnDelay = num;
     if ( GetNumValue ( NAME_PRE_POWER_OFF_DELAY, &num, sizeof ( num ) ) )
@@ -1206,16 +1356,117 @@ UDRV_API void    USERIAL_ReadBuf(tUSERIAL_PORT port, BT_HDR **p_buf)
 
 }
 
+/*******************************************************************************
+**
+** Function           userial_writev
+**
+** Description        Write the buffers batched by USERIAL_WriteBuf() followed
+**                    by p_data (if any) to the transport, using one writev()
+**                    call for up to USERIAL_MAX_IOV buffers. The write delay
+**                    is applied once to the whole batch.
+**
+**                    NOTE: called with close_thread_mutex held.
+**
+** Returns            Number of bytes of p_data written to the transport.
+**
+*******************************************************************************/
+static UINT16 userial_writev(UINT8 *p_data, UINT16 len)
+{
+    struct iovec    iov[USERIAL_MAX_IOV];
+    BT_HDR          *p_buf;
+    BOOLEAN         with_data;
+    int             iovcnt, first, num_buf;
+    int             ret, total, remaining;
+    UINT16          data_written = 0;
+    clock_t         t;
+
+    do
+    {
+        /* gather the batched buffers, then the caller's data */
+        iovcnt = 0;
+        total = 0;
+        for (p_buf = (BT_HDR *) GKI_getfirst(&Userial_out_q);
+             p_buf != NULL && iovcnt < USERIAL_MAX_IOV - 1;
+             p_buf = (BT_HDR *) GKI_getnext(p_buf))
+        {
+            iov[iovcnt].iov_base = (UINT8 *) (p_buf + 1) + p_buf->offset;
+            iov[iovcnt].iov_len  = p_buf->len;
+            total += p_buf->len;
+            iovcnt++;
+        }
+        num_buf = iovcnt;
+
+        with_data = (p_buf == NULL && len != 0);
+        if (with_data)
+        {
+            iov[iovcnt].iov_base = p_data;
+            iov[iovcnt].iov_len  = len;
+            total += len;
+            iovcnt++;
+        }
+
+        remaining = total;
+        if (iovcnt && linux_cb.sock != -1)
+        {
+            doWriteDelay();
+            t = clock();
+            first = 0;
+            while (remaining != 0)
+            {
+                ret = writev(linux_cb.sock, &iov[first], iovcnt - first);
+                if (ret < 0)
+                {
+                    ALOGE("USERIAL_Write len = %d, ret = %d, errno = %d", remaining, ret, errno);
+                    break;
+                }
+                ALOGD_IF((appl_trace_level>=BT_TRACE_LEVEL_DEBUG), "USERIAL_Write len = %d, ret = %d", remaining, ret);
+                remaining -= ret;
+
+                /* skip the part already written after a partial write */
+                while (ret > 0 && (size_t) ret >= iov[first].iov_len)
+                    ret -= iov[first++].iov_len;
+                if (ret > 0)
+                {
+                    iov[first].iov_base = (UINT8 *) iov[first].iov_base + ret;
+                    iov[first].iov_len -= ret;
+                }
+            }
+            perf_update(&perf_write, clock() - t, total - remaining);
+
+            /* register a delay for next write */
+            setWriteDelay((total - remaining) * nfc_write_delay / 1000);
+        }
+
+        /* batched buffers are consumed, or dropped if the transport failed */
+        while (num_buf--)
+        {
+            p_buf = (BT_HDR *) GKI_dequeue(&Userial_out_q);
+            userial_out_len -= p_buf->len;
+            GKI_freebuf(p_buf);
+        }
+
+        if (with_data && remaining < len)
+            data_written = (UINT16) (len - remaining);
+
+    } while (remaining == 0 && !with_data && (Userial_out_q.count || len) && linux_cb.sock != -1);
+
+    return data_written;
+}
+
 /*******************************************************************************
 **
 ** Function           USERIAL_WriteBuf
 **
-** Description        Write data to a serial port using a GKI buffer.
+** Description        Write data to a serial port using a GKI buffer. If
+**                    NFC_TX_COALESCE is configured, the buffer is batched with
+**                    the following ones and written by USERIAL_WriteFlush(),
+**                    by the next USERIAL_Write() or once NFC_TX_COALESCE bytes
+**                    are pending, whichever comes first.
 **
 ** Output Parameter   None
 **
 ** Returns            TRUE  if buffer accepted for write.
-**                    FALSE if there is already a buffer being processed.
+**                    FALSE if the port is closed.
 **
 ** Comments           The buffer will be freed by the serial driver.  Therefore,
 **                    the application calling this function must not free the
@@ -1225,14 +1476,57 @@ UDRV_API void    USERIAL_ReadBuf(tUSERIAL_PORT port, BT_HDR **p_buf)
 
 UDRV_API BOOLEAN USERIAL_WriteBuf(tUSERIAL_PORT port, BT_HDR *p_buf)
 {
-    return FALSE;
+    ALOGD_IF((appl_trace_level>=BT_TRACE_LEVEL_DEBUG), "USERIAL_WriteBuf: (%d bytes)", p_buf->len);
+    pthread_mutex_lock(&close_thread_mutex);
+
+    if (linux_cb.sock == -1)
+    {
+        pthread_mutex_unlock(&close_thread_mutex);
+        GKI_freebuf(p_buf);
+        return FALSE;
+    }
+
+    GKI_enqueue(&Userial_out_q, p_buf);
+    userial_out_len += p_buf->len;
+
+    if (  (userial_out_len >= nfc_tx_coalesce)
+        ||(Userial_out_q.count >= USERIAL_MAX_IOV - 1)  )
+    {
+        userial_writev(NULL, 0);
+    }
+
+    pthread_mutex_unlock(&close_thread_mutex);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function           USERIAL_WriteFlush
+**
+** Description        Write the buffers batched by USERIAL_WriteBuf().
+**
+** Output Parameter   None
+**
+** Returns            None
+**
+*******************************************************************************/
+
+UDRV_API void USERIAL_WriteFlush(tUSERIAL_PORT port)
+{
+    if (Userial_out_q.count == 0)
+        return;
+
+    pthread_mutex_lock(&close_thread_mutex);
+    userial_writev(NULL, 0);
+    pthread_mutex_unlock(&close_thread_mutex);
 }
 
 /*******************************************************************************
 **
 ** Function           USERIAL_Write
 **
-** Description        Write data to a serial port using a byte buffer.
+** Description        Write data to a serial port using a byte buffer. Buffers
+**                    batched by USERIAL_WriteBuf() are written first.
 **
 ** Output Parameter   None
 **
@@ -1242,39 +1536,16 @@ UDRV_API BOOLEAN USERIAL_WriteBuf(tUSERIAL_PORT port, BT_HDR *p_buf)
 *******************************************************************************/
 UDRV_API UINT16  USERIAL_Write(tUSERIAL_PORT port, UINT8 *p_data, UINT16 len)
 {
-    int ret = 0, total = 0;
-    int i = 0;
-    clock_t t;
+    UINT16 total;
 
     ALOGD_IF((appl_trace_level>=BT_TRACE_LEVEL_DEBUG), "USERIAL_Write: (%d bytes)", len);
     pthread_mutex_lock(&close_thread_mutex);
 
-    doWriteDelay();
-    t = clock();
-    while (len != 0 && linux_cb.sock != -1)
-    {
-        ret = write(linux_cb.sock, p_data + total, len);
-        if (ret < 0)
-        {
-            ALOGE("USERIAL_Write len = %d, ret = %d, errno = %d", len, ret, errno);
-            break;
-        }
-        else
-        {
-            ALOGD_IF((appl_trace_level>=BT_TRACE_LEVEL_DEBUG), "USERIAL_Write len = %d, ret = %d", len, ret);
-        }
-
-        total += ret;
-        len -= ret;
-    }
-    perf_update(&perf_write, clock() - t, total);
-
-    /* register a delay for next write */
-    setWriteDelay(total * nfc_write_delay / 1000);
+    total = userial_writev(p_data, len);
 
     pthread_mutex_unlock(&close_thread_mutex);
 
-    return ((UINT16)total);
+    return (total);
 }
 
 /*******************************************************************************
@@ -1539,6 +1810,11 @@ void userial_close_thread(UINT32 params)
     linux_cb.sock_power_control = -1;
     linux_cb.sock = -1;
 
+    /* drop anything still batched for writing */
+    while ((p_buf = (BT_HDR *) GKI_dequeue(&Userial_out_q)) != NULL)
+        GKI_freebuf(p_buf);
+    userial_out_len = 0;
+
     close_signal_fds();
     pthread_mutex_unlock(&close_thread_mutex);
     ALOGD("%s: exiting", __FUNCTION__);
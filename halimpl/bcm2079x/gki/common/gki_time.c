@@ -147,7 +147,12 @@ BOOLEAN gki_timers_is_timer_running(void)
 *******************************************************************************/
 UINT32  GKI_get_tick_count(void)
 {
+#if (GKI_TICKLESS == TRUE)
+    /* OSTicks is only updated when the timer loop runs */
+    return gki_timer_get_ticks();
+#else
     return gki_cb.com.OSTicks;
+#endif
 }
 
 
@@ -214,6 +219,11 @@ void GKI_start_timer (UINT8 tnum, INT32 ticks, BOOLEAN is_continuous)
 
     GKI_disable();
 
+#if (GKI_TICKLESS == TRUE)
+    /* account for the time elapsed since the timer loop last ran */
+    gki_timer_sync();
+#endif
+
     if(gki_timers_is_timer_running() == FALSE)
     {
 #if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
@@ -285,6 +295,10 @@ void GKI_start_timer (UINT8 tnum, INT32 ticks, BOOLEAN is_continuous)
     {
         /* Only update the timeout value if it is less than any other newly started timers */
         gki_adjust_timer_count (orig_ticks);
+#if (GKI_TICKLESS == TRUE)
+        /* the timer loop may be sleeping towards a later deadline */
+        gki_timer_rearm();
+#endif
     }
 
     GKI_enable();
@@ -617,6 +631,201 @@ void GKI_timer_queue_register_callback (SYSTEM_TICK_CBACK *p_callback)
     return;
 }
 
+#if (GKI_TIMER_WHEEL == TRUE)
+
+#if (GKI_TIMER_WHEEL_BITS > 6)
+#error  GKI_TIMER_WHEEL_BITS must be at most 6 for the slot number to fit in TIMER_LIST_ENT
+#endif
+
+#define GKI_TIMER_WHEEL_MASK    (GKI_TIMER_WHEEL_SIZE - 1)
+#define GKI_TIMER_WHEEL_SPAN    (1UL << (GKI_TIMER_WHEEL_LEVELS * GKI_TIMER_WHEEL_BITS))
+#define GKI_TIMER_SLOT_OVERFLOW (GKI_TIMER_WHEEL_LEVELS * GKI_TIMER_WHEEL_SIZE)
+#define GKI_TIMER_SLOT_EXPIRED  0xFF
+
+/*******************************************************************************
+**
+** Function         gki_timer_slot_head
+**
+** Description      Returns the list head of a timer wheel slot.
+**
+** Returns          pointer to the slot list head
+**
+*******************************************************************************/
+static TIMER_LIST_ENT **gki_timer_slot_head (TIMER_LIST_Q *p_timer_listq, UINT8 slot)
+{
+    if (slot == GKI_TIMER_SLOT_OVERFLOW)
+        return (&p_timer_listq->p_overflow);
+
+    return (&p_timer_listq->p_wheel[slot >> GKI_TIMER_WHEEL_BITS][slot & GKI_TIMER_WHEEL_MASK]);
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_place
+**
+** Description      Puts an unexpired entry in the wheel slot matching its
+**                  expiry time: level 0 for the next GKI_TIMER_WHEEL_SIZE
+**                  units, level 1 for the following ones and the overflow
+**                  list beyond.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_wheel_place (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT *p_tle)
+{
+    UINT32           delta = p_tle->due - p_timer_listq->now;
+    TIMER_LIST_ENT **pp_head;
+
+    if (delta < GKI_TIMER_WHEEL_SIZE)
+        p_tle->slot = (UINT8)(p_tle->due & GKI_TIMER_WHEEL_MASK);
+    else if (delta < GKI_TIMER_WHEEL_SPAN)
+        p_tle->slot = (UINT8)(GKI_TIMER_WHEEL_SIZE + ((p_tle->due >> GKI_TIMER_WHEEL_BITS) & GKI_TIMER_WHEEL_MASK));
+    else
+        p_tle->slot = GKI_TIMER_SLOT_OVERFLOW;
+
+    pp_head = gki_timer_slot_head (p_timer_listq, p_tle->slot);
+
+    p_tle->p_prev = NULL;
+    p_tle->p_next = *pp_head;
+    if (*pp_head != NULL)
+        (*pp_head)->p_prev = p_tle;
+    *pp_head = p_tle;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_cascade
+**
+** Description      Moves all the entries of a slot closer to the expiry slots.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_wheel_cascade (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT **pp_head)
+{
+    TIMER_LIST_ENT *p_tle = *pp_head;
+    TIMER_LIST_ENT *p_next;
+
+    *pp_head = NULL;
+
+    while (p_tle != NULL)
+    {
+        p_next = p_tle->p_next;
+        gki_timer_wheel_place (p_timer_listq, p_tle);
+        p_tle = p_next;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_list_set_first
+**
+** Description      Points p_first at the pending placeholder, or NULL, once no
+**                  expired entry is left. The placeholder has a positive tick
+**                  count so callers looking for expired entries skip it.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_list_set_first (TIMER_LIST_Q *p_timer_listq)
+{
+    if (p_timer_listq->num_expired == 0)
+    {
+        p_timer_listq->p_last = NULL;
+
+        if (p_timer_listq->num_pending)
+        {
+            p_timer_listq->pending.ticks = GKI_MAX_INT32;
+            p_timer_listq->p_first = &p_timer_listq->pending;
+        }
+        else
+            p_timer_listq->p_first = NULL;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_list_expire
+**
+** Description      Appends an entry to the chain of expired entries.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_list_expire (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT *p_tle)
+{
+    if (p_timer_listq->num_expired == 0)
+    {
+        p_timer_listq->p_first = p_tle;
+        p_tle->p_prev = NULL;
+    }
+    else
+    {
+        p_timer_listq->p_last->p_next = p_tle;
+        p_tle->p_prev = p_timer_listq->p_last;
+    }
+
+    p_tle->p_next = NULL;
+    p_tle->ticks  = 0;
+    p_tle->slot   = GKI_TIMER_SLOT_EXPIRED;
+
+    p_timer_listq->p_last = p_tle;
+    p_timer_listq->num_expired++;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_queue_register
+**
+** Description      Adds a timer list to the array of active timer lists.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_queue_register (TIMER_LIST_Q *p_timer_listq)
+{
+    UINT8 tt;
+
+    for (tt = 0; tt < GKI_MAX_TIMER_QUEUES; tt++)
+    {
+        if (gki_cb.com.timer_queues[tt] == p_timer_listq)
+            return;
+    }
+
+    for (tt = 0; tt < GKI_MAX_TIMER_QUEUES; tt++)
+    {
+        if (gki_cb.com.timer_queues[tt] == NULL)
+        {
+            gki_cb.com.timer_queues[tt] = p_timer_listq;
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_queue_unregister
+**
+** Description      Removes an empty timer list from the array of active timer lists.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_queue_unregister (TIMER_LIST_Q *p_timer_listq)
+{
+    UINT8 tt;
+
+    for (tt = 0; tt < GKI_MAX_TIMER_QUEUES; tt++)
+    {
+        if (gki_cb.com.timer_queues[tt] == p_timer_listq)
+        {
+            gki_cb.com.timer_queues[tt] = NULL;
+            break;
+        }
+    }
+}
+#endif  /* GKI_TIMER_WHEEL */
+
 /*******************************************************************************
 **
 ** Function         GKI_init_timer_list
@@ -631,10 +840,26 @@ void GKI_timer_queue_register_callback (SYSTEM_TICK_CBACK *p_callback)
 *******************************************************************************/
 void GKI_init_timer_list (TIMER_LIST_Q *p_timer_listq)
 {
+#if (GKI_TIMER_WHEEL == TRUE)
+    UINT8 lvl, slot;
+#endif
+
     p_timer_listq->p_first    = NULL;
     p_timer_listq->p_last     = NULL;
     p_timer_listq->last_ticks = 0;
 
+#if (GKI_TIMER_WHEEL == TRUE)
+    p_timer_listq->now         = 0;
+    p_timer_listq->num_pending = 0;
+    p_timer_listq->num_expired = 0;
+    p_timer_listq->p_overflow  = NULL;
+    GKI_init_timer_list_entry (&p_timer_listq->pending);
+
+    for (lvl = 0; lvl < GKI_TIMER_WHEEL_LEVELS; lvl++)
+        for (slot = 0; slot < GKI_TIMER_WHEEL_SIZE; slot++)
+            p_timer_listq->p_wheel[lvl][slot] = NULL;
+#endif
+
     return;
 }
 
@@ -657,6 +882,10 @@ void GKI_init_timer_list_entry (TIMER_LIST_ENT  *p_tle)
     p_tle->p_prev  = NULL;
     p_tle->ticks   = GKI_UNUSED_LIST_ENTRY;
     p_tle->in_use  = FALSE;
+#if (GKI_TIMER_WHEEL == TRUE)
+    p_tle->slot    = GKI_TIMER_SLOT_EXPIRED;
+    p_tle->due     = 0;
+#endif
 }
 
 
@@ -680,6 +909,47 @@ void GKI_init_timer_list_entry (TIMER_LIST_ENT  *p_tle)
 *******************************************************************************/
 UINT16 GKI_update_timer_list (TIMER_LIST_Q *p_timer_listq, INT32 num_units_since_last_update)
 {
+#if (GKI_TIMER_WHEEL == TRUE)
+    TIMER_LIST_ENT  *p_tle;
+    TIMER_LIST_ENT  *p_next;
+    UINT32           slot;
+
+    /* Step through the elapsed units while anything is left in the wheel */
+    while ((num_units_since_last_update > 0) && (p_timer_listq->num_pending))
+    {
+        p_timer_listq->now++;
+        num_units_since_last_update--;
+
+        /* Refill the upper levels from the level above when they wrap around */
+        if ((p_timer_listq->now & (GKI_TIMER_WHEEL_SPAN - 1)) == 0)
+            gki_timer_wheel_cascade (p_timer_listq, &p_timer_listq->p_overflow);
+
+        if ((p_timer_listq->now & GKI_TIMER_WHEEL_MASK) == 0)
+        {
+            slot = (p_timer_listq->now >> GKI_TIMER_WHEEL_BITS) & GKI_TIMER_WHEEL_MASK;
+            gki_timer_wheel_cascade (p_timer_listq, &p_timer_listq->p_wheel[1][slot]);
+        }
+
+        /* Everything in the current level 0 slot expires now */
+        slot  = p_timer_listq->now & GKI_TIMER_WHEEL_MASK;
+        p_tle = p_timer_listq->p_wheel[0][slot];
+        p_timer_listq->p_wheel[0][slot] = NULL;
+
+        while (p_tle != NULL)
+        {
+            p_next = p_tle->p_next;
+            p_timer_listq->num_pending--;
+            gki_timer_list_expire (p_timer_listq, p_tle);
+            p_tle = p_next;
+        }
+    }
+
+    /* Nothing left to expire, just keep the list time */
+    if (num_units_since_last_update > 0)
+        p_timer_listq->now += (UINT32)num_units_since_last_update;
+
+    return (p_timer_listq->num_expired);
+#else
     TIMER_LIST_ENT  *p_tle;
     UINT16           num_time_out = 0;
     INT32            rem_ticks;
@@ -730,6 +1000,7 @@ UINT16 GKI_update_timer_list (TIMER_LIST_Q *p_timer_listq, INT32 num_units_since
     }
 
     return (num_time_out);
+#endif
 }
 
 /*******************************************************************************
@@ -748,6 +1019,18 @@ UINT16 GKI_update_timer_list (TIMER_LIST_Q *p_timer_listq, INT32 num_units_since
 *******************************************************************************/
 UINT32 GKI_get_remaining_ticks (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_target_tle)
 {
+#if (GKI_TIMER_WHEEL == TRUE)
+    if (p_target_tle->in_use)
+    {
+        if (p_target_tle->slot == GKI_TIMER_SLOT_EXPIRED)
+            return (0);
+
+        return (p_target_tle->due - p_timer_listq->now);
+    }
+
+    BT_ERROR_TRACE_0(TRACE_LAYER_GKI, "GKI_get_remaining_ticks: timer entry is not active");
+    return (0);
+#else
     TIMER_LIST_ENT  *p_tle;
     UINT32           rem_ticks = 0;
 
@@ -779,6 +1062,7 @@ UINT32 GKI_get_remaining_ticks (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_
     }
 
     return (rem_ticks);
+#endif
 }
 
 /*******************************************************************************
@@ -799,15 +1083,34 @@ UINT32 GKI_get_remaining_ticks (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_
 *******************************************************************************/
 void GKI_add_to_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_tle)
 {
+#if (GKI_TIMER_WHEEL == FALSE)
     UINT32           nr_ticks_total;
     UINT8 tt;
     TIMER_LIST_ENT  *p_temp;
+#endif
     if (p_tle == NULL || p_timer_listq == NULL) {
         GKI_TRACE_3("%s: invalid argument %x, %x****************************<<", __func__, p_timer_listq, p_tle);
         return;
     }
 
+#if (GKI_TIMER_WHEEL == TRUE)
+    /* Only process valid tick values */
+    if (p_tle->ticks >= 0)
+    {
+        if (p_tle->ticks == 0)
+            gki_timer_list_expire (p_timer_listq, p_tle);
+        else
+        {
+            p_tle->due = p_timer_listq->now + (UINT32)p_tle->ticks;
+            gki_timer_wheel_place (p_timer_listq, p_tle);
+            p_timer_listq->num_pending++;
+            gki_timer_list_set_first (p_timer_listq);
+        }
 
+        p_tle->in_use = TRUE;
+        gki_timer_queue_register (p_timer_listq);
+    }
+#else
     /* Only process valid tick values */
     if (p_tle->ticks >= 0)
     {
@@ -882,6 +1185,7 @@ void GKI_add_to_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_tle)
             gki_cb.com.timer_queues[tt] = p_timer_listq;
         }
     }
+#endif
 
     return;
 }
@@ -902,7 +1206,9 @@ void GKI_add_to_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_tle)
 *******************************************************************************/
 void GKI_remove_from_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_tle)
 {
+#if (GKI_TIMER_WHEEL == FALSE)
     UINT8 tt;
+#endif
 
     /* Verify that the entry is valid */
     if (p_tle == NULL || p_tle->in_use == FALSE || p_timer_listq->p_first == NULL)
@@ -910,6 +1216,47 @@ void GKI_remove_from_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p
         return;
     }
 
+#if (GKI_TIMER_WHEEL == TRUE)
+    if (p_tle->slot == GKI_TIMER_SLOT_EXPIRED)
+    {
+        /* Unlink from the chain of expired entries */
+        if (p_tle->p_prev != NULL)
+            p_tle->p_prev->p_next = p_tle->p_next;
+        else
+            p_timer_listq->p_first = p_tle->p_next;
+
+        if (p_tle->p_next != NULL)
+            p_tle->p_next->p_prev = p_tle->p_prev;
+        else
+            p_timer_listq->p_last = p_tle->p_prev;
+
+        p_timer_listq->num_expired--;
+    }
+    else
+    {
+        /* Unlink from its wheel slot */
+        if (p_tle->p_prev != NULL)
+            p_tle->p_prev->p_next = p_tle->p_next;
+        else
+            *gki_timer_slot_head (p_timer_listq, p_tle->slot) = p_tle->p_next;
+
+        if (p_tle->p_next != NULL)
+            p_tle->p_next->p_prev = p_tle->p_prev;
+
+        p_timer_listq->num_pending--;
+    }
+
+    p_tle->p_next = p_tle->p_prev = NULL;
+    p_tle->ticks  = GKI_UNUSED_LIST_ENTRY;
+    p_tle->slot   = GKI_TIMER_SLOT_EXPIRED;
+    p_tle->in_use = FALSE;
+
+    gki_timer_list_set_first (p_timer_listq);
+
+    /* if timer queue is empty */
+    if (p_timer_listq->p_first == NULL)
+        gki_timer_queue_unregister (p_timer_listq);
+#else
     /* Add the ticks remaining in this timer (if any) to the next guy in the list.
     ** Note: Expired timers have a tick value of '0'.
     */
@@ -979,6 +1326,7 @@ void GKI_remove_from_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p
             }
         }
     }
+#endif
 
     return;
 }
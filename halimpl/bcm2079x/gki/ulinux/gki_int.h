@@ -27,6 +27,14 @@
 #ifdef ANDROID
 #include <sys/times.h>
 #endif
+#include <time.h>
+
+/* When TRUE the timer loop in GKI_run() sleeps until the next task timer expiry
+** instead of waking up every system tick.
+*/
+#ifndef GKI_TICKLESS
+#define GKI_TICKLESS                TRUE
+#endif
 
 typedef struct
 {
@@ -40,6 +48,9 @@ typedef struct
     pthread_mutex_t     gki_timer_mutex;
     pthread_cond_t      gki_timer_cond;
     int                 gki_timer_wake_lock_on;
+#if (GKI_TICKLESS == TRUE)
+    struct timespec     tick_ref;           /* monotonic time of the last accounted system tick */
+#endif
 #if (GKI_DEBUG == TRUE)
     pthread_mutex_t     GKI_trace_mutex;
 #endif
@@ -51,6 +62,11 @@ typedef struct
 #define GKI_TIMER_TICK_EXIT_COND 2
 
 extern void gki_system_tick_start_stop_cback(BOOLEAN start);
+#if (GKI_TICKLESS == TRUE)
+extern void gki_timer_sync(void);
+extern void gki_timer_rearm(void);
+extern UINT32 gki_timer_get_ticks(void);
+#endif
 
 /* Contains common control block as well as OS specific variables */
 typedef struct
@@ -216,6 +216,51 @@ void HAL_NfcWrite (UINT16 data_len, UINT8 *p_data)
     }
 }
 
+#ifdef NFC_HAL_SHARED_GKI
+/*******************************************************************************
+**
+** Function         HAL_NfcWriteBuf
+**
+** Description      Send an NCI control message or data packet to the
+**                  transport without copying it. The HAL takes ownership of
+**                  the buffer, which must leave NFC_HAL_NCI_MSG_OFFSET_SIZE
+**                  bytes in front of the message for the transport header.
+**                  Only available when NFC/HAL share GKI resources.
+**
+** Returns          void
+**
+*******************************************************************************/
+void HAL_NfcWriteBuf (NFC_HDR *p_msg)
+{
+    UINT8 mt;
+
+    HAL_TRACE_API0 ("HAL_NfcWriteBuf ()");
+
+    if (p_msg->len > (NCI_MAX_CTRL_SIZE + NCI_MSG_HDR_SIZE))
+    {
+        HAL_TRACE_ERROR1 ("HAL_NfcWriteBuf (): too many bytes (%d)", p_msg->len);
+        GKI_freebuf (p_msg);
+        return;
+    }
+
+    if (p_msg->offset < NFC_HAL_NCI_MSG_OFFSET_SIZE)
+    {
+        /* no room for the transport header, send a copy */
+        HAL_NfcWrite (p_msg->len, (UINT8 *) (p_msg + 1) + p_msg->offset);
+        GKI_freebuf (p_msg);
+        return;
+    }
+
+    /* Check if message is a command or data */
+    mt = (*((UINT8 *) (p_msg + 1) + p_msg->offset) & NCI_MT_MASK) >> NCI_MT_SHIFT;
+
+    p_msg->event          = NFC_HAL_EVT_TO_NFC_NCI;
+    p_msg->layer_specific = (mt == NCI_MT_CMD) ? NFC_HAL_WAIT_RSP_CMD : 0;
+
+    GKI_send_msg (NFC_HAL_TASK, NFC_HAL_TASK_MBOX, p_msg);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         HAL_NfcPreDiscover
@@ -769,51 +769,94 @@ void nfc_hal_dm_proc_msg_during_init (NFC_HDR *p_msg)
 
 /*******************************************************************************
 **
-** Function         nfc_hal_dm_send_nci_cmd
+** Function         nfc_hal_dm_build_nci_cmd
 **
-** Description      Send NCI command to NFCC while initializing BRCM NFCC
+** Description      Copy an NCI command into a GKI buffer ready for
+**                  nfc_hal_dm_send_nci_buf
 **
-** Returns          void
+** Returns          the buffer, or NULL if no buffer is available
 **
 *******************************************************************************/
-void nfc_hal_dm_send_nci_cmd (const UINT8 *p_data, UINT16 len, tNFC_HAL_NCI_CBACK *p_cback)
+NFC_HDR *nfc_hal_dm_build_nci_cmd (const UINT8 *p_data, UINT16 len)
 {
     NFC_HDR *p_buf;
-    UINT8  *ps;
 
-    HAL_TRACE_DEBUG1 ("nfc_hal_dm_send_nci_cmd (): nci_wait_rsp = 0x%x", nfc_hal_cb.ncit_cb.nci_wait_rsp);
+    if ((p_buf = (NFC_HDR *)GKI_getpoolbuf (NFC_HAL_NCI_POOL_ID)) != NULL)
+    {
+        p_buf->offset = NFC_HAL_NCI_MSG_OFFSET_SIZE;
+        p_buf->event  = NFC_HAL_EVT_TO_NFC_NCI;
+        p_buf->len    = len;
+
+        memcpy ((UINT8*) (p_buf + 1) + p_buf->offset, p_data, len);
+    }
+
+    return p_buf;
+}
+
+/*******************************************************************************
+**
+** Function         nfc_hal_dm_send_nci_buf
+**
+** Description      Send NCI command built by nfc_hal_dm_build_nci_cmd to NFCC
+**                  while initializing BRCM NFCC. The buffer is always consumed.
+**
+** Returns          void
+**
+*******************************************************************************/
+void nfc_hal_dm_send_nci_buf (NFC_HDR *p_buf, tNFC_HAL_NCI_CBACK *p_cback)
+{
+    UINT8  *ps;
 
     if (nfc_hal_cb.ncit_cb.nci_wait_rsp != NFC_HAL_WAIT_RSP_NONE)
     {
-        HAL_TRACE_ERROR0 ("nfc_hal_dm_send_nci_cmd(): no command window");
+        HAL_TRACE_ERROR0 ("nfc_hal_dm_send_nci_buf(): no command window");
+        GKI_freebuf (p_buf);
         return;
     }
 
-    if ((p_buf = (NFC_HDR *)GKI_getpoolbuf (NFC_HAL_NCI_POOL_ID)) != NULL)
-    {
-        nfc_hal_cb.ncit_cb.nci_wait_rsp = NFC_HAL_WAIT_RSP_VSC;
+    nfc_hal_cb.ncit_cb.nci_wait_rsp = NFC_HAL_WAIT_RSP_VSC;
 
-        p_buf->offset = NFC_HAL_NCI_MSG_OFFSET_SIZE;
-        p_buf->event  = NFC_HAL_EVT_TO_NFC_NCI;
-        p_buf->len    = len;
+    /* Keep a copy of the command and send to NCI transport */
 
-        memcpy ((UINT8*) (p_buf + 1) + p_buf->offset, p_data, len);
+    /* save the message header to double check the response */
+    ps   = (UINT8 *)(p_buf + 1) + p_buf->offset;
+    memcpy(nfc_hal_cb.ncit_cb.last_hdr, ps, NFC_HAL_SAVED_HDR_SIZE);
+    memcpy(nfc_hal_cb.ncit_cb.last_cmd, ps + NCI_MSG_HDR_SIZE, NFC_HAL_SAVED_CMD_SIZE);
 
-        /* Keep a copy of the command and send to NCI transport */
+    /* save the callback for NCI VSCs */
+    nfc_hal_cb.ncit_cb.p_vsc_cback = (void *)p_cback;
 
-        /* save the message header to double check the response */
-        ps   = (UINT8 *)(p_buf + 1) + p_buf->offset;
-        memcpy(nfc_hal_cb.ncit_cb.last_hdr, ps, NFC_HAL_SAVED_HDR_SIZE);
-        memcpy(nfc_hal_cb.ncit_cb.last_cmd, ps + NCI_MSG_HDR_SIZE, NFC_HAL_SAVED_CMD_SIZE);
+    nfc_hal_nci_send_cmd (p_buf);
 
-        /* save the callback for NCI VSCs */
-        nfc_hal_cb.ncit_cb.p_vsc_cback = (void *)p_cback;
+    /* start NFC command-timeout timer */
+    nfc_hal_main_start_quick_timer (&nfc_hal_cb.ncit_cb.nci_wait_rsp_timer, (UINT16)(NFC_HAL_TTYPE_NCI_WAIT_RSP),
+                                    ((UINT32) NFC_HAL_CMD_TOUT) * QUICK_TIMER_TICKS_PER_SEC / 1000);
+}
+
+/*******************************************************************************
+**
+** Function         nfc_hal_dm_send_nci_cmd
+**
+** Description      Send NCI command to NFCC while initializing BRCM NFCC
+**
+** Returns          void
+**
+*******************************************************************************/
+void nfc_hal_dm_send_nci_cmd (const UINT8 *p_data, UINT16 len, tNFC_HAL_NCI_CBACK *p_cback)
+{
+    NFC_HDR *p_buf;
 
-        nfc_hal_nci_send_cmd (p_buf);
+    HAL_TRACE_DEBUG1 ("nfc_hal_dm_send_nci_cmd (): nci_wait_rsp = 0x%x", nfc_hal_cb.ncit_cb.nci_wait_rsp);
 
-        /* start NFC command-timeout timer */
-        nfc_hal_main_start_quick_timer (&nfc_hal_cb.ncit_cb.nci_wait_rsp_timer, (UINT16)(NFC_HAL_TTYPE_NCI_WAIT_RSP),
-                                        ((UINT32) NFC_HAL_CMD_TOUT) * QUICK_TIMER_TICKS_PER_SEC / 1000);
+    if (nfc_hal_cb.ncit_cb.nci_wait_rsp != NFC_HAL_WAIT_RSP_NONE)
+    {
+        HAL_TRACE_ERROR0 ("nfc_hal_dm_send_nci_cmd(): no command window");
+        return;
+    }
+
+    if ((p_buf = nfc_hal_dm_build_nci_cmd (p_data, len)) != NULL)
+    {
+        nfc_hal_dm_send_nci_buf (p_buf, p_cback);
     }
 }
 
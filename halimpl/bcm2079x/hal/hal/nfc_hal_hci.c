@@ -308,7 +308,7 @@ void nfc_hal_hci_fake_adm_notify_all_pipe_cleared_to_dh (void)
         /* Initialize NFC_HDR */
         p_msg->len    = NCI_DATA_HDR_SIZE + 0x03;
         p_msg->event  = 0;
-        p_msg->offset = 0;
+        p_msg->offset = NFC_HAL_NCI_RX_MSG_OFFSET_SIZE;
         p_msg->layer_specific = 0;
 
         p = (UINT8 *) (p_msg + 1) + p_msg->offset;
@@ -465,7 +465,7 @@ static void nfc_hal_send_credit_ntf_for_cid (UINT8 cid)
         /* Initialize NFC_HDR */
         p_msg->len    = NCI_DATA_HDR_SIZE + 0x03;
         p_msg->event  = 0;
-        p_msg->offset = 0;
+        p_msg->offset = NFC_HAL_NCI_RX_MSG_OFFSET_SIZE;
         p_msg->layer_specific = 0;
 
         p = (UINT8 *) (p_msg + 1) + p_msg->offset;
@@ -555,13 +555,15 @@ static void nfc_hal_main_send_message (NFC_HDR *p_msg)
         /* check low power mode state */
         if (nfc_hal_dm_power_mode_execute (NFC_HAL_LP_TX_DATA_EVT))
         {
-            USERIAL_Write (USERIAL_NFC_PORT, ps, p_msg->len);
+            /* the transport frees the buffer; data packets queued back to back are
+             * batched into one write until USERIAL_WriteFlush () */
+            USERIAL_WriteBuf (USERIAL_NFC_PORT, (BT_HDR *) p_msg);
         }
         else
         {
             HAL_TRACE_ERROR0 ("nfc_hal_main_send_message(): drop data in low power mode");
+            GKI_freebuf (p_msg);
         }
-        GKI_freebuf (p_msg);
     }
 }
 
@@ -685,6 +687,9 @@ UINT32 nfc_hal_main_task (UINT32 param)
                 if (free_msg)
                     GKI_freebuf (p_msg);
             }
+
+            /* write out data packets batched while draining the mailbox */
+            USERIAL_WriteFlush (USERIAL_NFC_PORT);
         }
 
         /* Data waiting to be read from serial port */
@@ -195,7 +195,7 @@ static BOOLEAN nfc_hal_nci_receive_nci_msg (tNFC_HAL_NCIT_CB *p_cb, UINT8 byte)
             /* Initialize NFC_HDR */
             p_cb->p_rcv_msg->len    = 0;
             p_cb->p_rcv_msg->event  = 0;
-            p_cb->p_rcv_msg->offset = 0;
+            p_cb->p_rcv_msg->offset = NFC_HAL_NCI_RX_MSG_OFFSET_SIZE;
 
             *((UINT8 *) (p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->offset + p_cb->p_rcv_msg->len++) = byte;
         }
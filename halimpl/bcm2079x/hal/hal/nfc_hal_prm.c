@@ -17,6 +17,7 @@
  ******************************************************************************/
 
 #include <string.h>
+#include <time.h>
 #include "nfc_hal_int.h"
 #include "userial.h"
 
@@ -48,8 +49,11 @@ const UINT8 NFC_HAL_PRM_BCM20791B3_STR[]   = "20791B3";
 
 #if (NFC_HAL_PRM_DEBUG == TRUE)
 #define NFC_HAL_PRM_STATE(str)  HAL_TRACE_DEBUG2 ("%s st: %d", str, nfc_hal_cb.prm.state)
+#define NFC_HAL_PRM_PHASE(str)  nfc_hal_prm_phase (str)
+static void nfc_hal_prm_phase (const char *p_next_phase);
 #else
 #define NFC_HAL_PRM_STATE(str)
+#define NFC_HAL_PRM_PHASE(str)
 #endif
 
 void nfc_hal_prm_post_baud_update (tHAL_NFC_STATUS status);
@@ -73,6 +77,48 @@ static BOOLEAN nfc_hal_prm_nvm_rw_cmd(void);
 *****************************************************************************/
 extern tNFC_HAL_CFG *p_nfc_hal_cfg;
 
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+/*******************************************************************************
+**
+** Function         nfc_hal_prm_time_ms
+**
+** Description      Read the monotonic clock used to time the patch download
+**
+** Returns          time in ms
+**
+*******************************************************************************/
+static UINT32 nfc_hal_prm_time_ms (void)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return ((UINT32) now.tv_sec * 1000 + (UINT32) (now.tv_nsec / 1000000));
+}
+
+/*******************************************************************************
+**
+** Function         nfc_hal_prm_phase
+**
+** Description      Log the duration of the current phase of the patch
+**                  download, and start timing the next one (if any)
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfc_hal_prm_phase (const char *p_next_phase)
+{
+    UINT32 now = nfc_hal_prm_time_ms ();
+
+    if (nfc_hal_cb.prm.p_phase)
+    {
+        HAL_TRACE_DEBUG2 ("Patch download: %s took %u ms", nfc_hal_cb.prm.p_phase, now - nfc_hal_cb.prm.phase_start_ms);
+    }
+
+    nfc_hal_cb.prm.p_phase        = p_next_phase;
+    nfc_hal_cb.prm.phase_start_ms = now;
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         nfc_hal_prm_spd_handle_download_complete
@@ -86,11 +132,104 @@ void nfc_hal_prm_spd_handle_download_complete (UINT8 event)
 {
     nfc_hal_cb.prm.state = NFC_HAL_PRM_ST_IDLE;
 
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+    /* Drop the segment that was built ahead, if the download ended early */
+    if (nfc_hal_cb.prm.p_next_seg)
+    {
+        GKI_freebuf (nfc_hal_cb.prm.p_next_seg);
+        nfc_hal_cb.prm.p_next_seg = NULL;
+    }
+#endif
+
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    NFC_HAL_PRM_PHASE (NULL);
+    HAL_TRACE_DEBUG2 ("Patch download finished (event=0x%x) in %u ms",
+                      event, nfc_hal_prm_time_ms () - nfc_hal_cb.prm.start_ms);
+    if (nfc_hal_cb.prm.seg_count)
+    {
+        HAL_TRACE_DEBUG3 ("Patch download: %u segments, round trip avg %u ms, max %u ms",
+                          nfc_hal_cb.prm.seg_count,
+                          nfc_hal_cb.prm.seg_total_ms / nfc_hal_cb.prm.seg_count,
+                          nfc_hal_cb.prm.seg_max_ms);
+    }
+#endif
+
     /* Notify application now */
     if (nfc_hal_cb.prm.p_cback)
         (nfc_hal_cb.prm.p_cback) (event);
 }
 
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+/*******************************************************************************
+**
+** Function         nfc_hal_prm_spd_build_next_segment
+**
+** Description      Build the buffer for the segment following the one just
+**                  sent, so that it can go out as soon as the NFCC responds.
+**                  Header segments (which need the chip version check) and
+**                  truncated segments are left to
+**                  nfc_hal_prm_spd_send_next_segment.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfc_hal_prm_spd_build_next_segment (void)
+{
+    const UINT8 *p_src, *p_seg;
+    UINT8   oid, type, len;
+    UINT8   patch_hdr_size = NCI_MSG_HDR_SIZE + 1; /* 1 is for HCIT */
+
+    /* Nothing follows the signature until the NFCC has authenticated the patch */
+    if (  (!(nfc_hal_cb.prm.flags & NFC_HAL_PRM_FLAGS_USE_PATCHRAM_BUF))
+        ||(nfc_hal_cb.prm.flags & NFC_HAL_PRM_FLAGS_SIGNATURE_SENT)
+        ||(nfc_hal_cb.prm.p_next_seg)
+        ||(nfc_hal_cb.prm.cur_patch_len_remaining < patch_hdr_size)  )
+        return;
+
+    /* Parse NCI command header */
+    p_seg = p_src = nfc_hal_cb.prm.p_cur_patch_data + nfc_hal_cb.prm.cur_patch_offset;
+    p_src += 2;     /* skip HCIT and MT/PBF/GID */
+    STREAM_TO_UINT8 (oid,  p_src);
+    STREAM_TO_UINT8 (len,  p_src);
+    STREAM_TO_UINT8 (type, p_src);
+
+    if (  ((oid == NCI_MSG_SECURE_PATCH_DOWNLOAD) && (type == NCI_SPD_TYPE_HEADER))
+        ||(nfc_hal_cb.prm.cur_patch_len_remaining < len + patch_hdr_size)  )
+        return;
+
+    /* Copy the command (not including HCIT here) */
+    if ((nfc_hal_cb.prm.p_next_seg = nfc_hal_dm_build_nci_cmd (p_seg + 1, (UINT16) (len + NCI_MSG_HDR_SIZE))) != NULL)
+    {
+        nfc_hal_cb.prm.next_seg_is_sig = ((oid == NCI_MSG_SECURE_PATCH_DOWNLOAD) && (type == NCI_SPD_TYPE_SIGNATURE));
+
+        /* Update number of bytes comsumed */
+        nfc_hal_cb.prm.cur_patch_offset += (len + patch_hdr_size);
+        nfc_hal_cb.prm.cur_patch_len_remaining -=  (len + patch_hdr_size);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         nfc_hal_prm_spd_send_segment_buf
+**
+** Description      Send a patch segment, then build the next one while the
+**                  NFCC processes it
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfc_hal_prm_spd_send_segment_buf (NFC_HDR *p_buf)
+{
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    nfc_hal_cb.prm.seg_sent_ms = nfc_hal_prm_time_ms ();
+#endif
+
+    nfc_hal_dm_send_nci_buf (p_buf, nfc_hal_prm_nci_command_complete_cback);
+
+    nfc_hal_prm_spd_build_next_segment ();
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         nfc_hal_prm_spd_send_next_segment
@@ -108,6 +247,20 @@ void nfc_hal_prm_spd_send_next_segment (void)
     UINT8   chipverlen;
     UINT8   chipverstr[NCI_SPD_HEADER_CHIPVER_LEN];
     UINT8   patch_hdr_size = NCI_MSG_HDR_SIZE + 1; /* 1 is for HCIT */
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+    NFC_HDR *p_buf;
+
+    /* If this segment was already built while the previous one was in flight, just send it */
+    if ((p_buf = nfc_hal_cb.prm.p_next_seg) != NULL)
+    {
+        nfc_hal_cb.prm.p_next_seg = NULL;
+        if (nfc_hal_cb.prm.next_seg_is_sig)
+            nfc_hal_cb.prm.flags |= NFC_HAL_PRM_FLAGS_SIGNATURE_SENT;
+
+        nfc_hal_prm_spd_send_segment_buf (p_buf);
+        return;
+    }
+#endif
 
     /* Validate that segment is at least big enought to have NCI_MSG_HDR_SIZE + 1 (hcit) */
     if (nfc_hal_cb.prm.cur_patch_len_remaining < patch_hdr_size)
@@ -163,9 +316,26 @@ void nfc_hal_prm_spd_send_next_segment (void)
         }
     }
 
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+    /* Send the command (not including HCIT here) */
+    if (nfc_hal_cb.ncit_cb.nci_wait_rsp != NFC_HAL_WAIT_RSP_NONE)
+    {
+        HAL_TRACE_ERROR0 ("nfc_hal_prm_spd_send_next_segment(): no command window");
+    }
+    else if ((p_buf = nfc_hal_dm_build_nci_cmd ((UINT8*) (nfc_hal_cb.prm.p_cur_patch_data + offset + 1),
+                                                (UINT8) (len + NCI_MSG_HDR_SIZE))) != NULL)
+    {
+        nfc_hal_prm_spd_send_segment_buf (p_buf);
+    }
+#else
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    nfc_hal_cb.prm.seg_sent_ms = nfc_hal_prm_time_ms ();
+#endif
+
     /* Send the command (not including HCIT here) */
     nfc_hal_dm_send_nci_cmd ((UINT8*) (nfc_hal_cb.prm.p_cur_patch_data + offset + 1), (UINT8) (len + NCI_MSG_HDR_SIZE),
                              nfc_hal_prm_nci_command_complete_cback);
+#endif
 }
 
 /*******************************************************************************
@@ -224,6 +394,7 @@ void nfc_hal_prm_spd_handle_next_patch_start (void)
 
     /* Begin downloading patch */
     HAL_TRACE_DEBUG1 ("Downloading patch for power_mode %i.", nfc_hal_cb.prm.spd_patch_desc[nfc_hal_cb.prm.spd_cur_patch_idx].power_mode);
+    NFC_HAL_PRM_PHASE ("patch segments");
     nfc_hal_cb.prm.state = NFC_HAL_PRM_ST_SPD_DOWNLOADING;
     nfc_hal_prm_spd_send_next_segment ();
 }
@@ -248,6 +419,7 @@ void nfc_hal_prm_spd_download_i2c_fix (void)
     UINT8 u8;
 
     HAL_TRACE_DEBUG0 ("Downloading I2C fix...");
+    NFC_HAL_PRM_PHASE ("I2C fix segments");
 
     /* Save pointer and offset of patchfile, so we can resume after downloading the i2c fix */
     nfc_hal_cb.prm.spd_patch_offset = nfc_hal_cb.prm.cur_patch_offset;
@@ -663,6 +835,9 @@ void nfc_hal_prm_nci_command_complete_cback (tNFC_HAL_NCI_EVT event, UINT16 data
     UINT8 status, u8;
     UINT8 *p;
     UINT32 post_signature_delay;
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    UINT32 seg_ms;
+#endif
 
     NFC_HAL_PRM_STATE ("nfc_hal_prm_nci_command_complete_cback");
 
@@ -679,6 +854,14 @@ void nfc_hal_prm_nci_command_complete_cback (tNFC_HAL_NCI_EVT event, UINT16 data
         STREAM_TO_UINT8 (status, p);
         STREAM_TO_UINT8 (u8, p);
 
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+        seg_ms = nfc_hal_prm_time_ms () - nfc_hal_cb.prm.seg_sent_ms;
+        nfc_hal_cb.prm.seg_count++;
+        nfc_hal_cb.prm.seg_total_ms += seg_ms;
+        if (seg_ms > nfc_hal_cb.prm.seg_max_ms)
+            nfc_hal_cb.prm.seg_max_ms = seg_ms;
+#endif
+
         if (status != NCI_STATUS_OK)
         {
 #if (NFC_HAL_TRACE_VERBOSE == TRUE)
@@ -697,6 +880,7 @@ void nfc_hal_prm_nci_command_complete_cback (tNFC_HAL_NCI_EVT event, UINT16 data
         {
             /* Wait for authentication complete (SECURE_PATCH_DOWNLOAD NTF), including time to commit to NVM (for BCM43341B0) */
             nfc_hal_cb.prm.state = NFC_HAL_PRM_ST_SPD_AUTHENTICATING;
+            NFC_HAL_PRM_PHASE ("authentication");
             nfc_hal_main_start_quick_timer (&nfc_hal_cb.prm.timer, 0x00,
                                             (NFC_HAL_PRM_COMMIT_DELAY * QUICK_TIMER_TICKS_PER_SEC) / 1000);
             return;
@@ -747,6 +931,7 @@ void nfc_hal_prm_nci_command_complete_cback (tNFC_HAL_NCI_EVT event, UINT16 data
                 nfc_hal_cb.prm.flags &= ~NFC_HAL_PRM_FLAGS_SIGNATURE_SENT;
 
                 /* Post PreI2C delay */
+                NFC_HAL_PRM_PHASE ("post I2C fix delay");
                 nfc_hal_main_start_quick_timer (&nfc_hal_cb.prm.timer, 0x00, (nfc_hal_cb.prm_i2c.prei2c_delay * QUICK_TIMER_TICKS_PER_SEC) / 1000);
 
                 return;
@@ -778,6 +963,7 @@ void nfc_hal_prm_nci_command_complete_cback (tNFC_HAL_NCI_EVT event, UINT16 data
             }
 
             nfc_hal_cb.prm.state = NFC_HAL_PRM_ST_SPD_AUTH_DONE;
+            NFC_HAL_PRM_PHASE ("NVM commit");
 
             nfc_hal_main_start_quick_timer (&nfc_hal_cb.prm.timer, 0x00,
                                             (post_signature_delay * QUICK_TIMER_TICKS_PER_SEC) / 1000);
@@ -866,6 +1052,7 @@ void nfc_hal_prm_nfcc_ready_to_continue (void)
         /* add get patch info again to verify the effective FW version */
         nfc_hal_dm_send_nci_cmd (get_patch_version_cmd, NCI_MSG_HDR_SIZE, nfc_hal_prm_nci_command_complete_cback);
         nfc_hal_cb.prm.state = NFC_HAL_PRM_ST_W4_GET_VERSION;
+        NFC_HAL_PRM_PHASE ("get patch version");
     }
 }
 
@@ -1015,8 +1202,18 @@ BOOLEAN HAL_NfcPrmDownloadStart (tNFC_HAL_PRM_FORMAT format_type,
 {
     HAL_TRACE_API0 ("HAL_NfcPrmDownloadStart ()");
 
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+    if (nfc_hal_cb.prm.p_next_seg)
+        GKI_freebuf (nfc_hal_cb.prm.p_next_seg);
+#endif
+
     memset (&nfc_hal_cb.prm, 0, sizeof (tNFC_HAL_PRM_CB));
 
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    nfc_hal_cb.prm.start_ms = nfc_hal_prm_time_ms ();
+    NFC_HAL_PRM_PHASE ("version check");
+#endif
+
     if (p_patchram_buf)
     {
         nfc_hal_cb.prm.p_cur_patch_data = p_patchram_buf;
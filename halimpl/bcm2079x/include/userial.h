@@ -250,6 +250,7 @@ UDRV_API extern void    USERIAL_ReadBuf(tUSERIAL_PORT, BT_HDR **);
 UDRV_API extern UINT16  USERIAL_Read(tUSERIAL_PORT, UINT8 *, UINT16);
 UDRV_API extern BOOLEAN USERIAL_WriteBuf(tUSERIAL_PORT, BT_HDR *);
 UDRV_API extern UINT16  USERIAL_Write(tUSERIAL_PORT, UINT8 *, UINT16);
+UDRV_API extern void    USERIAL_WriteFlush(tUSERIAL_PORT);
 UDRV_API extern void    USERIAL_Ioctl(tUSERIAL_PORT, tUSERIAL_OP, tUSERIAL_IOCTL_DATA *);
 UDRV_API extern void    USERIAL_Close(tUSERIAL_PORT);
 UDRV_API extern BOOLEAN USERIAL_Feature(tUSERIAL_FEATURE);
@@ -19,9 +19,12 @@
 #include "CrcChecksum.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
-#include <string>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
 #define LOG_TAG "NfcNciHal"
 
 
@@ -62,22 +65,63 @@ static const unsigned short crctab [256] =
 };
 
 
+/* crcslice[k][i] is the CRC of byte i followed by k zero bytes; crcslice[0] is crctab */
+static unsigned short crcslice [8][256];
+static pthread_once_t crcsliceOnce = PTHREAD_ONCE_INIT;
+
+
 /*******************************************************************************
 **
-** Function         crcChecksumCompute
+** Function         crcSliceInit
 **
-** Description      Compute a checksum on a buffer of data.
+** Description      Build the slicing-by-8 tables from crctab.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void crcSliceInit ()
+{
+    memcpy (crcslice[0], crctab, sizeof(crctab));
+    for (int k = 1; k < 8; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            unsigned short crc = crcslice[k-1][i];
+            crcslice[k][i] = ((crc >> 8) & 0xff) ^ crctab[crc & 0xff];
+        }
+    }
+}
+
+
+/*******************************************************************************
+**
+** Function         crcChecksumUpdate
+**
+** Description      Continue a checksum over more data. Start with crc = 0;
+**                  the result equals crcChecksumCompute over all the data.
+**                  Eight bytes are folded per step using the slicing tables.
 **
 ** Returns          2-byte checksum.
 **
 *******************************************************************************/
-unsigned short crcChecksumCompute (const unsigned char *buffer, int bufferLen)
+unsigned short crcChecksumUpdate (unsigned short crc, const unsigned char *buffer, int bufferLen)
 {
-    register unsigned short crc = 0;
-    const register unsigned char  *cp = buffer;
-    register          int   cnt = bufferLen;
+    const unsigned char *cp = buffer;
+    int cnt = bufferLen;
 
-    while (cnt--)
+    pthread_once (&crcsliceOnce, crcSliceInit);
+
+    while (cnt >= 8)
+    {
+        unsigned short x = crc ^ (cp[0] | (cp[1] << 8));
+        crc = crcslice[7][x & 0xff] ^ crcslice[6][x >> 8] ^
+              crcslice[5][cp[2]]    ^ crcslice[4][cp[3]] ^
+              crcslice[3][cp[4]]    ^ crcslice[2][cp[5]] ^
+              crcslice[1][cp[6]]    ^ crcslice[0][cp[7]];
+        cp += 8;
+        cnt -= 8;
+    }
+    while (cnt-- > 0)
     {
         crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
     }
@@ -85,11 +129,28 @@ unsigned short crcChecksumCompute (const unsigned char *buffer, int bufferLen)
 }
 
 
+/*******************************************************************************
+**
+** Function         crcChecksumCompute
+**
+** Description      Compute a checksum on a buffer of data.
+**
+** Returns          2-byte checksum.
+**
+*******************************************************************************/
+unsigned short crcChecksumCompute (const unsigned char *buffer, int bufferLen)
+{
+    return crcChecksumUpdate (0, buffer, bufferLen);
+}
+
+
 /*******************************************************************************
 **
 ** Function         crcChecksumVerifyIntegrity
 **
 ** Description      Detect any corruption in a file by computing a checksum.
+**                  The file is mapped into memory when possible, otherwise
+**                  it is read and checksummed a block at a time.
 **                  filename: file name.
 **
 ** Returns          True if file is good.
@@ -103,22 +164,44 @@ BOOLEAN crcChecksumVerifyIntegrity (const char* filename)
     if (fileStream >= 0)
     {
         unsigned short checksum = 0;
-        std::string data;
-        size_t actualReadCrc = read (fileStream, &checksum, sizeof(checksum));
-        while (true)
+        unsigned short crc = 0;
+        size_t actualReadCrc = 0;
+        size_t dataSize = 0;
+        struct stat st;
+        void* map = MAP_FAILED;
+
+        if ((fstat (fileStream, &st) == 0) && (st.st_size > (off_t) sizeof(checksum)))
+            map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileStream, 0);
+
+        if (map != MAP_FAILED)
         {
-            char buffer [1024];
-            ssize_t actualReadData = read (fileStream, buffer, sizeof(buffer));
-            if (actualReadData > 0)
-                data.append (buffer, actualReadData);
-            else
-                break;
+            actualReadCrc = sizeof(checksum);
+            memcpy (&checksum, map, sizeof(checksum));
+            dataSize = st.st_size - sizeof(checksum);
+            crc = crcChecksumUpdate (0, (const unsigned char*) map + sizeof(checksum), dataSize);
+            munmap (map, st.st_size);
+        }
+        else
+        {
+            actualReadCrc = read (fileStream, &checksum, sizeof(checksum));
+            while (true)
+            {
+                unsigned char buffer [1024];
+                ssize_t actualReadData = read (fileStream, buffer, sizeof(buffer));
+                if (actualReadData > 0)
+                {
+                    crc = crcChecksumUpdate (crc, buffer, actualReadData);
+                    dataSize += actualReadData;
+                }
+                else
+                    break;
+            }
         }
         close (fileStream);
-        if ((actualReadCrc == sizeof(checksum)) && (data.size() > 0))
+        if ((actualReadCrc == sizeof(checksum)) && (dataSize > 0))
         {
-            ALOGD ("%s: data size=%u", __FUNCTION__, data.size());
-            if (checksum == crcChecksumCompute ((const unsigned char*) data.data(), data.size()))
+            ALOGD ("%s: data size=%u", __FUNCTION__, dataSize);
+            if (checksum == crc)
                 isGood = TRUE;
             else
                 ALOGE ("%s: checksum mismatch", __FUNCTION__);
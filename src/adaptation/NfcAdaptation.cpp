@@ -25,6 +25,7 @@ extern "C"
 }
 #include "config.h"
 #include "android_logmsg.h"
+#include "NvStore.h"
 
 #define LOG_TAG "NfcAdaptation"
 
@@ -49,6 +50,7 @@ char nci_hal_module[64];
 static UINT8 nfa_dm_cfg[sizeof ( tNFA_DM_CFG ) ];
 extern tNFA_DM_CFG *p_nfa_dm_cfg;
 extern UINT8 nfa_ee_max_ee_cfg;
+extern UINT16 ce_t4t_max_reg_aid_cfg;
 extern const UINT8  nfca_version_string [];
 extern const UINT8  nfa_version_string [];
 static UINT8 deviceHostWhiteList [NFA_HCI_MAX_HOST_IN_NETWORK];
@@ -142,6 +144,12 @@ void NfcAdaptation::Initialize ()
         ALOGD("%s: Overriding NFA_EE_MAX_EE_SUPPORTED to use %d", func, nfa_ee_max_ee_cfg);
     }
 
+    if ( GetNumValue ( NAME_CE_T4T_MAX_REG_AID, &num, sizeof ( num ) ) )
+    {
+        ce_t4t_max_reg_aid_cfg = num;
+        ALOGD("%s: Overriding CE_T4T_MAX_REG_AID to use %d", func, ce_t4t_max_reg_aid_cfg);
+    }
+
     //configure device host whitelist of HCI host ID's; see specification ETSI TS 102 622 V11.1.10
     //(2012-10), section 6.1.3.1
     num = GetStrValue ( NAME_DEVICE_HOST_WHITE_LIST, (char*) deviceHostWhiteList, sizeof ( deviceHostWhiteList ) );
@@ -195,6 +203,7 @@ void NfcAdaptation::Finalize()
     AutoThreadMutex  a(sLock);
 
     ALOGD ("%s: enter", func);
+    nvStoreFlush ();
     GKI_shutdown ();
 
     resetConfig();
@@ -0,0 +1,602 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Non-volatile store I/O thread.  Reads and writes of the NV store files
+ *  run here instead of on the calling task.  A write is held back for
+ *  NV_STORE_COALESCE_MS so that repeated writes of the same file are written
+ *  out once, and a write that matches what is already stored is dropped.
+ *  Files are replaced via a temporary file and rename(), so a crash leaves
+ *  either the old or the new content, never a torn file.
+ *
+ ******************************************************************************/
+#include "OverrideLog.h"
+#include "data_types.h"
+#include "NvStore.h"
+#include "CrcChecksum.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#define LOG_TAG "NfcNciHal"
+
+
+/* How long a write is held back to collapse it with later writes of the same file */
+#ifndef NV_STORE_COALESCE_MS
+#define NV_STORE_COALESCE_MS    100
+#endif
+
+/* Number of files whose content is tracked */
+#ifndef NV_STORE_MAX_FILES
+#define NV_STORE_MAX_FILES      16
+#endif
+
+/* Number of reads that can be queued */
+#ifndef NV_STORE_MAX_READS
+#define NV_STORE_MAX_READS      8
+#endif
+
+#define NV_STORE_MAX_NAME       256
+
+/* Content of one file: pending write, or a copy of what is stored */
+typedef struct
+{
+    char        name [NV_STORE_MAX_NAME];
+    UINT8       *p_data;        /* NULL if the content is unknown */
+    UINT16      len;
+    BOOLEAN     is_pending;     /* p_data still has to be written */
+    UINT32      due_ms;         /* when the pending write goes out */
+    UINT32      gen;            /* bumped on every accepted write */
+} tNV_STORE_FILE;
+
+typedef struct
+{
+    char                    name [NV_STORE_MAX_NAME];
+    UINT8                   *p_buf;
+    UINT16                  len;
+    UINT8                   block;
+    tNV_STORE_READ_CBACK    *p_cback;
+} tNV_STORE_READ;
+
+typedef struct
+{
+    pthread_mutex_t     mutex;
+    pthread_cond_t      work_cond;      /* worker waits for work */
+    pthread_cond_t      done_cond;      /* flush waits for the worker */
+    tNV_STORE_FILE      files [NV_STORE_MAX_FILES];
+    tNV_STORE_READ      reads [NV_STORE_MAX_READS];
+    UINT8               read_first;
+    UINT8               read_count;
+    UINT8               num_pending;
+    UINT8               num_flushers;
+    BOOLEAN             is_busy;        /* worker is doing I/O without the lock */
+
+    /* statistics */
+    UINT32              writes_requested;
+    UINT32              writes_done;
+    UINT32              writes_failed;
+    UINT32              writes_coalesced;
+    UINT32              writes_unchanged;
+    UINT32              bytes_avoided;
+} tNV_STORE_CB;
+
+static tNV_STORE_CB nv_store_cb;
+static pthread_once_t nv_store_once = PTHREAD_ONCE_INIT;
+static BOOLEAN nv_store_started = FALSE;
+
+static void *nvStoreThread (void *arg);
+
+
+/*******************************************************************************
+**
+** Function         nvStoreTimeMs
+**
+** Description      Read the monotonic clock.
+**
+** Returns          Time in milliseconds.
+**
+*******************************************************************************/
+static UINT32 nvStoreTimeMs ()
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (UINT32) (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreInit
+**
+** Description      Initialize the control block and start the NV I/O thread.
+**
+** Returns          none
+**
+*******************************************************************************/
+static void nvStoreInit ()
+{
+    pthread_condattr_t attr;
+    pthread_attr_t thread_attr;
+    pthread_t thread;
+
+    memset (&nv_store_cb, 0, sizeof(nv_store_cb));
+    pthread_mutex_init (&nv_store_cb.mutex, NULL);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&nv_store_cb.work_cond, &attr);
+    pthread_cond_init (&nv_store_cb.done_cond, &attr);
+    pthread_condattr_destroy (&attr);
+
+    pthread_attr_init (&thread_attr);
+    pthread_attr_setdetachstate (&thread_attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create (&thread, &thread_attr, nvStoreThread, NULL) == 0)
+        nv_store_started = TRUE;
+    else
+        ALOGE ("%s: fail to create thread, error = %d", __FUNCTION__, errno);
+    pthread_attr_destroy (&thread_attr);
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreFind
+**
+** Description      Find the entry of a file.  Caller holds the mutex.
+**
+** Returns          Entry, or NULL if the file is not tracked.
+**
+*******************************************************************************/
+static tNV_STORE_FILE *nvStoreFind (const char *filename)
+{
+    for (int xx = 0; xx < NV_STORE_MAX_FILES; xx++)
+    {
+        if (nv_store_cb.files[xx].name[0] && (strcmp (nv_store_cb.files[xx].name, filename) == 0))
+            return &nv_store_cb.files[xx];
+    }
+    return NULL;
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreAlloc
+**
+** Description      Get an entry for a file, reusing one that has nothing
+**                  pending if the table is full.  Caller holds the mutex.
+**
+** Returns          Entry, or NULL if every entry has a pending write.
+**
+*******************************************************************************/
+static tNV_STORE_FILE *nvStoreAlloc (const char *filename)
+{
+    tNV_STORE_FILE *p_free = NULL;
+
+    for (int xx = 0; xx < NV_STORE_MAX_FILES; xx++)
+    {
+        tNV_STORE_FILE *p_file = &nv_store_cb.files[xx];
+        if (p_file->name[0] == 0)
+        {
+            p_free = p_file;
+            break;
+        }
+        if ((p_free == NULL) && !p_file->is_pending)
+            p_free = p_file;
+    }
+
+    if (p_free)
+    {
+        free (p_free->p_data);
+        memset (p_free, 0, sizeof(*p_free));
+        strncpy (p_free->name, filename, NV_STORE_MAX_NAME - 1);
+    }
+    return p_free;
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreWriteFile
+**
+** Description      Write a checksum and the data to a temporary file, sync it
+**                  and rename it over the file.
+**
+** Returns          TRUE if the file was replaced.
+**
+*******************************************************************************/
+static BOOLEAN nvStoreWriteFile (const char *filename, const UINT8 *p_data, UINT16 len)
+{
+    char tmp [NV_STORE_MAX_NAME + 8];
+    BOOLEAN isWritten;
+
+    snprintf (tmp, sizeof(tmp), "%s.tmp", filename);
+    int fileStream = open (tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fileStream < 0)
+    {
+        ALOGE ("%s: fail to open, error = %d", __FUNCTION__, errno);
+        return FALSE;
+    }
+
+    unsigned short checksum = crcChecksumCompute (p_data, len);
+    isWritten = (write (fileStream, &checksum, sizeof(checksum)) == sizeof(checksum))
+             && (write (fileStream, p_data, len) == len)
+             && (fsync (fileStream) == 0);
+    close (fileStream);
+
+    if (!isWritten || (rename (tmp, filename) != 0))
+    {
+        ALOGE ("%s: fail to write %s, error = %d", __FUNCTION__, filename, errno);
+        remove (tmp);
+        return FALSE;
+    }
+    ALOGD ("%s: %u bytes written to %s", __FUNCTION__, len, filename);
+    return TRUE;
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreReadFile
+**
+** Description      Read a file into the caller's buffer.  If the whole file
+**                  fit, remember its content so that writing it back
+**                  unchanged can be skipped.
+**
+** Returns          none
+**
+*******************************************************************************/
+static void nvStoreReadFile (tNV_STORE_READ *p_read)
+{
+    struct stat st;
+    ssize_t actualReadData = 0;
+    UINT16 dataLen = 0;
+
+    int fileStream = open (p_read->name, O_RDONLY);
+    if (fileStream >= 0)
+    {
+        unsigned short checksum = 0;
+        if (read (fileStream, &checksum, sizeof(checksum)) == sizeof(checksum))
+            actualReadData = read (fileStream, p_read->p_buf, p_read->len);
+        if ((actualReadData > 0) && (fstat (fileStream, &st) == 0)
+            && (st.st_size == (off_t) (sizeof(checksum) + actualReadData)))
+            dataLen = (UINT16) actualReadData;
+        close (fileStream);
+    }
+    else
+        ALOGD ("%s: fail to open %s", __FUNCTION__, p_read->name);
+
+    if (dataLen > 0)
+    {
+        pthread_mutex_lock (&nv_store_cb.mutex);
+        tNV_STORE_FILE *p_file = nvStoreFind (p_read->name);
+        if (p_file == NULL)
+            p_file = nvStoreAlloc (p_read->name);
+        if (p_file && (p_file->p_data == NULL))
+        {
+            if ((p_file->p_data = (UINT8 *) malloc (dataLen)) != NULL)
+            {
+                memcpy (p_file->p_data, p_read->p_buf, dataLen);
+                p_file->len = dataLen;
+            }
+        }
+        pthread_mutex_unlock (&nv_store_cb.mutex);
+    }
+
+    if (actualReadData > 0)
+        (*p_read->p_cback) ((UINT16) actualReadData, TRUE, p_read->block);
+    else
+        (*p_read->p_cback) (0, FALSE, p_read->block);
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreThread
+**
+** Description      NV I/O thread.  Serves queued reads first, then writes out
+**                  pending writes once they are due (or at once when a flush
+**                  is waiting).
+**
+** Returns          none
+**
+*******************************************************************************/
+static void *nvStoreThread (void *arg)
+{
+    tNV_STORE_READ req;
+    char name [NV_STORE_MAX_NAME];
+
+    pthread_mutex_lock (&nv_store_cb.mutex);
+    for (;;)
+    {
+        if (nv_store_cb.read_count > 0)
+        {
+            req = nv_store_cb.reads[nv_store_cb.read_first];
+            nv_store_cb.read_first = (nv_store_cb.read_first + 1) % NV_STORE_MAX_READS;
+            nv_store_cb.read_count--;
+
+            /* read back a write that has not gone out yet */
+            tNV_STORE_FILE *p_file = nvStoreFind (req.name);
+            if (p_file && p_file->is_pending)
+            {
+                UINT16 len = (p_file->len < req.len) ? p_file->len : req.len;
+                memcpy (req.p_buf, p_file->p_data, len);
+                nv_store_cb.is_busy = TRUE;
+                pthread_mutex_unlock (&nv_store_cb.mutex);
+                (*req.p_cback) (len, (len > 0), req.block);
+            }
+            else
+            {
+                nv_store_cb.is_busy = TRUE;
+                pthread_mutex_unlock (&nv_store_cb.mutex);
+                nvStoreReadFile (&req);
+            }
+            pthread_mutex_lock (&nv_store_cb.mutex);
+            nv_store_cb.is_busy = FALSE;
+            continue;
+        }
+
+        /* find the pending write that is due first */
+        UINT32 now = nvStoreTimeMs ();
+        tNV_STORE_FILE *p_next = NULL;
+        for (int xx = 0; xx < NV_STORE_MAX_FILES; xx++)
+        {
+            tNV_STORE_FILE *p_file = &nv_store_cb.files[xx];
+            if (p_file->is_pending && ((p_next == NULL) || ((INT32) (p_file->due_ms - p_next->due_ms) < 0)))
+                p_next = p_file;
+        }
+
+        if (p_next && ((nv_store_cb.num_flushers > 0) || ((INT32) (p_next->due_ms - now) <= 0)))
+        {
+            UINT32 gen = p_next->gen;
+            UINT16 len = p_next->len;
+            UINT8 *p_copy = (UINT8 *) malloc (len ? len : 1);
+
+            if (p_copy == NULL)
+            {
+                /* try again later */
+                p_next->due_ms = now + NV_STORE_COALESCE_MS;
+                continue;
+            }
+            memcpy (p_copy, p_next->p_data, len);
+            strncpy (name, p_next->name, sizeof(name));
+            p_next->is_pending = FALSE;
+            nv_store_cb.num_pending--;
+            nv_store_cb.is_busy = TRUE;
+            pthread_mutex_unlock (&nv_store_cb.mutex);
+
+            BOOLEAN isWritten = nvStoreWriteFile (name, p_copy, len);
+            free (p_copy);
+
+            pthread_mutex_lock (&nv_store_cb.mutex);
+            nv_store_cb.is_busy = FALSE;
+            if (isWritten)
+                nv_store_cb.writes_done++;
+            else
+            {
+                nv_store_cb.writes_failed++;
+                /* what is stored is unknown now, so never skip the next write */
+                tNV_STORE_FILE *p_file = nvStoreFind (name);
+                if (p_file && !p_file->is_pending && (p_file->gen == gen))
+                {
+                    free (p_file->p_data);
+                    p_file->p_data = NULL;
+                    p_file->len = 0;
+                }
+            }
+            continue;
+        }
+
+        if (nv_store_cb.num_flushers > 0)
+            pthread_cond_broadcast (&nv_store_cb.done_cond);
+
+        if (p_next)
+        {
+            struct timespec deadline;
+            UINT32 wait_ms = p_next->due_ms - now;
+            clock_gettime (CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += wait_ms / 1000;
+            deadline.tv_nsec += (wait_ms % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait (&nv_store_cb.work_cond, &nv_store_cb.mutex, &deadline);
+        }
+        else
+            pthread_cond_wait (&nv_store_cb.work_cond, &nv_store_cb.mutex);
+    }
+    return NULL;
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreRead
+**
+** Description      Queue a read of a non-volatile store file.
+**
+** Returns          none
+**
+*******************************************************************************/
+void nvStoreRead (const char* filename, UINT8* buffer, UINT16 bufferLen, UINT8 block, tNV_STORE_READ_CBACK* p_cback)
+{
+    pthread_once (&nv_store_once, nvStoreInit);
+    ALOGD ("%s: buffer len=%u; file=%s", __FUNCTION__, bufferLen, filename);
+
+    pthread_mutex_lock (&nv_store_cb.mutex);
+    if (nv_store_started && (nv_store_cb.read_count < NV_STORE_MAX_READS))
+    {
+        tNV_STORE_READ *p_read = &nv_store_cb.reads[(nv_store_cb.read_first + nv_store_cb.read_count) % NV_STORE_MAX_READS];
+        strncpy (p_read->name, filename, NV_STORE_MAX_NAME - 1);
+        p_read->name[NV_STORE_MAX_NAME - 1] = 0;
+        p_read->p_buf = buffer;
+        p_read->len = bufferLen;
+        p_read->block = block;
+        p_read->p_cback = p_cback;
+        nv_store_cb.read_count++;
+        pthread_cond_signal (&nv_store_cb.work_cond);
+        pthread_mutex_unlock (&nv_store_cb.mutex);
+        return;
+    }
+    pthread_mutex_unlock (&nv_store_cb.mutex);
+
+    /* no thread or queue full: read on the caller's task */
+    ALOGE ("%s: cannot queue, reading %s directly", __FUNCTION__, filename);
+    nvStoreFlush ();
+    tNV_STORE_READ req;
+    strncpy (req.name, filename, NV_STORE_MAX_NAME - 1);
+    req.name[NV_STORE_MAX_NAME - 1] = 0;
+    req.p_buf = buffer;
+    req.len = bufferLen;
+    req.block = block;
+    req.p_cback = p_cback;
+    nvStoreReadFile (&req);
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreWrite
+**
+** Description      Queue a write of a non-volatile store file.
+**
+** Returns          TRUE if the write was queued (or done).
+**
+*******************************************************************************/
+BOOLEAN nvStoreWrite (const char* filename, const UINT8* buffer, UINT16 bufferLen)
+{
+    pthread_once (&nv_store_once, nvStoreInit);
+    ALOGD ("%s: bytes=%u; file=%s", __FUNCTION__, bufferLen, filename);
+
+    if (strlen (filename) >= NV_STORE_MAX_NAME)
+    {
+        ALOGE ("%s: filename too long", __FUNCTION__);
+        return FALSE;
+    }
+
+    pthread_mutex_lock (&nv_store_cb.mutex);
+    nv_store_cb.writes_requested++;
+
+    tNV_STORE_FILE *p_file = nvStoreFind (filename);
+    if (p_file && p_file->p_data && (p_file->len == bufferLen)
+        && (memcmp (p_file->p_data, buffer, bufferLen) == 0))
+    {
+        /* same as what is stored, or about to be */
+        nv_store_cb.writes_unchanged++;
+        nv_store_cb.bytes_avoided += bufferLen;
+        pthread_mutex_unlock (&nv_store_cb.mutex);
+        return TRUE;
+    }
+
+    if (p_file == NULL)
+        p_file = nvStoreAlloc (filename);
+
+    UINT8 *p_data = (nv_store_started && p_file) ? (UINT8 *) malloc (bufferLen ? bufferLen : 1) : NULL;
+    if (p_data == NULL)
+    {
+        /* nowhere to hold it: write it on the caller's task */
+        pthread_mutex_unlock (&nv_store_cb.mutex);
+        ALOGE ("%s: cannot queue, writing %s directly", __FUNCTION__, filename);
+        nvStoreFlush ();
+        BOOLEAN isWritten = nvStoreWriteFile (filename, buffer, bufferLen);
+        pthread_mutex_lock (&nv_store_cb.mutex);
+        if (isWritten)
+            nv_store_cb.writes_done++;
+        else
+            nv_store_cb.writes_failed++;
+        if ((p_file = nvStoreFind (filename)) != NULL)
+        {
+            free (p_file->p_data);
+            p_file->p_data = NULL;
+            p_file->len = 0;
+        }
+        pthread_mutex_unlock (&nv_store_cb.mutex);
+        return isWritten;
+    }
+
+    memcpy (p_data, buffer, bufferLen);
+    free (p_file->p_data);
+    p_file->p_data = p_data;
+    p_file->len = bufferLen;
+    p_file->gen++;
+    if (p_file->is_pending)
+    {
+        /* replaces a write that has not gone out yet */
+        nv_store_cb.writes_coalesced++;
+        nv_store_cb.bytes_avoided += bufferLen;
+    }
+    else
+    {
+        p_file->is_pending = TRUE;
+        p_file->due_ms = nvStoreTimeMs () + NV_STORE_COALESCE_MS;
+        nv_store_cb.num_pending++;
+        pthread_cond_signal (&nv_store_cb.work_cond);
+    }
+    pthread_mutex_unlock (&nv_store_cb.mutex);
+    return TRUE;
+}
+
+
+/*******************************************************************************
+**
+** Function         nvStoreFlush
+**
+** Description      Write out all pending writes and wait until the NV I/O
+**                  thread is idle.  The remembered file content is dropped,
+**                  since the caller may change the files directly.
+**
+** Returns          none
+**
+*******************************************************************************/
+void nvStoreFlush (void)
+{
+    pthread_once (&nv_store_once, nvStoreInit);
+
+    pthread_mutex_lock (&nv_store_cb.mutex);
+    if (nv_store_started)
+    {
+        nv_store_cb.num_flushers++;
+        pthread_cond_signal (&nv_store_cb.work_cond);
+        while ((nv_store_cb.num_pending > 0) || (nv_store_cb.read_count > 0) || nv_store_cb.is_busy)
+            pthread_cond_wait (&nv_store_cb.done_cond, &nv_store_cb.mutex);
+        nv_store_cb.num_flushers--;
+    }
+
+    for (int xx = 0; xx < NV_STORE_MAX_FILES; xx++)
+    {
+        tNV_STORE_FILE *p_file = &nv_store_cb.files[xx];
+        if (!p_file->is_pending)
+        {
+            free (p_file->p_data);
+            memset (p_file, 0, sizeof(*p_file));
+        }
+    }
+
+    ALOGD ("%s: writes requested=%lu; written=%lu; failed=%lu; coalesced=%lu; unchanged=%lu; bytes avoided=%lu",
+            __FUNCTION__, (unsigned long) nv_store_cb.writes_requested, (unsigned long) nv_store_cb.writes_done,
+            (unsigned long) nv_store_cb.writes_failed, (unsigned long) nv_store_cb.writes_coalesced, (unsigned long) nv_store_cb.writes_unchanged,
+            (unsigned long) nv_store_cb.bytes_avoided);
+    pthread_mutex_unlock (&nv_store_cb.mutex);
+}
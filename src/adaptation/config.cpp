@@ -17,10 +17,18 @@
  ******************************************************************************/
 #include "OverrideLog.h"
 #include "config.h"
+#include "CrcChecksum.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <string>
 #include <vector>
 #include <list>
+#include <algorithm>
 
 #define LOG_TAG "NfcAdaptation"
 
@@ -31,6 +39,14 @@ const char transport_config_path[] = "/etc/";
 #define extra_config_ext        ".conf"
 #define     IsStringValue       0x80000000
 
+/* the parsed base config file is saved here and mapped on the next start
+ * instead of parsing the file again, as long as the file is unchanged */
+#ifndef config_snapshot_path
+#define config_snapshot_path    default_storage_location "/libnfc-brcm-stack.cache"
+#endif
+#define config_snapshot_magic   0x4643464e  /* "NFCF" */
+#define config_snapshot_version 3
+
 using namespace::std;
 
 class CNfcParam : public string
@@ -41,11 +57,13 @@ public:
     CNfcParam(const char* name, unsigned long value);
     virtual ~CNfcParam();
     unsigned long numValue() const {return m_numValue;}
+    unsigned long intValue() const {return m_intValue;}
     const char*   str_value() const {return m_str_value.c_str();}
     size_t        str_len() const   {return m_str_value.length();}
 private:
     string          m_str_value;
     unsigned long   m_numValue;
+    unsigned long   m_intValue;     // value returned by GetNumValue(), computed once
 };
 
 class CNfcConfig : public vector<const CNfcParam*>
@@ -63,6 +81,8 @@ public:
 private:
     CNfcConfig();
     bool    readConfig(const char* name, bool bResetContent);
+    bool    readSnapshot(const char* name);
+    void    writeSnapshot(const char* name) const;
     void    moveFromList();
     void    moveToList();
     void    add(const CNfcParam* pParam);
@@ -161,6 +181,8 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent)
     };
 
     FILE*   fd = NULL;
+    string  buf;
+    size_t  pos = 0;
     string  token;
     string  strValue;
     unsigned long    numValue = 0;
@@ -192,9 +214,20 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent)
             moveToList();
     }
 
+    // read the whole file with as few reads as possible, then parse from memory
+    {
+        char    chunk[4096];
+        size_t  n;
+        while ((n = fread(chunk, 1, sizeof(chunk), fd)) > 0)
+            buf.append(chunk, n);
+    }
+    fclose(fd);
+
     for (;;)
     {
-        if (feof(fd) || fread(&c, 1, 1, fd) != 1)
+        if (pos < buf.size())
+            c = buf[pos++];
+        else
         {
             if (state == BEGIN_LINE)
                 break;
@@ -203,6 +236,7 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent)
             // probably does not end with a newline, so the parser has
             // not processed current line, simulate a newline in the file
             c = '\n';
+            ++pos;
         }
 
         switch (state & 0xff)
@@ -340,16 +374,202 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent)
             break;
         }
 
-        if (feof(fd))
+        if (pos > buf.size())
             break;
     }
 
-    fclose(fd);
-
     moveFromList();
     return size() > 0;
 }
 
+/* layout of the config snapshot file: a header, then one record per setting,
+ * each followed by the name and the string value, in the order of the setting array.
+ * Fixed-width fields, padded explicitly, so 32- and 64-bit processes agree.
+ * System images have fixed timestamps, so the checksum of the config file is kept
+ * to catch a change that leaves its size and mtime alone */
+struct tCONFIG_SNAPSHOT_HDR
+{
+    uint32_t        magic;
+    uint16_t        version;
+    uint16_t        hdr_size;       // sizeof(tCONFIG_SNAPSHOT_HDR)
+    uint16_t        rec_size;       // sizeof(tCONFIG_SNAPSHOT_REC)
+    uint16_t        src_crc;        // checksum of the config file it was made from
+    uint32_t        count;          // number of records
+    uint64_t        src_size;       // size of the config file it was made from
+    int64_t         src_mtime;      // modification time of the config file
+};
+
+struct tCONFIG_SNAPSHOT_REC
+{
+    uint64_t        num_value;
+    uint16_t        name_len;
+    uint16_t        str_len;        // 0 for a numerical setting
+    uint32_t        reserved;
+};
+
+/*******************************************************************************
+**
+** Function:    configFileChecksum()
+**
+** Description: compute the checksum of the content of a config file
+**
+** Returns:     true if the file could be read
+**
+*******************************************************************************/
+static bool configFileChecksum(const char* name, off_t size, uint16_t* pCrc)
+{
+    int     fd;
+    void*   p_map;
+
+    if (size <= 0 || (fd = open(name, O_RDONLY)) < 0)
+        return false;
+    p_map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_map == MAP_FAILED)
+        return false;
+    *pCrc = crcChecksumCompute((const unsigned char*)p_map, (int)size);
+    munmap(p_map, size);
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::readSnapshot()
+**
+** Description: load the settings of a config file from its snapshot, if the
+**              snapshot exists and was made from the current file
+**
+** Returns:     true if the settings were loaded
+**
+*******************************************************************************/
+bool CNfcConfig::readSnapshot(const char* name)
+{
+    struct stat src, st;
+    const char* path = config_snapshot_path;
+    int     fd;
+    void*   p_map;
+    bool    ok = true;
+    uint16_t crc;
+
+    if (stat(name, &src) != 0 || !configFileChecksum(name, src.st_size, &crc))
+        return false;
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return false;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(tCONFIG_SNAPSHOT_HDR) ||
+        (p_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    const unsigned char* p = (const unsigned char*)p_map;
+    const unsigned char* p_end = p + st.st_size;
+    tCONFIG_SNAPSHOT_HDR hdr;
+    vector<const CNfcParam*> params;
+    memcpy(&hdr, p, sizeof(hdr));
+    p += sizeof(hdr);
+    if (hdr.magic != config_snapshot_magic || hdr.version != config_snapshot_version ||
+        hdr.hdr_size != sizeof(tCONFIG_SNAPSHOT_HDR) || hdr.rec_size != sizeof(tCONFIG_SNAPSHOT_REC) ||
+        hdr.src_size != (uint64_t)src.st_size || hdr.src_mtime != (int64_t)src.st_mtime ||
+        hdr.src_crc != crc)
+        ok = false;
+
+    // settings are parsed aside, so the current ones are kept if the snapshot is bad
+    for (uint32_t i = 0; ok && i < hdr.count; ++i)
+    {
+        tCONFIG_SNAPSHOT_REC rec;
+        if (p + sizeof(rec) > p_end)
+        {
+            ok = false;
+            break;
+        }
+        memcpy(&rec, p, sizeof(rec));
+        p += sizeof(rec);
+        if (p + rec.name_len + rec.str_len > p_end)
+        {
+            ok = false;
+            break;
+        }
+        string paramName((const char*)p, rec.name_len);
+        p += rec.name_len;
+        if (rec.str_len > 0)
+            params.push_back(new CNfcParam(paramName.c_str(), string((const char*)p, rec.str_len)));
+        else
+            params.push_back(new CNfcParam(paramName.c_str(), (unsigned long)rec.num_value));
+        p += rec.str_len;
+    }
+    munmap(p_map, st.st_size);
+
+    if (!ok || p != p_end || params.size() == 0)
+    {
+        for (vector<const CNfcParam*>::iterator it = params.begin(); it != params.end(); ++it)
+            delete *it;
+        return false;
+    }
+    clean();
+    insert(end(), params.begin(), params.end());
+    mValidFile = true;
+    ALOGD("%s loaded %zu settings from %s\n", __func__, size(), path);
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::writeSnapshot()
+**
+** Description: save the settings just read from a config file to its
+**              snapshot; failures are ignored
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::writeSnapshot(const char* name) const
+{
+    struct stat src;
+    const char* path = config_snapshot_path;
+    string  tmpPath;
+    string  data;
+    uint16_t crc;
+
+    if (stat(name, &src) != 0 || !configFileChecksum(name, src.st_size, &crc))
+        return;
+
+    tCONFIG_SNAPSHOT_HDR hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic       = config_snapshot_magic;
+    hdr.version     = config_snapshot_version;
+    hdr.hdr_size    = sizeof(tCONFIG_SNAPSHOT_HDR);
+    hdr.rec_size    = sizeof(tCONFIG_SNAPSHOT_REC);
+    hdr.count       = size();
+    hdr.src_size    = src.st_size;
+    hdr.src_mtime   = src.st_mtime;
+    hdr.src_crc     = crc;
+    data.append((const char*)&hdr, sizeof(hdr));
+    for (const_iterator it = begin(), itEnd = end(); it != itEnd; ++it)
+    {
+        tCONFIG_SNAPSHOT_REC rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.num_value   = (*it)->numValue();
+        rec.name_len    = (*it)->length();
+        rec.str_len     = (*it)->str_len();
+        data.append((const char*)&rec, sizeof(rec));
+        data.append((*it)->c_str(), rec.name_len);
+        data.append((*it)->str_value(), rec.str_len);
+    }
+
+    // write a temporary file and rename it, so a reader never sees a partial snapshot
+    tmpPath.assign(path);
+    tmpPath += ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+        return;
+    bool ok = (write(fd, data.data(), data.size()) == (ssize_t)data.size());
+    close(fd);
+    if (!ok || rename(tmpPath.c_str(), path) != 0)
+        remove(tmpPath.c_str());
+}
+
 /*******************************************************************************
 **
 ** Function:    CNfcConfig::CNfcConfig()
@@ -396,7 +616,9 @@ CNfcConfig& CNfcConfig::GetInstance()
         string strPath;
         strPath.assign(transport_config_path);
         strPath += config_name;
-        theInstance.readConfig(strPath.c_str(), true);
+        if (!theInstance.readSnapshot(strPath.c_str()) &&
+            theInstance.readConfig(strPath.c_str(), true))
+            theInstance.writeSnapshot(strPath.c_str());
     }
 
     return theInstance;
@@ -477,35 +699,37 @@ bool CNfcConfig::getValue(const char* name, unsigned short& rValue) const
     return false;
 }
 
+/*******************************************************************************
+**
+** Function:    paramLess()
+**
+** Description: order a setting object against a setting name
+**
+** Returns:     true if the setting sorts before the name
+**
+*******************************************************************************/
+static bool paramLess(const CNfcParam* pParam, const char* p_name)
+{
+    return *pParam < p_name;
+}
+
 /*******************************************************************************
 **
 ** Function:    CNfcConfig::find()
 **
-** Description: search if a setting exist in the setting array
+** Description: search if a setting exist in the setting array, using
+**              a binary search. Lookups are not logged; the settings are
+**              logged once when they are read.
 **
 ** Returns:     pointer to the setting object
 **
 *******************************************************************************/
 const CNfcParam* CNfcConfig::find(const char* p_name) const
 {
-    if (size() == 0)
-        return NULL;
-
-    for (const_iterator it = begin(), itEnd = end(); it != itEnd; ++it)
-    {
-        if (**it < p_name)
-            continue;
-        else if (**it == p_name)
-        {
-            if((*it)->str_len() > 0)
-                ALOGD("%s found %s=%s\n", __func__, p_name, (*it)->str_value());
-            else
-                ALOGD("%s found %s=(0x%lX)\n", __func__, p_name, (*it)->numValue());
-            return *it;
-        }
-        else
-            break;
-    }
+    // the array is sorted by name; with duplicate names the latest one read comes first
+    const_iterator it = lower_bound(begin(), end(), p_name, paramLess);
+    if (it != end() && **it == p_name)
+        return *it;
     return NULL;
 }
 
@@ -539,6 +763,11 @@ void CNfcConfig::clean()
 *******************************************************************************/
 void CNfcConfig::add(const CNfcParam* pParam)
 {
+    if (pParam->str_len() > 0)
+        ALOGD("%s %s=%s\n", __func__, pParam->c_str(), pParam->str_value());
+    else
+        ALOGD("%s %s=(0x%lX)\n", __func__, pParam->c_str(), pParam->numValue());
+
     if (m_list.size() == 0)
     {
         m_list.push_back(pParam);
@@ -602,7 +831,8 @@ void CNfcConfig::moveToList()
 **
 *******************************************************************************/
 CNfcParam::CNfcParam() :
-    m_numValue(0)
+    m_numValue(0),
+    m_intValue(0)
 {
 }
 
@@ -631,8 +861,15 @@ CNfcParam::~CNfcParam()
 CNfcParam::CNfcParam(const char* name,  const string& value) :
     string(name),
     m_str_value(value),
-    m_numValue(0)
+    m_numValue(0),
+    m_intValue(0)
 {
+    // a string of up to 3 bytes can also be read as a big endian number
+    if (value.length() < 4)
+    {
+        for (size_t i = 0 ; i < value.length(); ++i)
+            m_intValue = (m_intValue << 8) | (unsigned char)value[i];
+    }
 }
 
 /*******************************************************************************
@@ -646,7 +883,8 @@ CNfcParam::CNfcParam(const char* name,  const string& value) :
 *******************************************************************************/
 CNfcParam::CNfcParam(const char* name,  unsigned long value) :
     string(name),
-    m_numValue(value)
+    m_numValue(value),
+    m_intValue(value)
 {
 }
 
@@ -687,16 +925,7 @@ extern "C" int GetNumValue(const char* name, void* pValue, unsigned long len)
 
     if (pParam == NULL)
         return false;
-    unsigned long v = pParam->numValue();
-    if (v == 0 && pParam->str_len() > 0 && pParam->str_len() < 4)
-    {
-        const unsigned char* p = (const unsigned char*)pParam->str_value();
-        for (size_t i = 0 ; i < pParam->str_len(); ++i)
-        {
-            v *= 256;
-            v += *p++;
-        }
-    }
+    unsigned long v = pParam->intValue();
     switch (len)
     {
     case sizeof(unsigned long):
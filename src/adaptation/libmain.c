@@ -25,6 +25,7 @@
 #include "config.h"
 #include "nfc_hal_target.h"
 #include "nfc_hal_nv_co.h"
+#include "NvStore.h"
 extern char bcm_nfc_location[];
 static const char* sNfaStorageBin = "/nfaStorage.bin";
 
@@ -61,6 +62,22 @@ extern void nfa_mem_co_free(void *pBuffer)
 }
 
 
+/*******************************************************************************
+**
+** Function         nfa_nv_co_read_done
+**
+** Description      Completion of a read by the NV I/O thread.
+**
+** Returns          none
+**
+*******************************************************************************/
+static void nfa_nv_co_read_done (UINT16 nbytes, BOOLEAN isOk, UINT8 block)
+{
+    ALOGD ("%s: data size=%u", __FUNCTION__, nbytes);
+    nfa_nv_ci_read (nbytes, isOk ? NFA_NV_CO_OK : NFA_NV_CO_FAIL, block);
+}
+
+
 /*******************************************************************************
 **
 ** Function         nfa_nv_co_read
@@ -97,29 +114,7 @@ extern void nfa_nv_co_read(UINT8 *pBuffer, UINT16 nbytes, UINT8 block)
     sprintf (filename, "%s%u", filename2, block);
 
     ALOGD ("%s: buffer len=%u; file=%s", __FUNCTION__, nbytes, filename);
-    int fileStream = open (filename, O_RDONLY);
-    if (fileStream >= 0)
-    {
-        unsigned short checksum = 0;
-        size_t actualReadCrc = read (fileStream, &checksum, sizeof(checksum));
-        size_t actualReadData = read (fileStream, pBuffer, nbytes);
-        close (fileStream);
-        if (actualReadData > 0)
-        {
-            ALOGD ("%s: data size=%zu", __FUNCTION__, actualReadData);
-            nfa_nv_ci_read (actualReadData, NFA_NV_CO_OK, block);
-        }
-        else
-        {
-            ALOGE ("%s: fail to read", __FUNCTION__);
-            nfa_nv_ci_read (0, NFA_NV_CO_FAIL, block);
-        }
-    }
-    else
-    {
-        ALOGD ("%s: fail to open", __FUNCTION__);
-        nfa_nv_ci_read (0, NFA_NV_CO_FAIL, block);
-    }
+    nvStoreRead (filename, pBuffer, nbytes, block, nfa_nv_co_read_done);
 }
 
 /*******************************************************************************
@@ -156,31 +151,10 @@ extern void nfa_nv_co_write(const UINT8 *pBuffer, UINT16 nbytes, UINT8 block)
     sprintf (filename, "%s%u", filename2, block);
     ALOGD ("%s: bytes=%u; file=%s", __FUNCTION__, nbytes, filename);
 
-    int fileStream = 0;
-
-    fileStream = open (filename, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-    if (fileStream >= 0)
-    {
-        unsigned short checksum = crcChecksumCompute (pBuffer, nbytes);
-        size_t actualWrittenCrc = write (fileStream, &checksum, sizeof(checksum));
-        size_t actualWrittenData = write (fileStream, pBuffer, nbytes);
-        ALOGD ("%s: %zu bytes written", __FUNCTION__, actualWrittenData);
-        if ((actualWrittenData == nbytes) && (actualWrittenCrc == sizeof(checksum)))
-        {
-            nfa_nv_ci_write (NFA_NV_CO_OK);
-        }
-        else
-        {
-            ALOGE ("%s: fail to write", __FUNCTION__);
-            nfa_nv_ci_write (NFA_NV_CO_FAIL);
-        }
-        close (fileStream);
-    }
+    if (nvStoreWrite (filename, pBuffer, nbytes))
+        nfa_nv_ci_write (NFA_NV_CO_OK);
     else
-    {
-        ALOGE ("%s: fail to open, error = %d", __FUNCTION__, errno);
         nfa_nv_ci_write (NFA_NV_CO_FAIL);
-    }
 }
 
 /*******************************************************************************
@@ -204,6 +178,7 @@ void delete_stack_non_volatile_store (BOOLEAN forceDelete)
     firstTime = FALSE;
 
     ALOGD ("%s", __FUNCTION__);
+    nvStoreFlush ();
 
     memset (filename, 0, sizeof(filename));
     memset (filename2, 0, sizeof(filename2));
@@ -243,6 +218,7 @@ void verify_stack_non_volatile_store ()
     char filename[256], filename2[256];
     BOOLEAN isValid = FALSE;
 
+    nvStoreFlush ();
     memset (filename, 0, sizeof(filename));
     memset (filename2, 0, sizeof(filename2));
     strcpy(filename2, bcm_nfc_location);
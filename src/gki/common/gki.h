@@ -99,6 +99,21 @@
 #define GKI_MAX_TIMER_QUEUES    3
 #endif
 
+/************************************************************************
+**  Timer list implementation. When TRUE timer lists are kept in a two level
+**  timing wheel (O(1) add/remove) instead of a sorted delta list.
+**/
+#ifndef GKI_TIMER_WHEEL
+#define GKI_TIMER_WHEEL         TRUE
+#endif
+
+/* log2 of the number of slots per wheel level */
+#ifndef GKI_TIMER_WHEEL_BITS
+#define GKI_TIMER_WHEEL_BITS    6
+#endif
+#define GKI_TIMER_WHEEL_SIZE    (1 << GKI_TIMER_WHEEL_BITS)
+#define GKI_TIMER_WHEEL_LEVELS  2
+
 /************************************************************************
 **  Utility macros for timer conversion
 **/
@@ -344,6 +359,10 @@ typedef struct _tle
     TIMER_PARAM_TYPE   param;
     UINT16        event;
     UINT8         in_use;
+#if (GKI_TIMER_WHEEL == TRUE)
+    UINT8         slot;         /* wheel slot holding the entry */
+    UINT32        due;          /* list time at which the entry expires */
+#endif
 } TIMER_LIST_ENT;
 
 /* Define a timer list queue
@@ -353,6 +372,17 @@ typedef struct
     TIMER_LIST_ENT   *p_first;
     TIMER_LIST_ENT   *p_last;
     INT32             last_ticks;
+#if (GKI_TIMER_WHEEL == TRUE)
+    /* p_first/p_last only chain the expired entries. While none has expired
+    ** p_first points to the pending placeholder so that it is non-NULL as
+    ** long as the list is not empty. */
+    UINT32            now;              /* units elapsed since the list was initialized */
+    UINT16            num_pending;      /* entries in the wheel */
+    UINT16            num_expired;      /* entries chained on p_first */
+    TIMER_LIST_ENT    pending;
+    TIMER_LIST_ENT   *p_wheel[GKI_TIMER_WHEEL_LEVELS][GKI_TIMER_WHEEL_SIZE];
+    TIMER_LIST_ENT   *p_overflow;       /* entries beyond the reach of the wheel */
+#endif
 } TIMER_LIST_Q;
 
 
@@ -26,6 +26,7 @@
 static void gki_add_to_pool_list(UINT8 pool_id);
 static void gki_remove_from_pool_list(UINT8 pool_id);
 #endif /*  BTU_STACK_LITE_ENABLED == FALSE */
+static void gki_build_size_class_table(void);
 
 #if GKI_BUFFER_DEBUG
 #define LOG_TAG "GKI_DEBUG"
@@ -70,6 +71,8 @@ static void gki_init_free_queue (UINT8 id, UINT16 size, UINT16 total, void *p_me
     p_cb->freeq[id].total     = total;
     p_cb->freeq[id].cur_cnt   = 0;
     p_cb->freeq[id].max_cnt   = 0;
+    p_cb->freeq[id].avail_cnt = 0;
+    p_cb->freeq[id].cached_cnt = 0;
 
 #if GKI_BUFFER_DEBUG
     LOGD("gki_init_free_queue() init pool=%d, size=%d (aligned=%d) total=%d start=%p", id, size, tempsize, total, p_mem);
@@ -93,6 +96,7 @@ static void gki_init_free_queue (UINT8 id, UINT16 size, UINT16 total, void *p_me
         }
         hdr1->p_next = NULL;
         p_cb->freeq[id].p_last = hdr1;
+        p_cb->freeq[id].avail_cnt = total;
     }
     return;
 }
@@ -106,9 +110,11 @@ static BOOLEAN gki_alloc_free_queue(UINT8 id)
         ALOGD("\ngki_alloc_free_queue in, id:%d \n", id);
     #endif
 
-    Q = &p_cb->freeq[p_cb->pool_list[id]];
+    Q = &p_cb->freeq[id];
 
-    if(Q->p_first == 0)
+    /* The free queue may be legitimately empty while its buffers sit in task
+    ** caches, so only the pool memory tells us whether it was allocated */
+    if(p_cb->pool_start[id] == NULL)
     {
         void* p_mem = GKI_os_malloc((Q->size + BUFFER_PADDING_SIZE) * Q->total);
         if(p_mem)
@@ -152,9 +158,24 @@ void gki_buffer_init(void)
     {
         for (mb = 0; mb < NUM_TASK_MBOX; mb++)
         {
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+            /* an empty lock-free mailbox holds only its placeholder */
+            p_cb->OSTaskQStub[tt][mb].p_next = NULL;
+            p_cb->OSTaskQFirst[tt][mb] = &p_cb->OSTaskQStub[tt][mb];
+            p_cb->OSTaskQLast [tt][mb] = &p_cb->OSTaskQStub[tt][mb];
+#else
             p_cb->OSTaskQFirst[tt][mb] = NULL;
             p_cb->OSTaskQLast [tt][mb] = NULL;
+#endif
+        }
+
+#if ((GKI_TASK_BUF_CACHE_SIZE > 0) && (GKI_NUM_FIXED_BUF_POOLS > 0))
+        for (i = 0; i < GKI_NUM_FIXED_BUF_POOLS; i++)
+        {
+            p_cb->buf_cache[tt][i].p_first = NULL;
+            p_cb->buf_cache[tt][i].count   = 0;
         }
+#endif
     }
 
     for (tt = 0; tt < GKI_NUM_TOTAL_BUF_POOLS; tt++)
@@ -169,6 +190,8 @@ void gki_buffer_init(void)
         p_cb->freeq[tt].total   = 0;
         p_cb->freeq[tt].cur_cnt = 0;
         p_cb->freeq[tt].max_cnt = 0;
+        p_cb->freeq[tt].avail_cnt = 0;
+        p_cb->freeq[tt].cached_cnt = 0;
     }
 
     /* Use default from target.h */
@@ -315,9 +338,312 @@ void gki_buffer_init(void)
 
     p_cb->curr_total_no_of_pools = GKI_NUM_FIXED_BUF_POOLS;
 
+    gki_build_size_class_table();
+
     return;
 }
 
+/*******************************************************************************
+**
+** Function         gki_build_size_class_table
+**
+** Description      Internal function to rebuild the table that maps a size
+**                  class to the first index in pool_list whose buffers may be
+**                  big enough. Called whenever the pool list changes.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_build_size_class_table(void)
+{
+    tGKI_COM_CB *p_cb = &gki_cb.com;
+    UINT32       xx, min_size;
+    UINT8        i = 0;
+
+    for (xx = 0; xx < GKI_NUM_SIZE_CLASSES; xx++)
+    {
+        /* smallest size in this class */
+        min_size = (xx << GKI_SIZE_CLASS_SHIFT) + 1;
+
+        for (i = 0; i < p_cb->curr_total_no_of_pools; i++)
+        {
+            if (min_size <= p_cb->freeq[p_cb->pool_list[i]].size)
+                break;
+        }
+        p_cb->size_class[xx] = i;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_pool_cnt_inc
+**
+** Description      Internal function to account for a buffer handed out from
+**                  a pool. The counter is updated atomically since buffers
+**                  taken from a task cache are accounted without the GKI lock.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_pool_cnt_inc (FREE_QUEUE_T *Q)
+{
+    UINT16 cnt = __sync_add_and_fetch (&Q->cur_cnt, 1);
+
+    if (cnt > Q->max_cnt)
+        Q->max_cnt = cnt;
+}
+
+/*******************************************************************************
+**
+** Function         gki_pool_cnt_dec
+**
+** Description      Internal function to account for a buffer returned to a
+**                  pool.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_pool_cnt_dec (FREE_QUEUE_T *Q)
+{
+    UINT16 cnt;
+
+    do
+    {
+        cnt = Q->cur_cnt;
+        if (cnt == 0)
+            return;
+    } while (!__sync_bool_compare_and_swap (&Q->cur_cnt, cnt, (UINT16)(cnt - 1)));
+}
+
+/*******************************************************************************
+**
+** Function         gki_get_buf_cache
+**
+** Description      Internal function to get the buffer cache of a task for a
+**                  pool, if that pool is cached.
+**
+** Returns          pointer to the cache, or NULL if not cached
+**
+*******************************************************************************/
+static BUF_CACHE_T *gki_get_buf_cache (UINT8 task_id, UINT8 pool_id)
+{
+#if ((GKI_TASK_BUF_CACHE_SIZE > 0) && (GKI_NUM_FIXED_BUF_POOLS > 0))
+    /* Only fixed pools are cached as they are never deleted */
+    if ((task_id < GKI_MAX_TASKS) && (pool_id < GKI_NUM_FIXED_BUF_POOLS))
+        return (&gki_cb.com.buf_cache[task_id][pool_id]);
+#endif
+    return (NULL);
+}
+
+/*******************************************************************************
+**
+** Function         gki_take_from_pool
+**
+** Description      Internal function to take a free buffer out of a pool.
+**                  The calling task's cache is used first. When it is empty,
+**                  the buffer is taken from the shared free queue and the
+**                  cache is refilled with a batch under the same lock, as long
+**                  as enough buffers are left for the other tasks.
+**
+** Returns          pointer to the buffer header, or NULL if none available
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_take_from_pool (UINT8 pool_id, UINT8 task_id)
+{
+    tGKI_COM_CB   *p_cb = &gki_cb.com;
+    FREE_QUEUE_T  *Q = &p_cb->freeq[pool_id];
+    BUF_CACHE_T   *p_cache = gki_get_buf_cache (task_id, pool_id);
+    BUFFER_HDR_T  *p_hdr;
+    UINT8          xx;
+
+    if ((p_cache) && (p_cache->p_first))
+    {
+        p_hdr = p_cache->p_first;
+        p_cache->p_first = p_hdr->p_next;
+        p_cache->count--;
+
+        __sync_sub_and_fetch (&Q->cached_cnt, 1);
+        gki_pool_cnt_inc (Q);
+        return (p_hdr);
+    }
+
+    GKI_disable();
+
+    if (Q->cur_cnt >= Q->total)
+    {
+        GKI_enable();
+        return (NULL);
+    }
+
+#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
+    if ((p_cb->pool_start[pool_id] == NULL) && (gki_alloc_free_queue (pool_id) != TRUE))
+    {
+        GKI_TRACE_ERROR_0("gki_take_from_pool() out of buffer");
+        GKI_enable();
+        return (NULL);
+    }
+#endif
+
+    /* Remaining free buffers may all be held in other tasks' caches */
+    if ((p_hdr = Q->p_first) == NULL)
+    {
+        GKI_enable();
+        return (NULL);
+    }
+
+    Q->p_first = p_hdr->p_next;
+    Q->avail_cnt--;
+
+    if ((p_cache) && (Q->avail_cnt > (Q->total >> 2) + GKI_TASK_BUF_CACHE_BATCH))
+    {
+        for (xx = 0; xx < GKI_TASK_BUF_CACHE_BATCH; xx++)
+        {
+            BUFFER_HDR_T *p_cached = Q->p_first;
+
+            Q->p_first = p_cached->p_next;
+            Q->avail_cnt--;
+
+            p_cached->p_next = p_cache->p_first;
+            p_cache->p_first = p_cached;
+            p_cache->count++;
+        }
+        __sync_add_and_fetch (&Q->cached_cnt, GKI_TASK_BUF_CACHE_BATCH);
+    }
+
+    if (!Q->p_first)
+        Q->p_last = NULL;
+
+    gki_pool_cnt_inc (Q);
+
+    GKI_enable();
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_release_to_queue
+**
+** Description      Internal function to link a buffer at the tail of the
+**                  shared free queue of its pool. Must be called with the
+**                  GKI lock held.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_release_to_queue (FREE_QUEUE_T *Q, BUFFER_HDR_T *p_hdr)
+{
+    if (Q->p_last)
+        Q->p_last->p_next = p_hdr;
+    else
+        Q->p_first = p_hdr;
+
+    Q->p_last     = p_hdr;
+    p_hdr->p_next = NULL;
+    Q->avail_cnt++;
+}
+
+/*******************************************************************************
+**
+** Function         gki_return_to_pool
+**
+** Description      Internal function to give a freed buffer back to its pool.
+**                  The buffer goes into the calling task's cache if there is
+**                  room and enough buffers are left for the other tasks.
+**                  Otherwise it is released to the shared free queue under
+**                  one lock together with half of the cache, or with all of
+**                  it when the shared free queue is running low.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_return_to_pool (BUFFER_HDR_T *p_hdr, UINT8 task_id)
+{
+    FREE_QUEUE_T  *Q = &gki_cb.com.freeq[p_hdr->q_id];
+    BUF_CACHE_T   *p_cache = gki_get_buf_cache (task_id, p_hdr->q_id);
+    BUFFER_HDR_T  *p_cached;
+    UINT8          keep;
+
+    p_hdr->status  = BUF_STATUS_FREE;
+    p_hdr->task_id = GKI_INVALID_TASK;
+
+    /* same reserve as when the cache is refilled in gki_take_from_pool () */
+    if (  (p_cache)
+        &&(p_cache->count < GKI_TASK_BUF_CACHE_SIZE)
+        &&(Q->avail_cnt > (Q->total >> 2) + GKI_TASK_BUF_CACHE_BATCH)  )
+    {
+        p_hdr->p_next    = p_cache->p_first;
+        p_cache->p_first = p_hdr;
+        p_cache->count++;
+
+        gki_pool_cnt_dec (Q);
+        __sync_add_and_fetch (&Q->cached_cnt, 1);
+        return;
+    }
+
+    GKI_disable();
+
+    gki_release_to_queue (Q, p_hdr);
+
+    if (Q->avail_cnt > (Q->total >> 2) + GKI_TASK_BUF_CACHE_BATCH)
+        keep = GKI_TASK_BUF_CACHE_SIZE - GKI_TASK_BUF_CACHE_BATCH;
+    else
+        keep = 0;
+
+    while ((p_cache) && (p_cache->count > keep))
+    {
+        p_cached = p_cache->p_first;
+        p_cache->p_first = p_cached->p_next;
+        p_cache->count--;
+
+        __sync_sub_and_fetch (&Q->cached_cnt, 1);
+        gki_release_to_queue (Q, p_cached);
+    }
+
+    gki_pool_cnt_dec (Q);
+
+    GKI_enable();
+}
+
+/*******************************************************************************
+**
+** Function         gki_buffer_flush_task_cache
+**
+** Description      Called internally by GKI when a task exits to give all the
+**                  buffers in its caches back to the shared free queues.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_buffer_flush_task_cache (UINT8 task_id)
+{
+#if ((GKI_TASK_BUF_CACHE_SIZE > 0) && (GKI_NUM_FIXED_BUF_POOLS > 0))
+    BUF_CACHE_T   *p_cache;
+    BUFFER_HDR_T  *p_hdr;
+    UINT8          xx;
+
+    if (task_id >= GKI_MAX_TASKS)
+        return;
+
+    GKI_disable();
+
+    for (xx = 0; xx < GKI_NUM_FIXED_BUF_POOLS; xx++)
+    {
+        p_cache = &gki_cb.com.buf_cache[task_id][xx];
+
+        while ((p_hdr = p_cache->p_first) != NULL)
+        {
+            p_cache->p_first = p_hdr->p_next;
+            __sync_sub_and_fetch (&gki_cb.com.freeq[xx].cached_cnt, 1);
+            gki_release_to_queue (&gki_cb.com.freeq[xx], p_hdr);
+        }
+        p_cache->count = 0;
+    }
+
+    GKI_enable();
+#endif
+}
+
 
 /*******************************************************************************
 **
@@ -360,10 +686,11 @@ void *GKI_getbuf (UINT16 size)
 #endif
 {
     UINT8         i;
-    FREE_QUEUE_T  *Q;
+    UINT8         task_id;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 #if GKI_BUFFER_DEBUG
+    FREE_QUEUE_T  *Q;
     UINT8         x;
 #endif
 
@@ -376,8 +703,8 @@ void *GKI_getbuf (UINT16 size)
 #if GKI_BUFFER_DEBUG
     LOGD("GKI_getbuf() requesting %d func:%s(line=%d)", size, _function_, _line_);
 #endif
-    /* Find the first buffer pool that is public that can hold the desired size */
-    for (i=0; i < p_cb->curr_total_no_of_pools; i++)
+    /* Find the first buffer pool that can hold the desired size */
+    for (i = p_cb->size_class[GKI_SIZE_CLASS(size)]; i < p_cb->curr_total_no_of_pools; i++)
     {
         if ( size <= p_cb->freeq[p_cb->pool_list[i]].size )
             break;
@@ -389,8 +716,7 @@ void *GKI_getbuf (UINT16 size)
         return (NULL);
     }
 
-    /* Make sure the buffers aren't disturbed til finished with allocation */
-    GKI_disable();
+    task_id = GKI_get_taskid();
 
     /* search the public buffer pools that are big enough to hold the size
      * until a free buffer is found */
@@ -400,43 +726,15 @@ void *GKI_getbuf (UINT16 size)
         if (((UINT16)1 << p_cb->pool_list[i]) & p_cb->pool_access_mask)
             continue;
 
-        Q = &p_cb->freeq[p_cb->pool_list[i]];
-        if(Q->cur_cnt < Q->total)
+        if ((p_hdr = gki_take_from_pool (p_cb->pool_list[i], task_id)) != NULL)
         {
-        #ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-            if(Q->p_first == 0 && gki_alloc_free_queue(i) != TRUE)
-            {
-                GKI_TRACE_ERROR_0("GKI_getbuf() out of buffer");
-                GKI_enable();
-                return NULL;
-            }
-        #endif
-
-            if(Q->p_first == 0)
-            {
-                /* gki_alloc_free_queue() failed to alloc memory */
-                GKI_TRACE_ERROR_0("GKI_getbuf() fail alloc free queue");
-                GKI_enable();
-                return NULL;
-            }
-
-            p_hdr = Q->p_first;
-            Q->p_first = p_hdr->p_next;
-
-            if (!Q->p_first)
-                Q->p_last = NULL;
-
-            if(++Q->cur_cnt > Q->max_cnt)
-                Q->max_cnt = Q->cur_cnt;
-
-            GKI_enable();
-
-            p_hdr->task_id = GKI_get_taskid();
+            p_hdr->task_id = task_id;
 
             p_hdr->status  = BUF_STATUS_UNLINKED;
             p_hdr->p_next  = NULL;
             p_hdr->Type    = 0;
 #if GKI_BUFFER_DEBUG
+            Q = &p_cb->freeq[p_cb->pool_list[i]];
             LOGD("GKI_getbuf() allocated, %x, %x (%d of %d used) %d", (UINT8*)p_hdr + BUFFER_HDR_SIZE, p_hdr, Q->cur_cnt, Q->total, p_cb->freeq[i].total);
 
             strncpy(p_hdr->_function, _function_, _GKI_MAX_FUNCTION_NAME_LEN);
@@ -477,8 +775,6 @@ void *GKI_getbuf (UINT16 size)
 
     GKI_TRACE_ERROR_0("Failed to allocate GKI buffer");
 
-    GKI_enable();
-
     return (NULL);
 }
 
@@ -504,7 +800,10 @@ void *GKI_getpoolbuf_debug (UINT8 pool_id, const char * _function_, int _line_)
 void *GKI_getpoolbuf (UINT8 pool_id)
 #endif
 {
+#if GKI_BUFFER_DEBUG
     FREE_QUEUE_T  *Q;
+#endif
+    UINT8         task_id;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
@@ -514,43 +813,18 @@ void *GKI_getpoolbuf (UINT8 pool_id)
 #if GKI_BUFFER_DEBUG
     LOGD("GKI_getpoolbuf() requesting from %d func:%s(line=%d)", pool_id, _function_, _line_);
 #endif
-    /* Make sure the buffers aren't disturbed til finished with allocation */
-    GKI_disable();
+    task_id = GKI_get_taskid();
 
-    Q = &p_cb->freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
+    if ((p_hdr = gki_take_from_pool (pool_id, task_id)) != NULL)
     {
-#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-        if(Q->p_first == 0 && gki_alloc_free_queue(pool_id) != TRUE)
-            return NULL;
-#endif
-
-        if(Q->p_first == 0)
-        {
-            /* gki_alloc_free_queue() failed to alloc memory */
-            GKI_TRACE_ERROR_0("GKI_getpoolbuf() fail alloc free queue");
-            return NULL;
-        }
-
-        p_hdr = Q->p_first;
-        Q->p_first = p_hdr->p_next;
-
-        if (!Q->p_first)
-            Q->p_last = NULL;
-
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
-
-        GKI_enable();
-
-
-        p_hdr->task_id = GKI_get_taskid();
+        p_hdr->task_id = task_id;
 
         p_hdr->status  = BUF_STATUS_UNLINKED;
         p_hdr->p_next  = NULL;
         p_hdr->Type    = 0;
 
 #if GKI_BUFFER_DEBUG
+        Q = &p_cb->freeq[pool_id];
         LOGD("GKI_getpoolbuf() allocated, %x, %x (%d of %d used) %d", (UINT8*)p_hdr + BUFFER_HDR_SIZE, p_hdr, Q->cur_cnt, Q->total, p_cb->freeq[pool_id].total);
 
         strncpy(p_hdr->_function, _function_, _GKI_MAX_FUNCTION_NAME_LEN);
@@ -561,8 +835,6 @@ void *GKI_getpoolbuf (UINT8 pool_id)
     }
 
     /* If here, no buffers in the specified pool */
-    GKI_enable();
-
 #if GKI_BUFFER_DEBUG
     /* try for free buffers in public pools */
     return (GKI_getbuf_debug(p_cb->freeq[pool_id].size, _function_, _line_));
@@ -585,7 +857,6 @@ void *GKI_getpoolbuf (UINT8 pool_id)
 *******************************************************************************/
 void GKI_freebuf (void *p_buf)
 {
-    FREE_QUEUE_T    *Q;
     BUFFER_HDR_T    *p_hdr;
 
 #if (GKI_ENABLE_BUF_CORRUPTION_CHECK == TRUE)
@@ -614,25 +885,10 @@ void GKI_freebuf (void *p_buf)
         return;
     }
 
-    GKI_disable();
-
     /*
     ** Release the buffer
     */
-    Q  = &gki_cb.com.freeq[p_hdr->q_id];
-    if (Q->p_last)
-        Q->p_last->p_next = p_hdr;
-    else
-        Q->p_first = p_hdr;
-
-    Q->p_last      = p_hdr;
-    p_hdr->p_next  = NULL;
-    p_hdr->status  = BUF_STATUS_FREE;
-    p_hdr->task_id = GKI_INVALID_TASK;
-    if (Q->cur_cnt > 0)
-        Q->cur_cnt--;
-
-    GKI_enable();
+    gki_return_to_pool (p_hdr, GKI_get_taskid());
 
     return;
 }
@@ -697,6 +953,107 @@ BOOLEAN gki_chk_buf_damage(void *p_buf)
 #endif
 }
 
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+/*******************************************************************************
+**
+** Function         gki_mbox_push
+**
+** Description      Internal function to link a buffer at the tail of a task
+**                  mailbox. Any number of tasks may push concurrently without
+**                  taking the GKI lock: OSTaskQLast is claimed with an atomic
+**                  exchange and the previous tail is then linked to the buffer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_mbox_push (UINT8 task_id, UINT8 mbox, BUFFER_HDR_T *p_hdr)
+{
+    BUFFER_HDR_T    *p_prev;
+
+    __atomic_store_n (&p_hdr->p_next, NULL, __ATOMIC_RELAXED);
+    p_prev = __atomic_exchange_n (&gki_cb.com.OSTaskQLast[task_id][mbox], p_hdr, __ATOMIC_ACQ_REL);
+    __atomic_store_n (&p_prev->p_next, p_hdr, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         gki_mbox_pop
+**
+** Description      Internal function to unlink the buffer at the head of a task
+**                  mailbox. Only the task owning the mailbox may call this.
+**                  If a producer is still linking its buffer, the mailbox is
+**                  reported empty; that producer sends the mailbox event once
+**                  the buffer is linked, so the buffer is read on the next
+**                  wake-up.
+**
+** Returns          the buffer header, or NULL if the mailbox is empty
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_mbox_pop (UINT8 task_id, UINT8 mbox)
+{
+    tGKI_COM_CB     *p_cb = &gki_cb.com;
+    BUFFER_HDR_T    *p_stub  = &p_cb->OSTaskQStub[task_id][mbox];
+    BUFFER_HDR_T    *p_first = p_cb->OSTaskQFirst[task_id][mbox];
+    BUFFER_HDR_T    *p_next  = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE);
+
+    /* Skip over the placeholder */
+    if (p_first == p_stub)
+    {
+        if (p_next == NULL)
+            return (NULL);
+
+        p_cb->OSTaskQFirst[task_id][mbox] = p_first = p_next;
+        p_next = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE);
+    }
+
+    if (p_next)
+    {
+        p_cb->OSTaskQFirst[task_id][mbox] = p_next;
+        return (p_first);
+    }
+
+    /* p_first looks like the last buffer; a producer may be linking after it */
+    if (p_first != __atomic_load_n (&p_cb->OSTaskQLast[task_id][mbox], __ATOMIC_ACQUIRE))
+        return (NULL);
+
+    /* Put the placeholder back behind the last buffer so it can be unlinked */
+    gki_mbox_push (task_id, mbox, p_stub);
+
+    p_next = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE);
+    if (p_next)
+    {
+        p_cb->OSTaskQFirst[task_id][mbox] = p_next;
+        return (p_first);
+    }
+
+    return (NULL);
+}
+#endif
+
+/*******************************************************************************
+**
+** Function         gki_mbox_pending
+**
+** Description      Called internally by GKI to check whether a task mailbox
+**                  has buffers to read. Only the owning task should call this.
+**
+** Returns          TRUE if the mailbox is not empty
+**
+*******************************************************************************/
+BOOLEAN gki_mbox_pending (UINT8 task_id, UINT8 mbox)
+{
+    tGKI_COM_CB *p_cb = &gki_cb.com;
+
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+    if (p_cb->OSTaskQFirst[task_id][mbox] != &p_cb->OSTaskQStub[task_id][mbox])
+        return (TRUE);
+
+    return ((BOOLEAN) (__atomic_load_n (&p_cb->OSTaskQStub[task_id][mbox].p_next, __ATOMIC_ACQUIRE) != NULL));
+#else
+    return ((BOOLEAN) (p_cb->OSTaskQFirst[task_id][mbox] != NULL));
+#endif
+}
+
 /*******************************************************************************
 **
 ** Function         GKI_send_msg
@@ -735,6 +1092,12 @@ void GKI_send_msg (UINT8 task_id, UINT8 mbox, void *msg)
         return;
     }
 
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+    p_hdr->status = BUF_STATUS_QUEUED;
+    p_hdr->task_id = task_id;
+
+    gki_mbox_push (task_id, mbox, p_hdr);
+#else
     GKI_disable();
 
     if (p_cb->OSTaskQFirst[task_id][mbox])
@@ -750,6 +1113,7 @@ void GKI_send_msg (UINT8 task_id, UINT8 mbox, void *msg)
 
 
     GKI_enable();
+#endif
 
     GKI_send_event(task_id, (UINT16)EVENT_MASK(mbox));
 
@@ -777,6 +1141,15 @@ void *GKI_read_mbox (UINT8 mbox)
     if ((task_id >= GKI_MAX_TASKS) || (mbox >= NUM_TASK_MBOX))
         return (NULL);
 
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+    if ((p_hdr = gki_mbox_pop (task_id, mbox)) != NULL)
+    {
+        p_hdr->p_next = NULL;
+        p_hdr->status = BUF_STATUS_UNLINKED;
+
+        p_buf = (UINT8 *)p_hdr + BUFFER_HDR_SIZE;
+    }
+#else
     GKI_disable();
 
     if (gki_cb.com.OSTaskQFirst[task_id][mbox])
@@ -791,6 +1164,7 @@ void *GKI_read_mbox (UINT8 mbox)
     }
 
     GKI_enable();
+#endif
 
     return (p_buf);
 }
@@ -1247,16 +1621,16 @@ void *GKI_igetpoolbuf (UINT8 pool_id)
 
 
     Q = &gki_cb.com.freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
+    if((Q->cur_cnt < Q->total) && (Q->p_first))
     {
         p_hdr = Q->p_first;
         Q->p_first = p_hdr->p_next;
+        Q->avail_cnt--;
 
         if (!Q->p_first)
             Q->p_last = NULL;
 
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
+        gki_pool_cnt_inc (Q);
 
         p_hdr->task_id = GKI_get_taskid();
 
@@ -1295,7 +1669,8 @@ UINT16 GKI_poolcount (UINT8 pool_id)
 ** Function         GKI_poolfreecount
 **
 ** Description      Called by an application to get the number of free buffers
-**                  in the specified buffer pool.
+**                  in the specified buffer pool. Free buffers held in task
+**                  caches are not counted since other tasks can't get them.
 **
 ** Parameters       pool_id - (input) pool ID to get the free count of.
 **
@@ -1311,7 +1686,7 @@ UINT16 GKI_poolfreecount (UINT8 pool_id)
 
     Q  = &gki_cb.com.freeq[pool_id];
 
-    return ((UINT16)(Q->total - Q->cur_cnt));
+    return ((UINT16)(Q->total - Q->cur_cnt - Q->cached_cnt));
 }
 
 /*******************************************************************************
@@ -1382,6 +1757,12 @@ void GKI_isend_msg (UINT8 task_id, UINT8 mbox, void *msg)
         return;
     }
 
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+    p_hdr->status = BUF_STATUS_QUEUED;
+    p_hdr->task_id = task_id;
+
+    gki_mbox_push (task_id, mbox, p_hdr);
+#else
     if (p_cb->OSTaskQFirst[task_id][mbox])
         p_cb->OSTaskQLast[task_id][mbox]->p_next = p_hdr;
     else
@@ -1392,6 +1773,7 @@ void GKI_isend_msg (UINT8 task_id, UINT8 mbox, void *msg)
     p_hdr->p_next = NULL;
     p_hdr->status = BUF_STATUS_QUEUED;
     p_hdr->task_id = task_id;
+#endif
 
     GKI_isend_event(task_id, (UINT16)EVENT_MASK(mbox));
 
@@ -1452,6 +1834,7 @@ UINT8 GKI_create_pool (UINT16 size, UINT16 count, UINT8 permission, void *p_mem_
         gki_add_to_pool_list(xx);
         (void) GKI_set_pool_permission (xx, permission);
         p_cb->curr_total_no_of_pools++;
+        gki_build_size_class_table();
 
         return (xx);
     }
@@ -1489,6 +1872,8 @@ void GKI_delete_pool (UINT8 pool_id)
         Q->total     = 0;
         Q->cur_cnt   = 0;
         Q->max_cnt   = 0;
+        Q->avail_cnt = 0;
+        Q->cached_cnt = 0;
         Q->p_first   = NULL;
         Q->p_last    = NULL;
 
@@ -1500,6 +1885,7 @@ void GKI_delete_pool (UINT8 pool_id)
 
         gki_remove_from_pool_list(pool_id);
         p_cb->curr_total_no_of_pools--;
+        gki_build_size_class_table();
     }
     else
         GKI_exception(GKI_ERROR_DELETE_POOL_BAD_QID, "Deleting bad pool");
@@ -1554,6 +1940,7 @@ UINT16 GKI_poolutilization (UINT8 pool_id)
     if (Q->total == 0)
         return (100);
 
-    return ((Q->cur_cnt * 100) / Q->total);
+    /* free buffers held in task caches are not available to all tasks */
+    return (((Q->cur_cnt + Q->cached_cnt) * 100) / Q->total);
 }
 
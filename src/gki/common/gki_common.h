@@ -25,6 +25,21 @@
 #define GKI_DEBUG	FALSE
 #endif
 
+/* Number of free buffers a task may keep per fixed pool in its private buffer
+** cache. Buffers are moved between the cache and the shared free queue in
+** batches of half this size. Set to 0 to disable the per-task caches.
+*/
+#ifndef GKI_TASK_BUF_CACHE_SIZE
+#define GKI_TASK_BUF_CACHE_SIZE     4
+#endif
+
+/* TRUE to use lock-free multi-producer/single-consumer task mailboxes.
+** FALSE to serialize GKI_send_msg/GKI_read_mbox on the GKI mutex.
+*/
+#ifndef GKI_USE_LOCKFREE_MBOX
+#define GKI_USE_LOCKFREE_MBOX       TRUE
+#endif
+
 /* Task States: (For OSRdyTbl) */
 #define TASK_DEAD       0   /* b0000 */
 #define TASK_READY      1   /* b0001 */
@@ -85,8 +100,19 @@ typedef struct _free_queue
     UINT16          total;         /* toatal number of buffers */
     UINT16          cur_cnt;       /* number of  buffers currently allocated */
     UINT16          max_cnt;       /* maximum number of buffers allocated at any time */
+    UINT16          avail_cnt;     /* number of buffers linked in the free queue */
+    UINT16          cached_cnt;    /* number of free buffers held in task caches */
 } FREE_QUEUE_T;
 
+/* Per-task cache of free buffers. Only the owning task touches its cache,
+** so no locking is needed to take or return a buffer.
+*/
+typedef struct
+{
+    BUFFER_HDR_T *p_first;      /* first buffer in the cache */
+    UINT8         count;        /* number of buffers in the cache */
+} BUF_CACHE_T;
+
 
 /* Buffer related defines
 */
@@ -96,6 +122,13 @@ typedef struct _free_queue
 #define MAX_USER_BUF_SIZE   ((UINT16)0xffff - BUFFER_PADDING_SIZE)  /* pool size must allow for header */
 #define MAGIC_NO            0xDDBADDBA
 
+/* Size classes used to find the first candidate pool for a buffer size */
+#define GKI_SIZE_CLASS_SHIFT    6
+#define GKI_NUM_SIZE_CLASSES    ((0xFFFF >> GKI_SIZE_CLASS_SHIFT) + 1)
+#define GKI_SIZE_CLASS(size)    (((size) - 1) >> GKI_SIZE_CLASS_SHIFT)
+
+#define GKI_TASK_BUF_CACHE_BATCH    ((GKI_TASK_BUF_CACHE_SIZE + 1) / 2)
+
 #define BUF_STATUS_FREE     0
 #define BUF_STATUS_UNLINKED 1
 #define BUF_STATUS_QUEUED   2
@@ -309,6 +342,9 @@ typedef struct
     */
     BUFFER_HDR_T    *OSTaskQFirst[GKI_MAX_TASKS][NUM_TASK_MBOX]; /* array of pointers to the first event in the task mailbox */
     BUFFER_HDR_T    *OSTaskQLast [GKI_MAX_TASKS][NUM_TASK_MBOX]; /* array of pointers to the last event in the task mailbox */
+#if (GKI_USE_LOCKFREE_MBOX == TRUE)
+    BUFFER_HDR_T     OSTaskQStub [GKI_MAX_TASKS][NUM_TASK_MBOX]; /* placeholder entries that keep lock-free mailboxes linked */
+#endif
 
     /* Define the buffer pool management variables
     */
@@ -329,6 +365,11 @@ typedef struct
     UINT16      pool_access_mask;                   /* Bits are set if the corresponding buffer pool is a restricted pool */
     UINT8       pool_list[GKI_NUM_TOTAL_BUF_POOLS]; /* buffer pools arranged in the order of size */
     UINT8       curr_total_no_of_pools;             /* number of fixed buf pools + current number of dynamic pools */
+    UINT8       size_class[GKI_NUM_SIZE_CLASSES];   /* first index in pool_list that may fit each size class */
+
+#if ((GKI_TASK_BUF_CACHE_SIZE > 0) && (GKI_NUM_FIXED_BUF_POOLS > 0))
+    BUF_CACHE_T buf_cache[GKI_MAX_TASKS][GKI_NUM_FIXED_BUF_POOLS]; /* per-task caches of free buffers */
+#endif
 
     BOOLEAN     timer_nesting;                      /* flag to prevent timer interrupt nesting */
 
@@ -355,6 +396,8 @@ extern "C" {
 GKI_API extern BOOLEAN   gki_chk_buf_damage(void *);
 extern BOOLEAN   gki_chk_buf_owner(void *);
 extern void      gki_buffer_init (void);
+extern void      gki_buffer_flush_task_cache (UINT8 task_id);
+extern BOOLEAN   gki_mbox_pending (UINT8 task_id, UINT8 mbox);
 extern void      gki_timers_init(void);
 extern void      gki_adjust_timer_count (INT32);
 
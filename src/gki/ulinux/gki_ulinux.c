@@ -110,6 +110,10 @@ void gki_task_entry(UINT32 params)
     (p_pthread_info->task_entry)(p_pthread_info->params);
 
     GKI_TRACE_1("gki_task task_id=%i terminating", p_pthread_info->task_id);
+
+    /* give buffers cached by this task back to the shared pools */
+    gki_buffer_flush_task_cache(p_pthread_info->task_id);
+
     gki_cb.os.thread_id[p_pthread_info->task_id] = 0;
 
     pthread_exit(0);    /* GKI tasks have no return value */
@@ -171,7 +175,17 @@ void GKI_init(void)
      * this works too even if GKI_NO_TICK_STOP is defined in btld.txt */
     p_os->no_timer_suspend = GKI_TIMER_TICK_RUN_COND;
     pthread_mutex_init(&p_os->gki_timer_mutex, NULL);
+#if (GKI_TICKLESS == TRUE)
+    /* timer loop deadlines are absolute monotonic times */
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&p_os->gki_timer_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    clock_gettime(CLOCK_MONOTONIC, &p_os->tick_ref);
+#else
     pthread_cond_init(&p_os->gki_timer_cond, NULL);
+#endif
 }
 
 
@@ -189,7 +203,11 @@ UINT32 GKI_get_os_tick_count(void)
 
     /* TODO - add any OS specific code here
     **/
+#if (GKI_TICKLESS == TRUE)
+    return (gki_timer_get_ticks());
+#else
     return (gki_cb.com.OSTicks);
+#endif
 }
 
 /*******************************************************************************
@@ -320,7 +338,9 @@ void GKI_shutdown(void)
 {
     UINT8 task_id;
     volatile int    *p_run_cond = &gki_cb.os.no_timer_suspend;
+#if (GKI_TICKLESS != TRUE)
     int     oldCOnd = 0;
+#endif
 #if ( FALSE == GKI_PTHREAD_JOINABLE )
     int i = 0;
 #else
@@ -352,6 +372,11 @@ void GKI_shutdown(void)
             {
                 GKI_TRACE_1( "pthread_join() FAILED: result: %d", result );
             }
+            else
+            {
+                /* the task is gone, so its buffer cache can be flushed safely */
+                gki_buffer_flush_task_cache(task_id - 1);
+            }
 #endif
             GKI_TRACE_1( "GKI_shutdown(): task %s dead", gki_cb.com.OSTName[task_id]);
             GKI_exit_task(task_id - 1);
@@ -379,10 +404,20 @@ void GKI_shutdown(void)
         release_wake_lock(WAKE_LOCK_ID);
         gki_cb.os.gki_timer_wake_lock_on = 0;
     }
+    /* change the state under the timer mutex, so the timer loop can't miss the
+     * wakeup between checking the state and waiting on the condition */
+    pthread_mutex_lock( &gki_cb.os.gki_timer_mutex );
+#if (GKI_TICKLESS == TRUE)
+    /* the timer loop may block on the condition while the tick is running */
+    *p_run_cond = GKI_TIMER_TICK_EXIT_COND;
+    pthread_cond_signal( &gki_cb.os.gki_timer_cond );
+#else
     oldCOnd = *p_run_cond;
     *p_run_cond = GKI_TIMER_TICK_EXIT_COND;
     if (oldCOnd == GKI_TIMER_TICK_STOP_COND)
         pthread_cond_signal( &gki_cb.os.gki_timer_cond );
+#endif
+    pthread_mutex_unlock( &gki_cb.os.gki_timer_mutex );
 
 }
 
@@ -432,6 +467,161 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
     }
 }
 
+#if (GKI_TICKLESS == TRUE)
+/*******************************************************************************
+**
+** Function         gki_timespec_add_ms
+**
+** Description      Computes the absolute time ms milliseconds after p_from.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timespec_add_ms (struct timespec *p_to, const struct timespec *p_from, long long ms)
+{
+    long long nsec = p_from->tv_nsec + (ms % 1000) * 1000000LL;
+
+    p_to->tv_sec = p_from->tv_sec + (time_t)(ms / 1000) + (time_t)(nsec / 1000000000LL);
+    p_to->tv_nsec = (long)(nsec % 1000000000LL);
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_ticks_to_next
+**
+** Description      Returns the number of system ticks until the timer loop has
+**                  work to do: the first task timer expiry or the delayed stop
+**                  of the system tick.
+**
+**                  NOTE: called with gki_timer_mutex held.
+**
+** Returns          ticks, GKI_MAX_INT32 if nothing is pending
+**
+*******************************************************************************/
+static INT32 gki_timer_ticks_to_next (void)
+{
+    INT32 ticks = GKI_MAX_INT32;
+
+    if (gki_cb.com.OSNumOrigTicks != 0)
+        ticks = (gki_cb.com.OSTicksTilExp > 0) ? gki_cb.com.OSTicksTilExp : 0;
+
+#if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
+    if ((gki_cb.com.OSTicksTilStop != 0) && ((INT32)gki_cb.com.OSTicksTilStop < ticks))
+        ticks = (INT32)gki_cb.com.OSTicksTilStop;
+#endif
+
+    return ticks;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_sync
+**
+** Description      Passes the whole system ticks elapsed since the last update
+**                  to GKI_timer_update(). The remainder of a tick is carried
+**                  over to the next update so no time is lost.
+**
+**                  NOTE: must be called with GKI_disable() held so that the
+**                  update and the timer variables are consistent.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_timer_sync (void)
+{
+    tGKI_OS         *p_os = &gki_cb.os;
+    struct timespec now;
+    long long       elapsed_ms;
+    INT32           elapsed = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock( &p_os->gki_timer_mutex );
+    /* nanoseconds first so that a negative nsec difference isn't rounded up */
+    elapsed_ms = ((long long)(now.tv_sec - p_os->tick_ref.tv_sec) * 1000000000LL
+               + (now.tv_nsec - p_os->tick_ref.tv_nsec)) / 1000000;
+    if (elapsed_ms >= LINUX_SEC)
+    {
+        if (elapsed_ms / LINUX_SEC > GKI_MAX_INT32)
+            elapsed = GKI_MAX_INT32;
+        else
+            elapsed = (INT32)(elapsed_ms / LINUX_SEC);
+        gki_timespec_add_ms(&p_os->tick_ref, &p_os->tick_ref, (long long)elapsed * LINUX_SEC);
+    }
+    pthread_mutex_unlock( &p_os->gki_timer_mutex );
+
+    if (elapsed > 0)
+        GKI_timer_update(elapsed);
+
+    /* with no timer armed the tick phase is free: restart it now so that the
+     * next timer runs for its full length rather than up to a tick less */
+    if (gki_cb.com.OSNumOrigTicks == 0)
+    {
+        pthread_mutex_lock( &p_os->gki_timer_mutex );
+        p_os->tick_ref = now;
+        pthread_mutex_unlock( &p_os->gki_timer_mutex );
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_get_ticks
+**
+** Description      Returns the system ticks up to now. The whole ticks elapsed
+**                  since the timer loop last ran are added to OSTicks, which
+**                  is only brought up to date by gki_timer_sync().
+**
+** Returns          current system tick count
+**
+*******************************************************************************/
+UINT32 gki_timer_get_ticks (void)
+{
+    tGKI_OS         *p_os = &gki_cb.os;
+    struct timespec now;
+    long long       elapsed_ms;
+    UINT32          ticks;
+
+    /* gki_timer_sync() moves tick_ref and updates OSTicks with GKI_disable() held */
+    GKI_disable();
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock( &p_os->gki_timer_mutex );
+    elapsed_ms = ((long long)(now.tv_sec - p_os->tick_ref.tv_sec) * 1000000000LL
+               + (now.tv_nsec - p_os->tick_ref.tv_nsec)) / 1000000;
+    pthread_mutex_unlock( &p_os->gki_timer_mutex );
+
+    ticks = gki_cb.com.OSTicks;
+
+    GKI_enable();
+
+    if (elapsed_ms >= LINUX_SEC)
+        ticks += (UINT32)(elapsed_ms / LINUX_SEC);
+
+    return ticks;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_rearm
+**
+** Description      Wakes up the timer loop so that it recomputes its deadline
+**                  after a timer has been started.
+**
+**                  NOTE: lock order is GKI_mutex then gki_timer_mutex.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_timer_rearm (void)
+{
+    tGKI_OS *p_os = &gki_cb.os;
+
+    pthread_mutex_lock( &p_os->gki_timer_mutex );
+    pthread_cond_signal( &p_os->gki_timer_cond );
+    pthread_mutex_unlock( &p_os->gki_timer_mutex );
+}
+#endif
 
 /*******************************************************************************
 **
@@ -489,8 +679,10 @@ void timer_thread(signed long id)
 void GKI_run (void *p_task_id)
 {
     GKI_TRACE_1("%s enter", __func__);
+#if (GKI_TICKLESS != TRUE)
     struct timespec delay;
     int err = 0;
+#endif
     volatile int * p_run_cond = &gki_cb.os.no_timer_suspend;
 
 #ifndef GKI_NO_TICK_STOP
@@ -518,6 +710,39 @@ void GKI_run (void *p_task_id)
     }
 #else
     GKI_TRACE_2("GKI_run, run_cond(%x)=%d ", p_run_cond, *p_run_cond);
+#if (GKI_TICKLESS == TRUE)
+    /* sleep until the next expiry instead of polling every tick. gki_timer_rearm()
+     * and the tick start callback wake the loop when an earlier timer is armed */
+    pthread_mutex_lock( &gki_cb.os.gki_timer_mutex );
+    while (GKI_TIMER_TICK_EXIT_COND != *p_run_cond)
+    {
+        INT32           ticks = gki_timer_ticks_to_next();
+        struct timespec deadline;
+
+        if ((GKI_TIMER_TICK_RUN_COND != *p_run_cond) || (ticks == GKI_MAX_INT32))
+        {
+            /* nothing to expire, block till a timer is started */
+            pthread_cond_wait( &gki_cb.os.gki_timer_cond, &gki_cb.os.gki_timer_mutex );
+        }
+        else
+        {
+            if (ticks <= 0)
+                ticks = 1;
+            gki_timespec_add_ms(&deadline, &gki_cb.os.tick_ref, (long long)ticks * LINUX_SEC);
+            pthread_cond_timedwait( &gki_cb.os.gki_timer_cond, &gki_cb.os.gki_timer_mutex, &deadline );
+        }
+
+        if (GKI_TIMER_TICK_EXIT_COND == *p_run_cond)
+            break; //GKI has shutdown
+
+        pthread_mutex_unlock( &gki_cb.os.gki_timer_mutex );
+        GKI_disable();
+        gki_timer_sync();
+        GKI_enable();
+        pthread_mutex_lock( &gki_cb.os.gki_timer_mutex );
+    }
+    pthread_mutex_unlock( &gki_cb.os.gki_timer_mutex );
+#else
     for (;GKI_TIMER_TICK_EXIT_COND != *p_run_cond;)
     {
         do
@@ -562,6 +787,7 @@ void GKI_run (void *p_task_id)
                     *p_run_cond );
 #endif
     } /* for */
+#endif  /* GKI_TICKLESS */
 #endif
     GKI_TRACE_1("%s exit", __func__);
 }
@@ -695,13 +921,13 @@ UINT16 GKI_wait (UINT16 flag, UINT32 timeout)
          should NOT be lost! */
         // we are waking up after waiting for some events, so refresh variables
         // no need to call GKI_disable() here as we know that we will have some events as we've been waking up after condition pending or timeout
-        if (gki_cb.com.OSTaskQFirst[rtask][0])
+        if (gki_mbox_pending(rtask, 0))
             gki_cb.com.OSWaitEvt[rtask] |= TASK_MBOX_0_EVT_MASK;
-        if (gki_cb.com.OSTaskQFirst[rtask][1])
+        if (gki_mbox_pending(rtask, 1))
             gki_cb.com.OSWaitEvt[rtask] |= TASK_MBOX_1_EVT_MASK;
-        if (gki_cb.com.OSTaskQFirst[rtask][2])
+        if (gki_mbox_pending(rtask, 2))
             gki_cb.com.OSWaitEvt[rtask] |= TASK_MBOX_2_EVT_MASK;
-        if (gki_cb.com.OSTaskQFirst[rtask][3])
+        if (gki_mbox_pending(rtask, 3))
             gki_cb.com.OSWaitEvt[rtask] |= TASK_MBOX_3_EVT_MASK;
 
         if (gki_cb.com.OSRdyTbl[rtask] == TASK_DEAD)
@@ -1197,6 +1423,13 @@ UINT8 GKI_resume_task (UINT8 task_id)
 *******************************************************************************/
 void GKI_exit_task (UINT8 task_id)
 {
+    /* Give buffers cached by the task back to the shared pools. Another task
+    ** may still be running, and its cache is used without locking, so it is
+    ** flushed when it terminates instead.
+    */
+    if (task_id == GKI_get_taskid())
+        gki_buffer_flush_task_cache(task_id);
+
     GKI_disable();
     gki_cb.com.OSRdyTbl[task_id] = TASK_DEAD;
 
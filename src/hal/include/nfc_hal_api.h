@@ -221,6 +221,23 @@ EXPORT_HAL_API void HAL_NfcCoreInitialized (UINT8 *p_core_init_rsp_params);
 *******************************************************************************/
 EXPORT_HAL_API void HAL_NfcWrite (UINT16 data_len, UINT8 *p_data);
 
+#ifdef NFC_HAL_SHARED_GKI
+/*******************************************************************************
+**
+** Function         HAL_NfcWriteBuf
+**
+** Description      Send an NCI control message or data packet to the
+**                  transport without copying it. The HAL takes ownership of
+**                  the buffer, which must leave NFC_HAL_NCI_MSG_OFFSET_SIZE
+**                  bytes in front of the message for the transport header.
+**                  Only available when NFC/HAL share GKI resources.
+**
+** Returns          void
+**
+*******************************************************************************/
+EXPORT_HAL_API void HAL_NfcWriteBuf (NFC_HDR *p_msg);
+#endif
+
 /*******************************************************************************
 **
 ** Function         HAL_NfcPreDiscover
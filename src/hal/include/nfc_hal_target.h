@@ -36,6 +36,18 @@
 #define NFC_HAL_NCI_MSG_OFFSET_SIZE             1
 #endif
 
+/* Number of bytes to reserve in front of received NCI messages. With shared NFC/HAL GKI
+** the receive buffer is handed to NFC_TASK without copying, so it must leave the room
+** NFC_TASK reserves for received messages (NFC_RECEIVE_MSGS_OFFSET in nfc_int.h).
+** nfc_task.c fails to build if the two differ. */
+#ifndef NFC_HAL_NCI_RX_MSG_OFFSET_SIZE
+#ifdef NFC_HAL_SHARED_GKI
+#define NFC_HAL_NCI_RX_MSG_OFFSET_SIZE          10
+#else
+#define NFC_HAL_NCI_RX_MSG_OFFSET_SIZE          0
+#endif
+#endif
+
 /* NFC-WAKE */
 #ifndef NFC_HAL_LP_NFC_WAKE_GPIO
 #define NFC_HAL_LP_NFC_WAKE_GPIO                UPIO_GENERAL3
@@ -108,6 +120,11 @@
 #define NFC_HAL_PRM_POST_I2C_FIX_DELAY          (200)
 #endif
 
+/* Build the next secure patch download segment while the current one is waiting for its response */
+#ifndef NFC_HAL_PRM_PIPELINE_SEGMENTS
+#define NFC_HAL_PRM_PIPELINE_SEGMENTS           TRUE
+#endif
+
 /* NFCC will respond to more than one technology during listen discovery  */
 #ifndef NFC_HAL_DM_MULTI_TECH_RESP
 #define NFC_HAL_DM_MULTI_TECH_RESP              TRUE
@@ -333,6 +333,22 @@ typedef struct
     tNFC_HAL_PRM_FORMAT format;                 /* format of patch ram              */
     tNFC_HAL_PRM_CBACK  *p_cback;               /* Callback for download status notifications */
     UINT32              patchram_delay;         /* the dealy after patch */
+
+#if (NFC_HAL_PRM_PIPELINE_SEGMENTS == TRUE)
+    NFC_HDR             *p_next_seg;            /* next segment, built while current one is in flight */
+    BOOLEAN             next_seg_is_sig;        /* TRUE if p_next_seg is the signature segment        */
+#endif
+
+#if (NFC_HAL_PRM_DEBUG == TRUE)
+    /* Download timing */
+    UINT32              start_ms;               /* time HAL_NfcPrmDownloadStart was called    */
+    UINT32              phase_start_ms;         /* time current phase of the download started */
+    const char          *p_phase;               /* name of current phase of the download      */
+    UINT32              seg_sent_ms;            /* time last segment was sent to NFCC         */
+    UINT32              seg_max_ms;             /* longest segment round trip                 */
+    UINT32              seg_total_ms;           /* sum of segment round trips                 */
+    UINT16              seg_count;              /* number of segments acknowledged by NFCC    */
+#endif
 } tNFC_HAL_PRM_CB;
 
 /* Information about current patch in NVM */
@@ -478,6 +494,8 @@ void nfc_hal_dm_send_get_build_info_cmd (void);
 void nfc_hal_dm_proc_msg_during_init (NFC_HDR *p_msg);
 void nfc_hal_dm_config_nfcc (void);
 void nfc_hal_dm_send_nci_cmd (const UINT8 *p_data, UINT16 len, tNFC_HAL_NCI_CBACK *p_cback);
+NFC_HDR *nfc_hal_dm_build_nci_cmd (const UINT8 *p_data, UINT16 len);
+void nfc_hal_dm_send_nci_buf (NFC_HDR *p_buf, tNFC_HAL_NCI_CBACK *p_cback);
 void nfc_hal_dm_send_bt_cmd (const UINT8 *p_data, UINT16 len, tNFC_HAL_BTVSC_CPLT_CBACK *p_cback);
 void nfc_hal_dm_set_nfc_wake (UINT8 cmd);
 void nfc_hal_dm_pre_init_nfcc (void);
@@ -35,6 +35,19 @@ extern "C" {
 unsigned short crcChecksumCompute (const unsigned char *buffer, int bufferLen);
 
 
+/*******************************************************************************
+**
+** Function         crcChecksumUpdate
+**
+** Description      Continue a checksum over more data. Start with crc = 0;
+**                  the result equals crcChecksumCompute over all the data.
+**
+** Returns          2-byte checksum.
+**
+*******************************************************************************/
+unsigned short crcChecksumUpdate (unsigned short crc, const unsigned char *buffer, int bufferLen);
+
+
 /*******************************************************************************
 **
 ** Function         crcChecksumVerifyIntegrity
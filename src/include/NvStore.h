@@ -0,0 +1,78 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#pragma once
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Completion of nvStoreRead; called on the NV I/O thread */
+typedef void (tNV_STORE_READ_CBACK) (UINT16 num_bytes_read, BOOLEAN is_ok, UINT8 block);
+
+
+/*******************************************************************************
+**
+** Function         nvStoreRead
+**
+** Description      Queue a read of a non-volatile store file. A file is a
+**                  checksum followed by the data. The data is read into
+**                  buffer on the NV I/O thread, which then calls p_cback.
+**                  A write still pending for the file is read back instead.
+**                  buffer must stay valid until p_cback is called.
+**
+** Returns          none
+**
+*******************************************************************************/
+void nvStoreRead (const char* filename, UINT8* buffer, UINT16 bufferLen, UINT8 block, tNV_STORE_READ_CBACK* p_cback);
+
+
+/*******************************************************************************
+**
+** Function         nvStoreWrite
+**
+** Description      Queue a write of a non-volatile store file. The data is
+**                  copied, so buffer can be reused on return. The write is
+**                  held back briefly so repeated writes of the same file
+**                  collapse into one, and writes that do not change the file
+**                  are dropped. The file is replaced atomically.
+**
+** Returns          TRUE if the write was queued (or done).
+**
+*******************************************************************************/
+BOOLEAN nvStoreWrite (const char* filename, const UINT8* buffer, UINT16 bufferLen);
+
+
+/*******************************************************************************
+**
+** Function         nvStoreFlush
+**
+** Description      Write out all pending writes and wait for the NV I/O
+**                  thread to finish them, e.g. before the files are checked,
+**                  deleted or the stack shuts down.
+**
+** Returns          none
+**
+*******************************************************************************/
+void nvStoreFlush (void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -54,6 +54,7 @@ int GetNumValue(const char* name, void* p_value, unsigned long len);
 #define NAME_LOW_SPEED_TRANSPORT        "LOW_SPEED_TRANSPORT"
 #define NAME_NFC_WAKE_DELAY             "NFC_WAKE_DELAY"
 #define NAME_NFC_WRITE_DELAY            "NFC_WRITE_DELAY"
+#define NAME_NFC_TX_COALESCE            "NFC_TX_COALESCE"
 #define NAME_PERF_MEASURE_FREQ          "REPORT_PERFORMANCE_MEASURE"
 #define NAME_READ_MULTI_PACKETS         "READ_MULTIPLE_PACKETS"
 #define NAME_POWER_ON_DELAY             "POWER_ON_DELAY"
@@ -69,6 +70,7 @@ int GetNumValue(const char* name, void* p_value, unsigned long len);
 #define NAME_NFA_DM_DISC_DURATION_POLL  "NFA_DM_DISC_DURATION_POLL"
 #define NAME_SPD_DEBUG                  "SPD_DEBUG"
 #define NAME_SPD_MAXRETRYCOUNT          "SPD_MAX_RETRY_COUNT"
+#define NAME_SPD_FORCE_PATCH_CHECK      "SPD_FORCE_PATCH_CHECK"
 #define NAME_SPI_NEGOTIATION            "SPI_NEGOTIATION"
 #define NAME_AID_FOR_EMPTY_SELECT       "AID_FOR_EMPTY_SELECT"
 #define NAME_PRESERVE_STORAGE           "PRESERVE_STORAGE"
@@ -88,6 +90,7 @@ int GetNumValue(const char* name, void* p_value, unsigned long len);
 #define NAME_POWER_OFF_MODE             "POWER_OFF_MODE"
 #define NAME_GLOBAL_RESET               "DO_GLOBAL_RESET"
 #define NAME_NCI_HAL_MODULE             "NCI_HAL_MODULE"
+#define NAME_CE_T4T_MAX_REG_AID         "CE_T4T_MAX_REG_AID"
 
 #define                     LPTD_PARAM_LEN (40)
 
@@ -198,6 +198,15 @@
 #define NFC_DYNAMIC_MEMORY              FALSE
 #endif
 
+/* Keep fragments of a chained NCI data packet as separate buffers and copy them into
+ * one buffer only when the last fragment arrives. Payloads bigger than the largest
+ * GKI buffer are delivered in pieces with status NFC_STATUS_CONTINUE.
+ * When FALSE, each fragment is appended to the previous buffer as it arrives.
+*/
+#ifndef NFC_CHAINED_REASSEMBLY
+#define NFC_CHAINED_REASSEMBLY          TRUE
+#endif
+
 /* Timeout for receiving response to NCI command */
 #ifndef NFC_CMD_CMPL_TIMEOUT
 #define NFC_CMD_CMPL_TIMEOUT        2
@@ -325,11 +334,16 @@
 #define CE_T4T_MANDATORY_NDEF_FILE_ID    0x1000
 #endif
 
-/* CE Type 4 Tag, max number of AID supported */
+/* CE Type 4 Tag, default max number of AID supported (see ce_t4t_max_reg_aid_cfg) */
 #ifndef CE_T4T_MAX_REG_AID
 #define CE_T4T_MAX_REG_AID         4
 #endif
 
+/* CE Type 4 Tag, SELECT by a partial AID (ISO/IEC 7816-4) selects the first/next registered AID starting with it */
+#ifndef CE_T4T_PARTIAL_AID_SELECT
+#define CE_T4T_PARTIAL_AID_SELECT   FALSE
+#endif
+
 /* Sub carrier */
 #ifndef RW_I93_FLAG_SUB_CARRIER
 #define RW_I93_FLAG_SUB_CARRIER     I93_FLAG_SUB_CARRIER_SINGLE
@@ -404,11 +418,30 @@
 #define LLCP_INTERNAL_RX_DELAY      210
 #endif
 
-/* Wait for application layer sending data before sending SYMM */
+/* Wait for application layer sending data before sending SYMM, max wait if LLCP_ADAPTIVE_SYMM_DELAY */
 #ifndef LLCP_DELAY_RESP_TIME
 #define LLCP_DELAY_RESP_TIME        20      /* in ms */
 #endif
 
+/*
+** Adapt SYMM response delay and delay of the first PDU as initiator to measured response time
+** of application layer. While PDUs are being exchanged, SYMM is sent without delay if application
+** layer has nothing to respond to, so that peer gets its turn sooner.
+*/
+#ifndef LLCP_ADAPTIVE_SYMM_DELAY
+#define LLCP_ADAPTIVE_SYMM_DELAY    TRUE
+#endif
+
+/* Time without PDU other than SYMM after which SYMM is delayed by LLCP_DELAY_RESP_TIME again */
+#ifndef LLCP_ADAPTIVE_SYMM_IDLE_TIME
+#define LLCP_ADAPTIVE_SYMM_IDLE_TIME    100     /* in ms */
+#endif
+
+/* Number of waits in a row without data from application layer before not waiting any more */
+#ifndef LLCP_ADAPTIVE_SYMM_CREDIT
+#define LLCP_ADAPTIVE_SYMM_CREDIT   3
+#endif
+
 /* LLCP inactivity timeout for initiator */
 #ifndef LLCP_INIT_INACTIVITY_TIMEOUT
 #define LLCP_INIT_INACTIVITY_TIMEOUT            0    /* in ms */
@@ -459,7 +492,7 @@
 #define LLCP_MAX_CLIENT             20
 #endif
 
-/* Max number of data link connections */
+/* Max number of data link connections, up to 127 (NFA P2P connection handle has 7 bits of index) */
 #ifndef LLCP_MAX_DATA_LINK
 #define LLCP_MAX_DATA_LINK          16
 #endif
@@ -469,6 +502,16 @@
 #define LLCP_MAX_SDP_TRANSAC        16
 #endif
 
+/* Number of hash buckets for looking up local service names */
+#ifndef LLCP_SDP_SN_HASH_SIZE
+#define LLCP_SDP_SN_HASH_SIZE       16
+#endif
+
+/* Max number of remote service names cached per link activation, at least 1 */
+#ifndef LLCP_SDP_CACHE_SIZE
+#define LLCP_SDP_CACHE_SIZE         8
+#endif
+
 /* Percentage of LLCP buffer pool for receiving data */
 #ifndef LLCP_RX_BUFF_RATIO
 #define LLCP_RX_BUFF_RATIO                  30
@@ -683,7 +726,13 @@
 **  as the NFC stack.
 *****************************************************************************/
 #ifndef HAL_WRITE
+
+#ifdef NFC_HAL_SHARED_GKI
+/* HAL uses the same GKI pools: hand the buffer over instead of copying it */
+#define HAL_WRITE(p)    HAL_NfcWriteBuf((NFC_HDR *)(p))
+#else
 #define HAL_WRITE(p)    {nfc_cb.p_hal->write(p->len, (UINT8 *)(p+1) + p->offset); GKI_freebuf(p);}
+#endif
 
 #ifdef NFC_HAL_SHARED_GKI
 
@@ -39,7 +39,6 @@
 #define NFA_EE_ROUT_TIMEOUT_VAL         1000
 #endif
 
-#define NFA_EE_ROUT_BUF_SIZE            540
 #define NFA_EE_ROUT_MAX_TLV_SIZE        0xFD
 
 
@@ -79,6 +78,9 @@ const UINT8 nfa_ee_proto_list[NFA_EE_NUM_PROTO] =
     NFC_PROTOCOL_NFC_DEP
 };
 
+/* the most technology and protocol routing one NFCEE/DH can add (5 bytes each) */
+#define NFA_EE_ROUT_ECB_MAX_SIZE        ((NFA_EE_NUM_TECH + NFA_EE_NUM_PROTO) * 5)
+
 static void nfa_ee_report_discover_req_evt(void);
 static void nfa_ee_build_discover_req_evt (tNFA_EE_DISCOVER_REQ *p_evt_data);
 /*******************************************************************************
@@ -163,44 +165,6 @@ static void nfa_ee_update_route_size(tNFA_EE_ECB *p_cb)
     NFA_TRACE_DEBUG2 ("nfa_ee_update_route_size nfcee_id:0x%x size_mask:%d", p_cb->nfcee_id, p_cb->size_mask);
 }
 
-/*******************************************************************************
-**
-** Function         nfa_ee_update_route_aid_size
-**
-** Description      Update the size required for AID routing
-**                  of the given NFCEE ID.
-**
-** Returns          void
-**
-*******************************************************************************/
-static void nfa_ee_update_route_aid_size(tNFA_EE_ECB *p_cb)
-{
-    UINT8   *pa, len;
-    int     start_offset;
-    int     xx;
-
-    p_cb->size_aid  = 0;
-    if (p_cb->aid_entries)
-    {
-        start_offset = 0;
-        for (xx = 0; xx < p_cb->aid_entries; xx++)
-        {
-            /* add one AID entry */
-            if (p_cb->aid_rt_info[xx] & NFA_EE_AE_ROUTE)
-            {
-                pa      = &p_cb->aid_cfg[start_offset];
-                pa ++; /* EMV tag */
-                len     = *pa++; /* aid_len */
-                /* 4 = 1 (tag) + 1 (len) + 1(nfcee_id) + 1(power cfg) */
-                p_cb->size_aid  += 4;
-                p_cb->size_aid  += len;
-            }
-            start_offset += p_cb->aid_len[xx];
-        }
-    }
-    NFA_TRACE_DEBUG2 ("nfa_ee_update_route_aid_size nfcee_id:0x%x size_aid:%d", p_cb->nfcee_id, p_cb->size_aid);
-}
-
 /*******************************************************************************
 **
 ** Function         nfa_ee_total_lmrt_size
@@ -265,77 +229,252 @@ static void nfa_ee_conn_cback (UINT8 conn_id, tNFC_CONN_EVT event, tNFC_CONN *p_
 
 /*******************************************************************************
 **
-** Function         nfa_ee_find_total_aid_len
+** Function         nfa_ee_aid_sym
 **
-** Description      Find the total len in aid_cfg from start_entry to the last
+** Description      Get the byte at the given offset of an AID, widened to 9
+**                  bits for the AID trie: 0x100 | byte within the AID and 0
+**                  past its end.
 **
-** Returns          void
+** Returns          UINT16
+**
+*******************************************************************************/
+static UINT16 nfa_ee_aid_sym (UINT8 aid_len, UINT8 *p_aid, UINT8 byte)
+{
+    return ((byte < aid_len) ? (UINT16) (0x100 | p_aid[byte]) : 0);
+}
+
+/*******************************************************************************
+**
+** Function         nfa_ee_aid_closest
+**
+** Description      Walk the AID trie down to the entry the given AID would
+**                  sit next to. It is the entry of this AID, if there is one.
+**
+** Returns          NFA_EE_AID_LEAF | entry, or NFA_EE_AID_NONE if empty
 **
 *******************************************************************************/
-int nfa_ee_find_total_aid_len(tNFA_EE_ECB *p_cb, int start_entry)
+static UINT16 nfa_ee_aid_closest (UINT8 aid_len, UINT8 *p_aid)
 {
-    int len = 0, xx;
+    UINT16              ref = nfa_ee_cb.aid_root;
+    tNFA_EE_AID_NODE    *p_node;
 
-    if (p_cb->aid_entries > start_entry)
+    while ((ref != NFA_EE_AID_NONE) && !(ref & NFA_EE_AID_LEAF))
+    {
+        p_node  = &nfa_ee_cb.aid_node[ref - 1];
+        ref     = p_node->child[(nfa_ee_aid_sym (aid_len, p_aid, p_node->byte) & p_node->bit) ? 1 : 0];
+    }
+    return ref;
+}
+
+/*******************************************************************************
+**
+** Function         nfa_ee_aid_add_entry
+**
+** Description      Add an AID that is not in the database yet to the AID trie
+**                  and to the end of the AID entries of the given NFCEE, as
+**                  an entry for the listen mode routing table.
+**
+** Returns          the new entry, or NULL if out of entries
+**
+*******************************************************************************/
+static tNFA_EE_AID_ENTRY *nfa_ee_aid_add_entry (tNFA_EE_ECB *p_cb, UINT8 aid_len, UINT8 *p_aid, UINT8 pwr_cfg)
+{
+    tNFA_EE_AID_ENTRY   *p_entry, *p_near;
+    tNFA_EE_AID_NODE    *p_node;
+    UINT16              entry, node = NFA_EE_AID_NONE, near;
+    UINT16              *p_ref;
+    UINT16              sym, near_sym, bit;
+    UINT8               byte;
+    int                 dir;
+
+    /* take an entry, and a node unless this is the first entry */
+    near = nfa_ee_aid_closest (aid_len, p_aid);
+    if (near != NFA_EE_AID_NONE)
+    {
+        if ((node = nfa_ee_cb.aid_free_node) != NFA_EE_AID_NONE)
+            nfa_ee_cb.aid_free_node = nfa_ee_cb.aid_node[node - 1].child[0];
+        else if (nfa_ee_cb.aid_node_used < NFA_EE_MAX_AID_POOL)
+            node = ++nfa_ee_cb.aid_node_used;
+        else
+            return NULL;
+    }
+    if ((entry = nfa_ee_cb.aid_free_entry) != NFA_EE_AID_NONE)
+        nfa_ee_cb.aid_free_entry = nfa_ee_cb.aid_entry[entry - 1].next;
+    else if (nfa_ee_cb.aid_entry_used < NFA_EE_MAX_AID_POOL)
+        entry = ++nfa_ee_cb.aid_entry_used;
+    else
     {
-        for (xx = start_entry; xx < p_cb->aid_entries; xx++)
+        if (node != NFA_EE_AID_NONE)
         {
-            len += p_cb->aid_len[xx];
+            nfa_ee_cb.aid_node[node - 1].child[0] = nfa_ee_cb.aid_free_node;
+            nfa_ee_cb.aid_free_node = node;
         }
+        return NULL;
+    }
+
+    p_entry             = &nfa_ee_cb.aid_entry[entry - 1];
+    p_entry->ecb_inx    = (UINT8) (p_cb - nfa_ee_cb.ecb);
+    p_entry->pwr_cfg    = pwr_cfg;
+    p_entry->rt_info    = NFA_EE_AE_ROUTE;
+    p_entry->aid_len    = aid_len;
+    memcpy (p_entry->aid, p_aid, aid_len);
+
+    /* append to the entries of this NFCEE */
+    p_entry->next       = NFA_EE_AID_NONE;
+    p_entry->prev       = p_cb->aid_last;
+    if (p_cb->aid_last != NFA_EE_AID_NONE)
+        nfa_ee_cb.aid_entry[p_cb->aid_last - 1].next = entry;
+    else
+        p_cb->aid_first = entry;
+    p_cb->aid_last      = entry;
+    p_cb->aid_entries++;
+    p_cb->aid_cfg_len  += aid_len + 2; /* tag/len */
+    /* 4 = 1 (tag) + 1 (len) + 1(nfcee_id) + 1(power cfg) */
+    p_cb->size_aid     += 4 + aid_len;
+
+    if (near == NFA_EE_AID_NONE)
+    {
+        nfa_ee_cb.aid_root = NFA_EE_AID_LEAF | entry;
+        return p_entry;
+    }
+
+    /* find the first bit where the new AID differs from its closest entry;
+     * at the latest the end of the shorter one */
+    p_near = &nfa_ee_cb.aid_entry[(near & ~NFA_EE_AID_LEAF) - 1];
+    for (byte = 0; ; byte++)
+    {
+        sym         = nfa_ee_aid_sym (aid_len, p_aid, byte);
+        near_sym    = nfa_ee_aid_sym (p_near->aid_len, p_near->aid, byte);
+        if (sym != near_sym)
+            break;
+    }
+    bit = sym ^ near_sym;
+    while (bit & (bit - 1))
+        bit &= bit - 1;
+    dir = (sym & bit) ? 1 : 0;
+
+    /* the new node goes above the first node that tests a later bit */
+    p_ref = &nfa_ee_cb.aid_root;
+    while (!(*p_ref & NFA_EE_AID_LEAF))
+    {
+        p_node = &nfa_ee_cb.aid_node[*p_ref - 1];
+        if ((p_node->byte > byte) || ((p_node->byte == byte) && (p_node->bit < bit)))
+            break;
+        p_ref = &p_node->child[(nfa_ee_aid_sym (aid_len, p_aid, p_node->byte) & p_node->bit) ? 1 : 0];
     }
-    return len;
+
+    p_node                  = &nfa_ee_cb.aid_node[node - 1];
+    p_node->byte            = byte;
+    p_node->bit             = bit;
+    p_node->child[dir]      = NFA_EE_AID_LEAF | entry;
+    p_node->child[1 - dir]  = *p_ref;
+    *p_ref                  = node;
+
+    return p_entry;
 }
 
+/*******************************************************************************
+**
+** Function         nfa_ee_aid_remove_entry
+**
+** Description      Remove the given AID entry from the AID trie and from the
+**                  AID entries of its NFCEE.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfa_ee_aid_remove_entry (tNFA_EE_AID_ENTRY *p_entry)
+{
+    tNFA_EE_ECB         *p_cb = &nfa_ee_cb.ecb[p_entry->ecb_inx];
+    tNFA_EE_AID_NODE    *p_node = NULL;
+    UINT16              entry = (UINT16) (p_entry - nfa_ee_cb.aid_entry) + 1;
+    UINT16              node;
+    UINT16              *p_ref, *p_parent = NULL;
+    int                 dir = 0;
+
+    /* replace the parent node of the entry by the other child */
+    p_ref = &nfa_ee_cb.aid_root;
+    while (!(*p_ref & NFA_EE_AID_LEAF))
+    {
+        p_parent    = p_ref;
+        p_node      = &nfa_ee_cb.aid_node[*p_ref - 1];
+        dir         = (nfa_ee_aid_sym (p_entry->aid_len, p_entry->aid, p_node->byte) & p_node->bit) ? 1 : 0;
+        p_ref       = &p_node->child[dir];
+    }
+    if (p_parent == NULL)
+    {
+        nfa_ee_cb.aid_root = NFA_EE_AID_NONE;
+    }
+    else
+    {
+        node        = *p_parent;
+        *p_parent   = p_node->child[1 - dir];
+        p_node->child[0]        = nfa_ee_cb.aid_free_node;
+        nfa_ee_cb.aid_free_node = node;
+    }
 
+    /* unlink from the entries of the NFCEE */
+    if (p_entry->prev != NFA_EE_AID_NONE)
+        nfa_ee_cb.aid_entry[p_entry->prev - 1].next = p_entry->next;
+    else
+        p_cb->aid_first = p_entry->next;
+    if (p_entry->next != NFA_EE_AID_NONE)
+        nfa_ee_cb.aid_entry[p_entry->next - 1].prev = p_entry->prev;
+    else
+        p_cb->aid_last  = p_entry->prev;
+    p_cb->aid_entries--;
+    p_cb->aid_cfg_len  -= p_entry->aid_len + 2;
+    if (p_entry->rt_info & NFA_EE_AE_ROUTE)
+        p_cb->size_aid -= 4 + p_entry->aid_len;
+
+    p_entry->next               = nfa_ee_cb.aid_free_entry;
+    nfa_ee_cb.aid_free_entry    = entry;
+}
 
+/*******************************************************************************
+**
+** Function         nfa_ee_aid_remove_all
+**
+** Description      Remove all the AID entries of the given NFCEE.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfa_ee_aid_remove_all (tNFA_EE_ECB *p_cb)
+{
+    while (p_cb->aid_first != NFA_EE_AID_NONE)
+        nfa_ee_aid_remove_entry (&nfa_ee_cb.aid_entry[p_cb->aid_first - 1]);
+}
 
 /*******************************************************************************
 **
-** Function         nfa_ee_find_aid_offset
+** Function         nfa_ee_find_aid_entry
 **
 ** Description      Given the AID, find the associated tNFA_EE_ECB and the
-**                  offset in aid_cfg[]. *p_entry is the index.
+**                  AID entry (*pp_entry) in the AID trie.
 **
-** Returns          void
+** Returns          tNFA_EE_ECB *, or NULL if the AID is not in the database
 **
 *******************************************************************************/
-tNFA_EE_ECB * nfa_ee_find_aid_offset(UINT8 aid_len, UINT8 *p_aid, int *p_offset, int *p_entry)
+tNFA_EE_ECB * nfa_ee_find_aid_entry(UINT8 aid_len, UINT8 *p_aid, tNFA_EE_AID_ENTRY **pp_entry)
 {
-    int  xx, yy, aid_len_offset, offset;
-    tNFA_EE_ECB *p_ret = NULL, *p_ecb;
+    tNFA_EE_AID_ENTRY   *p_entry;
+    UINT16              ref;
 
-    p_ecb = &nfa_ee_cb.ecb[NFA_EE_CB_4_DH];
-    aid_len_offset = 1; /* skip the tag */
-    for (yy = 0; yy < nfa_ee_cb.cur_ee; yy++, p_ecb++)
+    ref = nfa_ee_aid_closest (aid_len, p_aid);
+    if (ref != NFA_EE_AID_NONE)
     {
-        if (p_ecb->aid_entries)
+        p_entry = &nfa_ee_cb.aid_entry[(ref & ~NFA_EE_AID_LEAF) - 1];
+        if (  (p_entry->aid_len == aid_len)
+            &&(memcmp (p_entry->aid, p_aid, aid_len) == 0)  )
         {
-            offset = 0;
-            for (xx = 0; xx < p_ecb->aid_entries; xx++)
-            {
-                if (  (p_ecb->aid_cfg[offset + aid_len_offset] == aid_len)
-                    &&(memcmp(&p_ecb->aid_cfg[offset + aid_len_offset + 1], p_aid, aid_len) == 0)  )
-                {
-                    p_ret = p_ecb;
-                    if (p_offset)
-                        *p_offset = offset;
-                    if (p_entry)
-                        *p_entry  = xx;
-                    break;
-                }
-                offset += p_ecb->aid_len[xx];
-            }
-
-            if (p_ret)
-            {
-                /* found the entry already */
-                break;
-            }
+            if (pp_entry)
+                *pp_entry = p_entry;
+            return (&nfa_ee_cb.ecb[p_entry->ecb_inx]);
         }
-        p_ecb = &nfa_ee_cb.ecb[yy];
     }
 
-    return p_ret;
+    return NULL;
 }
 
 /*******************************************************************************
@@ -625,30 +764,34 @@ void nfa_ee_api_add_aid(tNFA_EE_MSG *p_data)
     tNFA_EE_API_ADD_AID *p_add = &p_data->add_aid;
     tNFA_EE_ECB *p_cb = p_data->cfg_hdr.p_cb;
     tNFA_EE_ECB *p_chk_cb;
-    UINT8   *p, *p_start;
+    tNFA_EE_AID_ENTRY *p_entry = NULL;
     int     len, len_needed;
     tNFA_EE_CBACK_DATA  evt_data = {0};
-    int offset = 0, entry = 0;
     UINT16  new_size;
 
     nfa_ee_trace_aid ("nfa_ee_api_add_aid", p_cb->nfcee_id, p_add->aid_len, p_add->p_aid);
-    p_chk_cb = nfa_ee_find_aid_offset(p_add->aid_len, p_add->p_aid, &offset, &entry);
+    p_chk_cb = nfa_ee_find_aid_entry(p_add->aid_len, p_add->p_aid, &p_entry);
     if (p_chk_cb)
     {
         NFA_TRACE_DEBUG0 ("nfa_ee_api_add_aid The AID entry is already in the database");
         if (p_chk_cb == p_cb)
         {
-            p_cb->aid_rt_info[entry]    |= NFA_EE_AE_ROUTE;
+            if (!(p_entry->rt_info & NFA_EE_AE_ROUTE))
+            {
+                p_entry->rt_info    |= NFA_EE_AE_ROUTE;
+                p_cb->size_aid      += 4 + p_entry->aid_len;
+            }
             new_size = nfa_ee_total_lmrt_size();
             if (new_size > NFC_GetLmrtSize())
             {
                 NFA_TRACE_ERROR1 ("Exceed LMRT size:%d (add ROUTE)", new_size);
-                evt_data.status             = NFA_STATUS_BUFFER_FULL;
-                p_cb->aid_rt_info[entry]    &= ~NFA_EE_AE_ROUTE;
+                evt_data.status     = NFA_STATUS_BUFFER_FULL;
+                p_entry->rt_info    &= ~NFA_EE_AE_ROUTE;
+                p_cb->size_aid      -= 4 + p_entry->aid_len;
             }
             else
             {
-                p_cb->aid_pwr_cfg[entry]     = p_add->power_state;
+                p_entry->pwr_cfg    = p_add->power_state;
             }
         }
         else
@@ -660,7 +803,7 @@ void nfa_ee_api_add_aid(tNFA_EE_MSG *p_data)
     else
     {
         /* Find the total length so far */
-        len = nfa_ee_find_total_aid_len(p_cb, 0);
+        len = p_cb->aid_cfg_len;
 
         /* make sure the control block has enough room to hold this entry */
         len_needed  = p_add->aid_len + 2; /* tag/len */
@@ -678,19 +821,10 @@ void nfa_ee_api_add_aid(tNFA_EE_MSG *p_data)
                 NFA_TRACE_ERROR1 ("Exceed LMRT size:%d", new_size);
                 evt_data.status        = NFA_STATUS_BUFFER_FULL;
             }
-            else
+            else if (nfa_ee_aid_add_entry (p_cb, p_add->aid_len, p_add->p_aid, p_add->power_state) == NULL)
             {
-                /* add AID */
-                p_cb->aid_pwr_cfg[p_cb->aid_entries]    = p_add->power_state;
-                p_cb->aid_rt_info[p_cb->aid_entries]    = NFA_EE_AE_ROUTE;
-                p       = p_cb->aid_cfg + len;
-                p_start = p;
-                *p++    = NFA_EE_AID_CFG_TAG_NAME;
-                *p++    = p_add->aid_len;
-                memcpy(p, p_add->p_aid, p_add->aid_len);
-                p      += p_add->aid_len;
-
-                p_cb->aid_len[p_cb->aid_entries++]     = (UINT8)(p - p_start);
+                NFA_TRACE_ERROR1 ("Exceed NFA_EE_MAX_AID_POOL:%d", NFA_EE_MAX_AID_POOL);
+                evt_data.status        = NFA_STATUS_BUFFER_FULL;
             }
         }
         else
@@ -705,7 +839,7 @@ void nfa_ee_api_add_aid(tNFA_EE_MSG *p_data)
         /* mark AID changed */
         p_cb->ecb_flags                       |= NFA_EE_ECB_FLAGS_AID;
         nfa_ee_cb.ee_cfged                    |= nfa_ee_ecb_to_mask(p_cb);
-        nfa_ee_update_route_aid_size(p_cb);
+        NFA_TRACE_DEBUG2 ("nfa_ee_api_add_aid nfcee_id:0x%x size_aid:%d", p_cb->nfcee_id, p_cb->size_aid);
         nfa_ee_start_timer();
     }
     NFA_TRACE_DEBUG2 ("status:%d ee_cfged:0x%02x ",evt_data.status, nfa_ee_cb.ee_cfged);
@@ -727,42 +861,26 @@ void nfa_ee_api_add_aid(tNFA_EE_MSG *p_data)
 void nfa_ee_api_remove_aid(tNFA_EE_MSG *p_data)
 {
     tNFA_EE_ECB  *p_cb;
+    tNFA_EE_AID_ENTRY *p_entry = NULL;
     tNFA_EE_CBACK_DATA  evt_data = {0};
-    int offset = 0, entry = 0, len;
-    int rest_len;
     tNFA_EE_CBACK *p_cback = NULL;
 
     nfa_ee_trace_aid ("nfa_ee_api_remove_aid", 0, p_data->rm_aid.aid_len, p_data->rm_aid.p_aid);
-    p_cb = nfa_ee_find_aid_offset(p_data->rm_aid.aid_len, p_data->rm_aid.p_aid, &offset, &entry);
-    if (p_cb && p_cb->aid_entries)
+    p_cb = nfa_ee_find_aid_entry(p_data->rm_aid.aid_len, p_data->rm_aid.p_aid, &p_entry);
+    if (p_cb)
     {
-        NFA_TRACE_DEBUG2 ("aid_rt_info[%d]: 0x%02x", entry, p_cb->aid_rt_info[entry]);
+        NFA_TRACE_DEBUG1 ("rt_info: 0x%02x", p_entry->rt_info);
         /* mark routing and VS changed */
-        if (p_cb->aid_rt_info[entry] & NFA_EE_AE_ROUTE)
+        if (p_entry->rt_info & NFA_EE_AE_ROUTE)
             p_cb->ecb_flags         |= NFA_EE_ECB_FLAGS_AID;
 
-        if (p_cb->aid_rt_info[entry] & NFA_EE_AE_VS)
+        if (p_entry->rt_info & NFA_EE_AE_VS)
             p_cb->ecb_flags         |= NFA_EE_ECB_FLAGS_VS;
 
         /* remove the aid */
-        if ((entry+1) < p_cb->aid_entries)
-        {
-            /* not the last entry, move the aid entries in control block */
-            /* Find the total len from the next entry to the last one */
-            rest_len = nfa_ee_find_total_aid_len(p_cb, entry + 1);
-
-            len = p_cb->aid_len[entry];
-            NFA_TRACE_DEBUG2 ("nfa_ee_api_remove_aid len:%d, rest_len:%d", len, rest_len);
-            GKI_shiftup (&p_cb->aid_cfg[offset], &p_cb->aid_cfg[offset+ len], rest_len);
-            rest_len = p_cb->aid_entries - entry;
-            GKI_shiftup (&p_cb->aid_len[entry], &p_cb->aid_len[entry + 1], rest_len);
-            GKI_shiftup (&p_cb->aid_pwr_cfg[entry], &p_cb->aid_pwr_cfg[entry + 1], rest_len);
-            GKI_shiftup (&p_cb->aid_rt_info[entry], &p_cb->aid_rt_info[entry + 1], rest_len);
-        }
-        /* else the last entry, just reduce the aid_entries by 1 */
-        p_cb->aid_entries--;
+        nfa_ee_aid_remove_entry (p_entry);
         nfa_ee_cb.ee_cfged      |= nfa_ee_ecb_to_mask(p_cb);
-        nfa_ee_update_route_aid_size(p_cb);
+        NFA_TRACE_DEBUG2 ("nfa_ee_api_remove_aid nfcee_id:0x%x size_aid:%d", p_cb->nfcee_id, p_cb->size_aid);
         nfa_ee_start_timer();
         /* report NFA_EE_REMOVE_AID_EVT to the callback associated the NFCEE */
         p_cback = p_cb->p_ee_cback;
@@ -1013,6 +1131,7 @@ static void nfa_ee_remove_pending(void)
     tNFA_EE_ECB     *p_cb_n, *p_cb_end;
     int             xx, num_removed = 0;
     int             first_removed = NFA_EE_MAX_EE_SUPPORTED;
+    UINT16          entry;
 
     p_cb = nfa_ee_cb.ecb;
     for (xx = 0; xx < nfa_ee_cb.cur_ee; xx++, p_cb++)
@@ -1020,6 +1139,7 @@ static void nfa_ee_remove_pending(void)
         if ((p_cb->nfcee_id != NFA_EE_INVALID) && (p_cb->ee_status & NFA_EE_STATUS_RESTORING))
         {
             p_cb->nfcee_id  = NFA_EE_INVALID;
+            nfa_ee_aid_remove_all (p_cb);
             num_removed ++;
             if (first_removed == NFA_EE_MAX_EE_SUPPORTED)
                 first_removed   = xx;
@@ -1043,6 +1163,11 @@ static void nfa_ee_remove_pending(void)
             {
                 memcpy(p_cb, p_cb_n, sizeof(tNFA_EE_ECB));
                 p_cb_n->nfcee_id = NFA_EE_INVALID;
+                /* the AID entries move with the NFCEE */
+                for (entry = p_cb->aid_first; entry != NFA_EE_AID_NONE; entry = nfa_ee_cb.aid_entry[entry - 1].next)
+                    nfa_ee_cb.aid_entry[entry - 1].ecb_inx = (UINT8) (p_cb - nfa_ee_cb.ecb);
+                p_cb_n->aid_first   = p_cb_n->aid_last = NFA_EE_AID_NONE;
+                p_cb_n->aid_entries = p_cb_n->aid_cfg_len = p_cb_n->size_aid = 0;
             }
             p_cb++;
             p_cb_n++;
@@ -1461,7 +1586,7 @@ void nfa_ee_nci_mode_set_rsp(tNFA_EE_MSG *p_data)
             }
             p_cb->tech_switch_on    = p_cb->tech_switch_off = p_cb->tech_battery_off    = 0;
             p_cb->proto_switch_on   = p_cb->proto_switch_off= p_cb->proto_battery_off   = 0;
-            p_cb->aid_entries       = 0;
+            nfa_ee_aid_remove_all (p_cb);
             p_cb->ee_status = NFC_NFCEE_STATUS_INACTIVE;
         }
     }
@@ -1545,7 +1670,25 @@ void nfa_ee_nci_wait_rsp(tNFA_EE_MSG *p_data)
     if (nfa_ee_cb.wait_rsp)
     {
         if (p_rsp->opcode == NCI_MSG_RF_SET_ROUTING)
+        {
             nfa_ee_cb.wait_rsp--;
+            if (((tNFC_RESPONSE *) p_rsp->p_data)->status != NFC_STATUS_OK)
+            {
+                /* NFCC may have only part of the table */
+                nfa_ee_cb.lmrt_stats.num_fail++;
+                nfa_ee_cb.lmrt_st   = NFA_EE_LMRT_ST_NONE;
+            }
+            else if ((nfa_ee_cb.wait_rsp == 0) && (nfa_ee_cb.lmrt_st == NFA_EE_LMRT_ST_SENT))
+            {
+                nfa_ee_cb.lmrt_st   = NFA_EE_LMRT_ST_ACKED;
+                nfa_ee_cb.lmrt_stats.last_ms = GKI_TICKS_TO_MS (GKI_get_tick_count () - nfa_ee_cb.lmrt_stats.start_tick);
+                if (nfa_ee_cb.lmrt_stats.last_ms > nfa_ee_cb.lmrt_stats.max_ms)
+                    nfa_ee_cb.lmrt_stats.max_ms = nfa_ee_cb.lmrt_stats.last_ms;
+                NFA_TRACE_DEBUG6 ("LMRT committed: %d ms (max %d ms); commits:%d skipped:%d cmds:%d failed:%d",
+                    nfa_ee_cb.lmrt_stats.last_ms, nfa_ee_cb.lmrt_stats.max_ms, nfa_ee_cb.lmrt_stats.num_commits,
+                    nfa_ee_cb.lmrt_stats.num_skipped, nfa_ee_cb.lmrt_stats.num_frags, nfa_ee_cb.lmrt_stats.num_fail);
+            }
+        }
     }
     nfa_ee_report_update_evt ();
 }
@@ -1857,71 +2000,25 @@ void nfa_ee_get_tech_route (UINT8 power_state, UINT8 *p_handles)
     NFA_TRACE_DEBUG4("0x%x, 0x%x, 0x%x, 0x%x", p_handles[0], p_handles[1], p_handles[2], p_handles[3]);
 }
 
-/*******************************************************************************
-**
-** Function         nfa_ee_check_set_routing
-**
-** Description      If the new size exceeds the capacity of next block,
-**                  send the routing command now and reset the related parameters
-**
-** Returns          void
-**
-*******************************************************************************/
-void nfa_ee_check_set_routing(UINT16 new_size, int *p_max_len, UINT8 *p, int *p_cur_offset)
-{
-    UINT8   max_tlv = (UINT8)((*p_max_len > NFA_EE_ROUT_MAX_TLV_SIZE)?NFA_EE_ROUT_MAX_TLV_SIZE:*p_max_len);
-    tNFA_STATUS status = NFA_STATUS_OK;
-
-    if (new_size + *p_cur_offset > max_tlv)
-    {
-        if (NFC_SetRouting(TRUE, *p, *p_cur_offset, p + 1) == NFA_STATUS_OK)
-        {
-            nfa_ee_cb.wait_rsp++;
-        }
-        /* after the routing command is sent, re-use the same buffer to send the next routing command.
-         * reset the related parameters */
-        if (*p_max_len > *p_cur_offset)
-            *p_max_len     -= *p_cur_offset;/* the max is reduced */
-        else
-            *p_max_len      = 0;
-        *p_cur_offset   = 0;                /* nothing is in queue any more */
-        *p              = 0;                /* num_tlv=0 */
-    }
-}
-
 /*******************************************************************************
 **
 ** Function         nfa_ee_route_add_one_ecb
 **
-** Description      Add the routing entries for one NFCEE/DH
+** Description      Add the routing entries for one NFCEE/DH to the listen mode
+**                  routing table being built at *pp_lmrt
 **
-** Returns          NFA_STATUS_OK, if ok to continue
+** Returns          void
 **
 *******************************************************************************/
-tNFA_STATUS nfa_ee_route_add_one_ecb(tNFA_EE_ECB *p_cb, int *p_max_len, BOOLEAN more, UINT8 *ps, int *p_cur_offset)
+static void nfa_ee_route_add_one_ecb(tNFA_EE_ECB *p_cb, UINT8 **pp_lmrt)
 {
-    UINT8   *p, *pa;
+    UINT8   *pp = *pp_lmrt;
     UINT16  tlv_size;
-    UINT8   num_tlv, len;
     int     xx;
-    int     start_offset;
+    UINT16  entry;
+    tNFA_EE_AID_ENTRY *p_entry;
     UINT8   power_cfg = 0;
-    UINT8   *pp = ps + *p_cur_offset;
-    UINT8   entry_size;
-    UINT8   max_tlv;
-    UINT8   *p_start;
-    UINT8   new_size;
-    tNFA_STATUS status = NFA_STATUS_OK;
-
-    nfa_ee_check_set_routing (p_cb->size_mask, p_max_len, ps, p_cur_offset);
-    max_tlv = (UINT8)((*p_max_len > NFA_EE_ROUT_MAX_TLV_SIZE)?NFA_EE_ROUT_MAX_TLV_SIZE:*p_max_len);
-    /* use the first byte of the buffer (ps) to keep the num_tlv */
-    num_tlv  = *ps;
-    NFA_TRACE_DEBUG5 ("nfa_ee_route_add_one_ecb max_len:%d, max_tlv:%d, cur_offset:%d, more:%d, num_tlv:%d",
-        *p_max_len, max_tlv, *p_cur_offset, more, num_tlv);
-    pp       = ps + 1 + *p_cur_offset;
-    p        = pp;
-    tlv_size = (UINT8)*p_cur_offset;
+
     /* add the Technology based routing */
     for (xx = 0; xx < NFA_EE_NUM_TECH; xx++)
     {
@@ -1939,7 +2036,6 @@ tNFA_STATUS nfa_ee_route_add_one_ecb(tNFA_EE_ECB *p_cb, int *p_max_len, BOOLEAN
             *pp++   = p_cb->nfcee_id;
             *pp++   = power_cfg;
             *pp++   = nfa_ee_tech_list[xx];
-            num_tlv++;
             if (power_cfg != NCI_ROUTE_PWR_STATE_ON)
                 nfa_ee_cb.ee_cfged  |= NFA_EE_CFGED_OFF_ROUTING;
         }
@@ -1962,62 +2058,28 @@ tNFA_STATUS nfa_ee_route_add_one_ecb(tNFA_EE_ECB *p_cb, int *p_max_len, BOOLEAN
             *pp++   = p_cb->nfcee_id;
             *pp++   = power_cfg;
             *pp++   = nfa_ee_proto_list[xx];
-            num_tlv++;
             if (power_cfg != NCI_ROUTE_PWR_STATE_ON)
                 nfa_ee_cb.ee_cfged  |= NFA_EE_CFGED_OFF_ROUTING;
         }
     }
 
-    /* update the num_tlv and current offset */
-    entry_size       = (UINT8)(pp - p);
-    *p_cur_offset   += entry_size;
-    *ps              = num_tlv;
     /* add the AID routing */
-    if (p_cb->aid_entries)
+    for (entry = p_cb->aid_first; entry != NFA_EE_AID_NONE; entry = p_entry->next)
     {
-        start_offset = 0;
-        for (xx = 0; xx < p_cb->aid_entries; xx++)
+        p_entry = &nfa_ee_cb.aid_entry[entry - 1];
+        if (p_entry->rt_info & NFA_EE_AE_ROUTE)
         {
-            p_start     = pp; /* rememebr the beginning of this AID routing entry, just in case we need to put it in next command */
-            /* add one AID entry */
-            if (p_cb->aid_rt_info[xx] & NFA_EE_AE_ROUTE)
-            {
-                num_tlv++;
-                pa      = &p_cb->aid_cfg[start_offset];
-                pa ++; /* EMV tag */
-                len     = *pa++; /* aid_len */
-                *pp++   = NFC_ROUTE_TAG_AID;
-                *pp++   = len + 2;
-                *pp++   = p_cb->nfcee_id;
-                *pp++   = p_cb->aid_pwr_cfg[xx];
-                /* copy the AID */
-                memcpy(pp, pa, len);
-                pp     += len;
-            }
-            start_offset += p_cb->aid_len[xx];
-            new_size        = (UINT8)(pp - p_start);
-            nfa_ee_check_set_routing(new_size, p_max_len, ps, p_cur_offset);
-            if (*ps == 0)
-            {
-                /* just sent routing command, update local */
-                *ps      = 1;
-                num_tlv  = *ps;
-                *p_cur_offset = new_size;
-                pp       = ps + 1;
-                p        = pp;
-                tlv_size = (UINT8)*p_cur_offset;
-                max_tlv  = (UINT8)((*p_max_len > NFA_EE_ROUT_MAX_TLV_SIZE)?NFA_EE_ROUT_MAX_TLV_SIZE:*p_max_len);
-                memcpy (p, p_start, new_size);
-                pp      += new_size;
-            }
-            else
-            {
-                /* add the new entry */
-                *ps              = num_tlv;
-                *p_cur_offset   += new_size;
-            }
+            *pp++   = NFC_ROUTE_TAG_AID;
+            *pp++   = p_entry->aid_len + 2;
+            *pp++   = p_cb->nfcee_id;
+            *pp++   = p_entry->pwr_cfg;
+            /* copy the AID */
+            memcpy(pp, p_entry->aid, p_entry->aid_len);
+            pp     += p_entry->aid_len;
         }
     }
+    NFA_TRACE_DEBUG2 ("nfa_ee_route_add_one_ecb nfcee_id:0x%x size:%d", p_cb->nfcee_id, pp - *pp_lmrt);
+    *pp_lmrt = pp;
 
     tlv_size   = nfa_ee_total_lmrt_size();
     if (tlv_size)
@@ -2029,42 +2091,64 @@ tNFA_STATUS nfa_ee_route_add_one_ecb(tNFA_EE_ECB *p_cb, int *p_max_len, BOOLEAN
         nfa_ee_cb.ee_cfg_sts   |= NFA_EE_STS_CHANGED_ROUTING;
     }
     NFA_TRACE_DEBUG2 ("ee_cfg_sts:0x%02x lmrt_size:%d", nfa_ee_cb.ee_cfg_sts, tlv_size);
+}
+
+/*******************************************************************************
+**
+** Function         nfa_ee_lmrt_send
+**
+** Description      Send the listen mode routing table to NFCC. Each
+**                  RF_SET_LISTEN_MODE_ROUTING command carries as many whole
+**                  entries as fit, so the table takes the fewest commands.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfa_ee_lmrt_send(UINT8 *p_lmrt, UINT16 lmrt_len)
+{
+    UINT8   *p = p_lmrt, *p_end = p_lmrt + lmrt_len, *p_frag;
+    UINT8   num_tlv;
 
-    if (more == FALSE)
+    nfa_ee_cb.lmrt_stats.start_tick = GKI_get_tick_count ();
+    do
     {
-        /* last entry. update routing table now */
-        if (nfa_ee_cb.ee_cfg_sts & NFA_EE_STS_CHANGED_ROUTING)
+        p_frag  = p;
+        num_tlv = 0;
+        /* each entry is a TLV: tag, len, nfcee_id/power state/value */
+        while ((p < p_end) && ((p + 2 + p[1]) - p_frag <= NFA_EE_ROUT_MAX_TLV_SIZE))
         {
-            if (tlv_size)
-            {
-                nfa_ee_cb.ee_cfg_sts       |= NFA_EE_STS_PREV_ROUTING;
-            }
-            else
-            {
-                nfa_ee_cb.ee_cfg_sts       &= ~NFA_EE_STS_PREV_ROUTING;
-            }
-            NFA_TRACE_DEBUG2 ("nfa_ee_route_add_one_ecb: set routing num_tlv:%d tlv_size:%d", num_tlv, tlv_size);
-            if (NFC_SetRouting(more, num_tlv, (UINT8)(*p_cur_offset), ps + 1) == NFA_STATUS_OK)
-            {
-                nfa_ee_cb.wait_rsp++;
-            }
+            p += 2 + p[1];
+            num_tlv++;
         }
-        else if (nfa_ee_cb.ee_cfg_sts & NFA_EE_STS_PREV_ROUTING)
+        NFA_TRACE_DEBUG2 ("nfa_ee_lmrt_send: set routing num_tlv:%d tlv_size:%d", num_tlv, p - p_frag);
+        if (NFC_SetRouting((BOOLEAN) (p < p_end), num_tlv, (UINT8) (p - p_frag), p_frag) == NFA_STATUS_OK)
         {
-            if (tlv_size == 0)
-            {
-                nfa_ee_cb.ee_cfg_sts       &= ~NFA_EE_STS_PREV_ROUTING;
-                /* indicated routing is configured to NFCC */
-                nfa_ee_cb.ee_cfg_sts       |= NFA_EE_STS_CHANGED_ROUTING;
-                if (NFC_SetRouting(more, 0, 0, ps + 1) == NFA_STATUS_OK)
-                {
-                    nfa_ee_cb.wait_rsp++;
-                }
-            }
+            nfa_ee_cb.wait_rsp++;
         }
-    }
+        nfa_ee_cb.lmrt_stats.num_frags++;
+    } while (p < p_end);
+}
 
-    return status;
+/*******************************************************************************
+**
+** Function         nfa_ee_lmrt_reset
+**
+** Description      Forget the listen mode routing table last sent to NFCC,
+**                  e.g. when NFCC may have lost it. The next update sends the
+**                  table even if it has not changed.
+**
+** Returns          void
+**
+*******************************************************************************/
+void nfa_ee_lmrt_reset(void)
+{
+    if (nfa_ee_cb.p_lmrt)
+    {
+        GKI_freebuf (nfa_ee_cb.p_lmrt);
+        nfa_ee_cb.p_lmrt = NULL;
+    }
+    nfa_ee_cb.lmrt_len  = 0;
+    nfa_ee_cb.lmrt_st   = NFA_EE_LMRT_ST_NONE;
 }
 
 
@@ -2199,16 +2283,20 @@ void nfa_ee_lmrt_to_nfcc(tNFA_EE_MSG *p_data)
 {
     int xx;
     tNFA_EE_ECB          *p_cb;
-    UINT8   *p = NULL;
-    BOOLEAN more = TRUE;
-    UINT8   last_active = NFA_EE_INVALID;
-    int     max_len, len;
+    UINT8   *p = NULL, *pp;
+    UINT16  max_size, lmrt_size, max_len;
+    BOOLEAN send = FALSE;
     tNFA_STATUS status = NFA_STATUS_FAILED;
-    int     cur_offset;
-    UINT8   max_tlv;
 
     /* update routing table: DH and the activated NFCEEs */
-    p = (UINT8 *)GKI_getbuf(NFA_EE_ROUT_BUF_SIZE);
+    max_size = NFA_EE_ROUT_ECB_MAX_SIZE + nfa_ee_cb.ecb[NFA_EE_CB_4_DH].size_aid;
+    p_cb = &nfa_ee_cb.ecb[0];
+    for (xx = 0; xx < nfa_ee_cb.cur_ee; xx++, p_cb++)
+    {
+        if (p_cb->ee_status == NFC_NFCEE_STATUS_ACTIVE)
+            max_size += NFA_EE_ROUT_ECB_MAX_SIZE + p_cb->size_aid;
+    }
+    p = (UINT8 *)GKI_getbuf(max_size);
     if (p == NULL)
     {
         NFA_TRACE_ERROR0 ("nfa_ee_lmrt_to_nfcc() no buffer to send routing info.");
@@ -2216,59 +2304,81 @@ void nfa_ee_lmrt_to_nfcc(tNFA_EE_MSG *p_data)
         return;
     }
 
-    /* find the last active NFCEE. */
-    p_cb = &nfa_ee_cb.ecb[nfa_ee_cb.cur_ee - 1];
-    for (xx = 0; xx < nfa_ee_cb.cur_ee; xx++, p_cb--)
+    /* add the routing for DH first, then for NFCEEs */
+    pp = p;
+    nfa_ee_route_add_one_ecb(&nfa_ee_cb.ecb[NFA_EE_CB_4_DH], &pp);
+    p_cb = &nfa_ee_cb.ecb[0];
+    for (xx = 0; xx < nfa_ee_cb.cur_ee; xx++, p_cb++)
     {
         if (p_cb->ee_status == NFC_NFCEE_STATUS_ACTIVE)
         {
-            if (last_active == NFA_EE_INVALID)
-            {
-                last_active = p_cb->nfcee_id;
-                NFA_TRACE_DEBUG1 ("last_active: 0x%x", last_active);
-            }
+            nfa_ee_route_add_one_ecb(p_cb, &pp);
         }
     }
-    if (last_active == NFA_EE_INVALID)
-    {
-        more = FALSE;
-    }
+    lmrt_size = (UINT16)(pp - p);
 
-    /* add the routing for DH first */
+    /* add only what is supported by NFCC. report overflow */
     status  = NFA_STATUS_OK;
     max_len = NFC_GetLmrtSize();
-    max_tlv = (UINT8)((max_len > NFA_EE_ROUT_MAX_TLV_SIZE)?NFA_EE_ROUT_MAX_TLV_SIZE:max_len);
-    cur_offset  = 0;
-    /* use the first byte of the buffer (p) to keep the num_tlv */
-    *p          = 0;
-    status = nfa_ee_route_add_one_ecb(&nfa_ee_cb.ecb[NFA_EE_CB_4_DH], &max_len, more, p, &cur_offset);
+    if (lmrt_size > max_len)
+    {
+        NFA_TRACE_ERROR2 ("nfa_ee_lmrt_to_nfcc() lmrt_size:%d exceeds %d", lmrt_size, max_len);
+        for (pp = p; (pp < p + lmrt_size) && (pp + 2 + pp[1] <= p + max_len); pp += 2 + pp[1])
+            ;
+        lmrt_size   = (UINT16)(pp - p);
+        status      = NFA_STATUS_BUFFER_FULL;
+    }
 
-    /* add only what is supported by NFCC. report overflow */
-    if (status == NFA_STATUS_OK)
+    if (nfa_ee_cb.ee_cfg_sts & NFA_EE_STS_CHANGED_ROUTING)
     {
-        /* add the routing for NFCEEs */
-        p_cb = &nfa_ee_cb.ecb[0];
-        for (xx = 0; (xx < nfa_ee_cb.cur_ee) && more; xx++, p_cb++)
+        if (lmrt_size)
         {
-            len = 0;
-            if (p_cb->ee_status == NFC_NFCEE_STATUS_ACTIVE)
-            {
-                NFA_TRACE_DEBUG2 ("nfcee_id:0x%x, last_active: 0x%x", p_cb->nfcee_id, last_active);
-                if (last_active == p_cb->nfcee_id)
-                    more = FALSE;
-                status = nfa_ee_route_add_one_ecb(p_cb, &max_len, more, p, &cur_offset);
-                if (status != NFA_STATUS_OK)
-                {
-                    more    = FALSE;
-                }
-            }
+            nfa_ee_cb.ee_cfg_sts       |= NFA_EE_STS_PREV_ROUTING;
+        }
+        else
+        {
+            nfa_ee_cb.ee_cfg_sts       &= ~NFA_EE_STS_PREV_ROUTING;
         }
+        send = TRUE;
+    }
+    else if ((nfa_ee_cb.ee_cfg_sts & NFA_EE_STS_PREV_ROUTING) && (lmrt_size == 0))
+    {
+        nfa_ee_cb.ee_cfg_sts       &= ~NFA_EE_STS_PREV_ROUTING;
+        /* indicated routing is configured to NFCC */
+        nfa_ee_cb.ee_cfg_sts       |= NFA_EE_STS_CHANGED_ROUTING;
+        send = TRUE;
     }
+
+    if (send)
+    {
+        if (  (nfa_ee_cb.lmrt_st == NFA_EE_LMRT_ST_ACKED)
+            &&(nfa_ee_cb.lmrt_len == lmrt_size)
+            &&(memcmp (nfa_ee_cb.p_lmrt, p, lmrt_size) == 0)  )
+        {
+            /* NFCC already has this table */
+            nfa_ee_cb.lmrt_stats.num_skipped++;
+            NFA_TRACE_DEBUG1 ("nfa_ee_lmrt_to_nfcc() routing unchanged (%d bytes); not sent", lmrt_size);
+        }
+        else
+        {
+            nfa_ee_lmrt_send(p, lmrt_size);
+            nfa_ee_cb.lmrt_stats.num_commits++;
+            /* keep this table to compare the next one with */
+            if (nfa_ee_cb.p_lmrt)
+                GKI_freebuf(nfa_ee_cb.p_lmrt);
+            nfa_ee_cb.p_lmrt    = p;
+            nfa_ee_cb.lmrt_len  = lmrt_size;
+            nfa_ee_cb.lmrt_st   = NFA_EE_LMRT_ST_SENT;
+            p                   = NULL;
+        }
+    }
+
     if (status != NFA_STATUS_OK)
     {
         nfa_ee_report_event( NULL, NFA_EE_ROUT_ERR_EVT, (tNFA_EE_CBACK_DATA *)&status);
     }
-    GKI_freebuf(p);
+    if (p)
+        GKI_freebuf(p);
 }
 
 /*******************************************************************************
@@ -217,6 +217,9 @@ void nfa_ee_proc_nfcc_power_mode (UINT8 nfcc_power_mode)
     BOOLEAN         proc_complete = TRUE;
 
     NFA_TRACE_DEBUG1 ("nfa_ee_proc_nfcc_power_mode (): nfcc_power_mode=%d", nfcc_power_mode);
+    /* NFCC may not keep the routing table across power modes */
+    nfa_ee_lmrt_reset ();
+
     /* if NFCC power state is change to full power */
     if (nfcc_power_mode == NFA_DM_PWR_MODE_FULL)
     {
@@ -510,6 +513,7 @@ void nfa_ee_sys_disable (void)
 
     nfa_sys_stop_timer (&nfa_ee_cb.timer);
     nfa_sys_stop_timer (&nfa_ee_cb.discv_timer);
+    nfa_ee_lmrt_reset ();
 
     /* If Application initiated NFCEE discovery, fake/report the event */
     nfa_ee_report_disc_done (FALSE);
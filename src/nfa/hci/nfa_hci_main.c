@@ -406,6 +406,7 @@ void nfa_hci_restore_default_config (UINT8 *p_session_id)
 {
     memset (&nfa_hci_cb.cfg, 0, sizeof (nfa_hci_cb.cfg));
     memcpy (nfa_hci_cb.cfg.admin_gate.session_id, p_session_id, NFA_HCI_SESSION_ID_LEN);
+    nfa_hciu_rebuild_index ();
     nfa_hci_cb.nv_write_needed = TRUE;
 }
 
@@ -870,6 +871,11 @@ void nfa_hci_handle_nv_read (UINT8 block, tNFA_STATUS status)
             memcpy (session_id, (UINT8 *)&os_tick, (NFA_HCI_SESSION_ID_LEN / 2));
             nfa_hci_restore_default_config (session_id);
         }
+        else
+        {
+            /* Index the pipes and gates read from NV */
+            nfa_hciu_rebuild_index ();
+        }
         nfa_hci_startup ();
     }
 }
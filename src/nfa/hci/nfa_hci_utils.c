@@ -37,6 +37,50 @@
 static void handle_debug_loopback (BT_HDR *p_buf, UINT8 pipe, UINT8 type, UINT8 instruction);
 BOOLEAN HCI_LOOPBACK_DEBUG = FALSE;
 
+/*******************************************************************************
+**
+** Function         nfa_hciu_rebuild_index
+**
+** Description      Rebuild the pipe id, gate id and per-gate pipe indices from
+**                  the pipe and gate control blocks. Must be called whenever
+**                  a pipe or gate is allocated, released or moved, or the
+**                  control blocks are restored.
+**
+** Returns          none
+**
+*******************************************************************************/
+void nfa_hciu_rebuild_index (void)
+{
+    tNFA_HCI_DYN_PIPE   *pp;
+    tNFA_HCI_DYN_GATE   *pg;
+    int                 xx;
+    UINT8               gate_inx;
+
+    memset (nfa_hci_cb.pipe_inx, 0, sizeof (nfa_hci_cb.pipe_inx));
+    memset (nfa_hci_cb.gate_inx, 0, sizeof (nfa_hci_cb.gate_inx));
+    memset (nfa_hci_cb.gate_pipes, 0, sizeof (nfa_hci_cb.gate_pipes));
+
+    /* Walk backwards so the first control block wins, as with a linear search */
+    for (xx = NFA_HCI_MAX_GATE_CB - 1; xx >= 0; xx--)
+    {
+        pg = &nfa_hci_cb.cfg.dyn_gates[xx];
+        if (pg->gate_id != 0)
+            nfa_hci_cb.gate_inx[pg->gate_id] = (UINT8) (xx + 1);
+    }
+
+    for (xx = NFA_HCI_MAX_PIPE_CB - 1; xx >= 0; xx--)
+    {
+        pp = &nfa_hci_cb.cfg.dyn_pipes[xx];
+        if (pp->pipe_id != 0)
+        {
+            nfa_hci_cb.pipe_inx[pp->pipe_id] = (UINT8) (xx + 1);
+
+            if ((gate_inx = nfa_hci_cb.gate_inx[pp->local_gate]) != 0)
+                nfa_hci_cb.gate_pipes[gate_inx - 1] |= ((UINT32) 1 << xx);
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         nfa_hciu_find_pipe_by_pid
@@ -51,7 +95,13 @@ tNFA_HCI_DYN_PIPE *nfa_hciu_find_pipe_by_pid (UINT8 pipe_id)
     tNFA_HCI_DYN_PIPE   *pp = nfa_hci_cb.cfg.dyn_pipes;
     int                 xx  = 0;
 
-    /* Loop through looking for a match */
+    if (pipe_id != 0)
+    {
+        xx = nfa_hci_cb.pipe_inx[pipe_id];
+        return ((xx != 0) ? &nfa_hci_cb.cfg.dyn_pipes[xx - 1] : NULL);
+    }
+
+    /* Pipe id 0 matches the first free control block */
     for ( ; xx < NFA_HCI_MAX_PIPE_CB; xx++, pp++)
     {
         if (pp->pipe_id == pipe_id)
@@ -76,6 +126,13 @@ tNFA_HCI_DYN_GATE *nfa_hciu_find_gate_by_gid (UINT8 gate_id)
     tNFA_HCI_DYN_GATE *pg = nfa_hci_cb.cfg.dyn_gates;
     int               xx  = 0;
 
+    if (gate_id != 0)
+    {
+        xx = nfa_hci_cb.gate_inx[gate_id];
+        return ((xx != 0) ? &nfa_hci_cb.cfg.dyn_gates[xx - 1] : NULL);
+    }
+
+    /* Gate id 0 matches the first free control block */
     for ( ; xx < NFA_HCI_MAX_GATE_CB; xx++, pg++)
     {
         if (pg->gate_id == gate_id)
@@ -144,17 +201,12 @@ tNFA_HCI_DYN_GATE *nfa_hciu_find_gate_with_nopipes_by_owner (tNFA_HANDLE app_han
 *******************************************************************************/
 UINT8 nfa_hciu_count_pipes_on_gate (tNFA_HCI_DYN_GATE *p_gate)
 {
-    int               xx    = 0;
-    UINT32            mask  = 1;
+    UINT32            mask  = p_gate->pipe_inx_mask & (0xFFFFFFFF >> (32 - NFA_HCI_MAX_PIPE_CB));
     UINT8             count = 0;
 
-    for ( ; xx < NFA_HCI_MAX_PIPE_CB; xx++)
-    {
-        if ( p_gate->pipe_inx_mask & mask )
-            count++;
-
-        mask = mask << 1;
-    }
+    /* Clear the lowest set bit until none is left */
+    for ( ; mask != 0; mask &= mask - 1)
+        count++;
 
     return (count);
 }
@@ -293,6 +345,7 @@ tNFA_HCI_DYN_GATE *nfa_hciu_alloc_gate (UINT8 gate_id, tNFA_HANDLE app_handle)
 
             NFA_TRACE_DEBUG2 ("nfa_hciu_alloc_gate id:%d  app_handle: 0x%04x", gate_id, app_handle);
 
+            nfa_hciu_rebuild_index ();
             nfa_hci_cb.nv_write_needed = TRUE;
             return (pg);
         }
@@ -468,6 +521,7 @@ tNFA_HCI_DYN_PIPE *nfa_hciu_alloc_pipe (UINT8 pipe_id)
             NFA_TRACE_DEBUG2 ("nfa_hciu_alloc_pipe:%d, index:%d", pipe_id, xx);
             pp->pipe_id = pipe_id;
 
+            nfa_hciu_rebuild_index ();
             nfa_hci_cb.nv_write_needed = TRUE;
             return (pp);
         }
@@ -499,6 +553,7 @@ void nfa_hciu_release_gate (UINT8 gate_id)
         p_gate->gate_owner    = 0;
         p_gate->pipe_inx_mask = 0;
 
+        nfa_hciu_rebuild_index ();
         nfa_hci_cb.nv_write_needed = TRUE;
     }
     else
@@ -540,6 +595,7 @@ tNFA_HCI_RESPONSE nfa_hciu_add_pipe_to_gate (UINT8 pipe_id,   UINT8 local_gate,
             /* Save the pipe in the gate that it belongs to */
             pipe_index = (UINT8) (p_pipe - nfa_hci_cb.cfg.dyn_pipes);
             p_gate->pipe_inx_mask |= (UINT32) (1 << pipe_index);
+            nfa_hciu_rebuild_index ();
 
             NFA_TRACE_DEBUG4 ("nfa_hciu_add_pipe_to_gate  Gate ID: 0x%02x  Pipe ID: 0x%02x  pipe_index: %u  App Handle: 0x%08x",
                               local_gate, pipe_id, pipe_index, p_gate->gate_owner);
@@ -586,6 +642,7 @@ tNFA_HCI_RESPONSE nfa_hciu_add_pipe_to_static_gate (UINT8 local_gate, UINT8 pipe
             pipe_index = (UINT8) (p_pipe - nfa_hci_cb.cfg.dyn_pipes);
             nfa_hci_cb.cfg.id_mgmt_gate.pipe_inx_mask  |= (UINT32) (1 << pipe_index);
         }
+        nfa_hciu_rebuild_index ();
         return NFA_HCI_ANY_OK;
     }
 
@@ -708,19 +765,35 @@ tNFA_HCI_DYN_PIPE *nfa_hciu_find_pipe_on_gate (UINT8 gate_id)
 {
     tNFA_HCI_DYN_GATE   *pg;
     tNFA_HCI_DYN_PIPE   *pp;
+    UINT32              mask;
     int                 xx;
 
     NFA_TRACE_DEBUG1 ("nfa_hciu_find_pipe_on_gate () Gate:0x%x", gate_id);
 
-    /* Loop through all pipes looking for the owner */
-    for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; xx < NFA_HCI_MAX_PIPE_CB; xx++, pp++)
+    if (gate_id == 0)
     {
-        if (pp->pipe_id != 0)
+        /* Loop through all pipes looking for the owner */
+        for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; xx < NFA_HCI_MAX_PIPE_CB; xx++, pp++)
         {
-            if (  ((pg = nfa_hciu_find_gate_by_gid (pp->local_gate)) != NULL)
-                &&(pg->gate_id == gate_id) )
-                return (pp);
+            if (pp->pipe_id != 0)
+            {
+                if (  ((pg = nfa_hciu_find_gate_by_gid (pp->local_gate)) != NULL)
+                    &&(pg->gate_id == gate_id) )
+                    return (pp);
+            }
         }
+        return (NULL);
+    }
+
+    if ((pg = nfa_hciu_find_gate_by_gid (gate_id)) == NULL)
+        return (NULL);
+
+    /* The first pipe in the gate's list */
+    mask = nfa_hci_cb.gate_pipes[pg - nfa_hci_cb.cfg.dyn_gates];
+    for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; mask != 0; xx++, pp++, mask >>= 1)
+    {
+        if (mask & 1)
+            return (pp);
     }
 
     /* If here, not found */
@@ -809,22 +882,41 @@ tNFA_HCI_DYN_PIPE *nfa_hciu_find_active_pipe_on_gate (UINT8 gate_id)
 {
     tNFA_HCI_DYN_GATE   *pg;
     tNFA_HCI_DYN_PIPE   *pp;
+    UINT32              mask;
     int                 xx;
 
     NFA_TRACE_DEBUG1 ("nfa_hciu_find_active_pipe_on_gate () Gate:0x%x", gate_id);
 
-    /* Loop through all pipes looking for the owner */
-    for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; xx < NFA_HCI_MAX_PIPE_CB; xx++, pp++)
+    if (gate_id == 0)
     {
-        if (  (pp->pipe_id != 0)
+        /* Loop through all pipes looking for the owner */
+        for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; xx < NFA_HCI_MAX_PIPE_CB; xx++, pp++)
+        {
+            if (  (pp->pipe_id != 0)
+                &&(pp->pipe_id >= NFA_HCI_FIRST_DYNAMIC_PIPE)
+                &&(pp->pipe_id <= NFA_HCI_LAST_DYNAMIC_PIPE)
+                &&(nfa_hciu_is_active_host (pp->dest_host))  )
+            {
+                if (  ((pg = nfa_hciu_find_gate_by_gid (pp->local_gate)) != NULL)
+                    &&(pg->gate_id == gate_id) )
+                    return (pp);
+            }
+        }
+        return (NULL);
+    }
+
+    if ((pg = nfa_hciu_find_gate_by_gid (gate_id)) == NULL)
+        return (NULL);
+
+    /* Only the pipes in the gate's list */
+    mask = nfa_hci_cb.gate_pipes[pg - nfa_hci_cb.cfg.dyn_gates];
+    for (xx = 0, pp = nfa_hci_cb.cfg.dyn_pipes; mask != 0; xx++, pp++, mask >>= 1)
+    {
+        if (  (mask & 1)
             &&(pp->pipe_id >= NFA_HCI_FIRST_DYNAMIC_PIPE)
             &&(pp->pipe_id <= NFA_HCI_LAST_DYNAMIC_PIPE)
             &&(nfa_hciu_is_active_host (pp->dest_host))  )
-        {
-            if (  ((pg = nfa_hciu_find_gate_by_gid (pp->local_gate)) != NULL)
-                &&(pg->gate_id == gate_id) )
-                return (pp);
-        }
+            return (pp);
     }
 
     /* If here, not found */
@@ -871,6 +963,7 @@ tNFA_HCI_RESPONSE nfa_hciu_release_pipe (UINT8 pipe_id)
         {
             /* Mark the pipe control block as free */
             p_pipe->pipe_id = 0;
+            nfa_hciu_rebuild_index ();
             return (NFA_HCI_ANY_E_NOK);
         }
 
@@ -880,6 +973,7 @@ tNFA_HCI_RESPONSE nfa_hciu_release_pipe (UINT8 pipe_id)
 
     /* Reset pipe control block */
     memset (p_pipe,0,sizeof (tNFA_HCI_DYN_PIPE));
+    nfa_hciu_rebuild_index ();
     nfa_hci_cb.nv_write_needed = TRUE;
     return NFA_HCI_ANY_OK;
 }
@@ -30,6 +30,7 @@
 #include "nfa_ce_api.h"
 #include "nfa_dm_int.h"
 #include "nfc_api.h"
+#include "ce_api.h"
 
 /*****************************************************************************
 **  Constants and data types
@@ -150,7 +151,7 @@ typedef struct
     /* For host tag emulation (NFA_CeRegisterVirtualT4tSE and NFA_CeRegisterT4tAidOnDH) */
     UINT8               t3t_nfcid2[NCI_RF_F_UID_LEN];
     UINT16              t3t_system_code;                /* Type-3 system code */
-    UINT8               t4t_aid_handle;                 /* Type-4 aid callback handle (from CE_T4tRegisterAID) */
+    tCE_T4T_AID_HANDLE  t4t_aid_handle;                 /* Type-4 aid callback handle (from CE_T4tRegisterAID) */
 
     /* For UICC */
     tNFA_HANDLE                     ee_handle;
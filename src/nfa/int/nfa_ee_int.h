@@ -79,6 +79,35 @@ typedef UINT16 tNFA_EE_INT_EVT;
 #define NFA_EE_AE_ROUTE             0x80        /* for listen mode routing table*/
 #define NFA_EE_AE_VS                0x40
 
+/* AID entries and trie nodes are referred to by index + 1, so 0 (and a zeroed
+ * control block) means none. A trie child that refers to an AID entry has
+ * NFA_EE_AID_LEAF set. */
+#define NFA_EE_AID_NONE             0
+#define NFA_EE_AID_LEAF             0x8000
+#define NFA_EE_MAX_AID_POOL         (NFA_EE_MAX_AID_ENTRIES * NFA_EE_NUM_ECBS)
+
+/* An AID routing entry */
+typedef struct
+{
+    UINT16  next;                       /* next entry of the same NFCEE, or next free entry */
+    UINT16  prev;                       /* previous entry of the same NFCEE */
+    UINT8   ecb_inx;                    /* index of the owner in nfa_ee_cb.ecb[] */
+    UINT8   pwr_cfg;                    /* power configuration of this AID entry */
+    UINT8   rt_info;                    /* route/vs info for this AID entry */
+    UINT8   aid_len;
+    UINT8   aid[NFA_MAX_AID_LEN];
+} tNFA_EE_AID_ENTRY;
+
+/* An internal node of the AID trie: a crit-bit tree keyed on the AID with
+ * each byte widened to 9 bits (0x100 | byte, 0 past the end), so an AID and
+ * its prefixes are distinct keys and an AID sorts right after its prefixes. */
+typedef struct
+{
+    UINT16  child[2];                   /* node, NFA_EE_AID_LEAF | entry, or next free node */
+    UINT16  bit;                        /* the critical bit of the widened byte */
+    UINT8   byte;                       /* the offset of the critical byte */
+} tNFA_EE_AID_NODE;
+
 
 /* NFA EE Management state */
 enum
@@ -137,16 +166,14 @@ typedef struct
     UINT8                   conn_id;            /* connection id */
     tNFA_EE_CBACK           *p_ee_cback;        /* the callback function */
 
-    /* Each AID entry has an ssociated aid_len, aid_pwr_cfg, aid_rt_info.
-     * aid_cfg[] contains AID and maybe some other VS information in TLV format
-     * The first T is always NFA_EE_AID_CFG_TAG_NAME, the L is the actual AID length
-     * the aid_len is the total length of all the TLVs associated with this AID entry
+    /* The AID entries of this NFCEE live in nfa_ee_cb.aid_entry[] and are
+     * linked in the order they were added, which is the order of the AID
+     * routing entries in the LMRT.
      */
-    UINT8                   aid_len[NFA_EE_MAX_AID_ENTRIES];/* the actual lengths in aid_cfg */
-    UINT8                   aid_pwr_cfg[NFA_EE_MAX_AID_ENTRIES];/* power configuration of this AID entry */
-    UINT8                   aid_rt_info[NFA_EE_MAX_AID_ENTRIES];/* route/vs info for this AID entry */
-    UINT8                   aid_cfg[NFA_EE_MAX_AID_CFG_LEN];/* routing entries based on AID */
-    UINT8                   aid_entries;        /* The number of AID entries in aid_cfg */
+    UINT16                  aid_first;          /* first AID entry (NFA_EE_AID_NONE if none) */
+    UINT16                  aid_last;           /* last AID entry (NFA_EE_AID_NONE if none) */
+    UINT16                  aid_cfg_len;        /* total length of the AID TLVs (tag/len/AID) */
+    UINT16                  aid_entries;        /* The number of AID entries */
     UINT8                   nfcee_id;           /* ID for this NFCEE */
     UINT8                   ee_status;          /* The NFCEE status */
     UINT8                   ee_old_status;      /* The NFCEE status before going to low power mode */
@@ -402,6 +429,25 @@ typedef UINT8 tNFA_EE_DISC_STS;
 
 typedef void (tNFA_EE_ENABLE_DONE_CBACK)(tNFA_EE_DISC_STS status);
 
+/* what is known about the listen mode routing table in nfa_ee_cb.p_lmrt */
+#define NFA_EE_LMRT_ST_NONE             0x00    /* NFCC may have a different table  */
+#define NFA_EE_LMRT_ST_SENT             0x01    /* sent; waiting for the rsp        */
+#define NFA_EE_LMRT_ST_ACKED            0x02    /* accepted by NFCC                 */
+typedef UINT8 tNFA_EE_LMRT_ST;
+
+/* listen mode routing table statistics. Times come from GKI_get_tick_count (),
+** so their resolution is one GKI tick */
+typedef struct
+{
+    UINT32              start_tick;             /* tick count when the last table was sent */
+    UINT32              num_commits;            /* tables sent to NFCC                      */
+    UINT32              num_skipped;            /* tables not sent; same as the acked one   */
+    UINT32              num_frags;              /* RF_SET_LISTEN_MODE_ROUTING commands sent */
+    UINT32              num_fail;               /* commands NFCC failed                     */
+    UINT32              last_ms;                /* send to last rsp of the last table (ms)  */
+    UINT32              max_ms;                 /* longest send to last rsp (ms)            */
+} tNFA_EE_LMRT_STATS;
+
 /* NFA EE Management control block */
 typedef struct
 {
@@ -419,6 +465,17 @@ typedef struct
     UINT8                ee_cfg_sts;             /* configuration status             */
     tNFA_EE_WAIT         ee_wait_evt;            /* Pending event(s) to be reported  */
     tNFA_EE_FLAGS        ee_flags;               /* flags                            */
+    tNFA_EE_AID_ENTRY    aid_entry[NFA_EE_MAX_AID_POOL];  /* AID entries of all ECBs  */
+    tNFA_EE_AID_NODE     aid_node[NFA_EE_MAX_AID_POOL];   /* AID trie nodes           */
+    UINT16               aid_root;               /* root of the AID trie             */
+    UINT16               aid_free_entry;         /* first free AID entry             */
+    UINT16               aid_free_node;          /* first free AID trie node         */
+    UINT16               aid_entry_used;         /* AID entries ever taken from pool */
+    UINT16               aid_node_used;          /* AID trie nodes ever taken        */
+    UINT8                *p_lmrt;                /* the last routing table sent      */
+    UINT16               lmrt_len;               /* the length of p_lmrt             */
+    tNFA_EE_LMRT_ST      lmrt_st;                /* the status of p_lmrt             */
+    tNFA_EE_LMRT_STATS   lmrt_stats;             /* routing table statistics         */
 } tNFA_EE_CB;
 
 /*****************************************************************************
@@ -479,10 +536,10 @@ void nfa_ee_rout_timeout(tNFA_EE_MSG *p_data);
 void nfa_ee_discv_timeout(tNFA_EE_MSG *p_data);
 void nfa_ee_lmrt_to_nfcc(tNFA_EE_MSG *p_data);
 void nfa_ee_update_rout(void);
+void nfa_ee_lmrt_reset(void);
 void nfa_ee_report_event(tNFA_EE_CBACK *p_cback, tNFA_EE_EVT event, tNFA_EE_CBACK_DATA *p_data);
-tNFA_EE_ECB * nfa_ee_find_aid_offset(UINT8 aid_len, UINT8 *p_aid, int *p_offset, int *p_entry);
+tNFA_EE_ECB * nfa_ee_find_aid_entry(UINT8 aid_len, UINT8 *p_aid, tNFA_EE_AID_ENTRY **pp_entry);
 void nfa_ee_remove_labels(void);
-int nfa_ee_find_total_aid_len(tNFA_EE_ECB *p_cb, int start_entry);
 void nfa_ee_start_timer(void);
 void nfa_ee_reg_cback_enable_done (tNFA_EE_ENABLE_DONE_CBACK *p_cback);
 void nfa_ee_report_update_evt (void);
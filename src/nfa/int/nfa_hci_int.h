@@ -404,6 +404,9 @@ typedef struct
     tNFA_HCI_CBACK                  *p_app_cback[NFA_HCI_MAX_APP_CB];   /* Callback functions registered by the applications */
     UINT16                          rsp_buf_size;                       /* Maximum size of APDU buffer */
     UINT8                           *p_rsp_buf;                         /* Buffer to hold response to sent event */
+    UINT8                           pipe_inx[256];                      /* dyn_pipes index + 1 by pipe id, 0 if none */
+    UINT8                           gate_inx[256];                      /* dyn_gates index + 1 by gate id, 0 if none */
+    UINT32                          gate_pipes[NFA_HCI_MAX_GATE_CB];    /* Per dyn_gates entry: mask of dyn_pipes with that local gate */
     struct                                                              /* Persistent information for Device Host */
     {
         char                        reg_app_names[NFA_HCI_MAX_APP_CB][NFA_MAX_HCI_APP_NAME_LEN + 1];
@@ -461,6 +464,7 @@ extern void nfa_hci_api_deregister (tNFA_HCI_EVENT_DATA *p_evt_data);
 
 /* Utility functions in nfa_hci_utils.c
 */
+extern void               nfa_hciu_rebuild_index (void);
 extern tNFA_HCI_DYN_GATE  *nfa_hciu_alloc_gate (UINT8 gate_id, tNFA_HANDLE app_handle);
 extern tNFA_HCI_DYN_GATE  *nfa_hciu_find_gate_by_gid (UINT8 gate_id);
 extern tNFA_HCI_DYN_GATE  *nfa_hciu_find_gate_by_owner (tNFA_HANDLE app_handle);
@@ -262,6 +262,7 @@ typedef struct
 
     tNFA_P2P_SAP_CB     sap_cb[NFA_P2P_NUM_SAP];
     tNFA_P2P_CONN_CB    conn_cb[LLCP_MAX_DATA_LINK];
+    UINT8               conn_cb_idx[NFA_P2P_NUM_SAP][NFA_P2P_NUM_SAP]; /* 1 + index of conn_cb by (local SAP, remote SAP) */
     tNFA_P2P_SDP_CB     sdp_cb[LLCP_MAX_SDP_TRANSAC];
 
     UINT8               total_pending_ui_pdu;       /* total number of tx UI PDU not processed by NFA */
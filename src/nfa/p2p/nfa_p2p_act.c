@@ -55,7 +55,7 @@
 ** Returns          UINT8
 **
 *******************************************************************************/
-static UINT8 nfa_p2p_allocate_conn_cb (UINT8 local_sap)
+static UINT8 nfa_p2p_allocate_conn_cb (UINT8 local_sap, UINT8 remote_sap)
 {
     UINT8 xx;
 
@@ -64,7 +64,15 @@ static UINT8 nfa_p2p_allocate_conn_cb (UINT8 local_sap)
         if (nfa_p2p_cb.conn_cb[xx].flags == 0)
         {
             nfa_p2p_cb.conn_cb[xx].flags |= NFA_P2P_CONN_FLAG_IN_USE;
-            nfa_p2p_cb.conn_cb[xx].local_sap = local_sap;
+            nfa_p2p_cb.conn_cb[xx].local_sap  = local_sap;
+            nfa_p2p_cb.conn_cb[xx].remote_sap = remote_sap;
+
+            /* keep the first one if a data link with the same SAPs is in use */
+            if (  (local_sap < NFA_P2P_NUM_SAP) && (remote_sap < NFA_P2P_NUM_SAP)
+                &&(nfa_p2p_cb.conn_cb_idx[local_sap][remote_sap] == 0)  )
+            {
+                nfa_p2p_cb.conn_cb_idx[local_sap][remote_sap] = xx + 1;
+            }
 
             return (xx);
         }
@@ -87,9 +95,31 @@ static UINT8 nfa_p2p_allocate_conn_cb (UINT8 local_sap)
 *******************************************************************************/
 static void nfa_p2p_deallocate_conn_cb (UINT8 xx)
 {
+    tNFA_P2P_CONN_CB *p_conn_cb;
+    UINT8             yy;
+
     if (xx < LLCP_MAX_DATA_LINK)
     {
-        nfa_p2p_cb.conn_cb[xx].flags = 0;
+        p_conn_cb = &nfa_p2p_cb.conn_cb[xx];
+        p_conn_cb->flags = 0;
+
+        if (  (p_conn_cb->local_sap < NFA_P2P_NUM_SAP) && (p_conn_cb->remote_sap < NFA_P2P_NUM_SAP)
+            &&(nfa_p2p_cb.conn_cb_idx[p_conn_cb->local_sap][p_conn_cb->remote_sap] == xx + 1)  )
+        {
+            nfa_p2p_cb.conn_cb_idx[p_conn_cb->local_sap][p_conn_cb->remote_sap] = 0;
+
+            /* look for another data link with the same SAPs */
+            for (yy = 0; yy < LLCP_MAX_DATA_LINK; yy++)
+            {
+                if (  (nfa_p2p_cb.conn_cb[yy].flags & NFA_P2P_CONN_FLAG_IN_USE)
+                    &&(nfa_p2p_cb.conn_cb[yy].local_sap == p_conn_cb->local_sap)
+                    &&(nfa_p2p_cb.conn_cb[yy].remote_sap == p_conn_cb->remote_sap)  )
+                {
+                    nfa_p2p_cb.conn_cb_idx[p_conn_cb->local_sap][p_conn_cb->remote_sap] = yy + 1;
+                    break;
+                }
+            }
+        }
     }
     else
     {
@@ -111,14 +141,12 @@ static UINT8 nfa_p2p_find_conn_cb (UINT8 local_sap, UINT8 remote_sap)
 {
     UINT8 xx;
 
-    for (xx = 0; xx < LLCP_MAX_DATA_LINK; xx++)
+    if ((local_sap < NFA_P2P_NUM_SAP) && (remote_sap < NFA_P2P_NUM_SAP))
     {
-        if (  (nfa_p2p_cb.conn_cb[xx].flags & NFA_P2P_CONN_FLAG_IN_USE)
-            &&(nfa_p2p_cb.conn_cb[xx].local_sap == local_sap)
-            &&(nfa_p2p_cb.conn_cb[xx].remote_sap == remote_sap)  )
-        {
-            return (xx);
-        }
+        xx = nfa_p2p_cb.conn_cb_idx[local_sap][remote_sap];
+
+        if (xx)
+            return (xx - 1);
     }
 
     return (LLCP_MAX_DATA_LINK);
@@ -318,11 +346,10 @@ void nfa_p2p_proc_llcp_connect_ind (tLLCP_SAP_CBACK_DATA  *p_data)
 
     if (nfa_p2p_cb.sap_cb[server_sap].p_cback)
     {
-        xx = nfa_p2p_allocate_conn_cb (server_sap);
+        xx = nfa_p2p_allocate_conn_cb (server_sap, p_data->connect_ind.remote_sap);
 
         if (xx != LLCP_MAX_DATA_LINK)
         {
-            nfa_p2p_cb.conn_cb[xx].remote_sap = p_data->connect_ind.remote_sap;
             nfa_p2p_cb.conn_cb[xx].remote_miu = p_data->connect_ind.miu;
 
             /* peer will not receive any data */
@@ -365,11 +392,10 @@ void nfa_p2p_proc_llcp_connect_resp (tLLCP_SAP_CBACK_DATA  *p_data)
 
     if (nfa_p2p_cb.sap_cb[local_sap].p_cback)
     {
-        xx = nfa_p2p_allocate_conn_cb (local_sap);
+        xx = nfa_p2p_allocate_conn_cb (local_sap, p_data->connect_resp.remote_sap);
 
         if (xx != LLCP_MAX_DATA_LINK)
         {
-            nfa_p2p_cb.conn_cb[xx].remote_sap = p_data->connect_resp.remote_sap;
             nfa_p2p_cb.conn_cb[xx].remote_miu = p_data->connect_resp.miu;
 
             /* peer will not receive any data */
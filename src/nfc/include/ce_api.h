@@ -67,11 +67,16 @@ typedef struct
     UINT32          length;
 } tCE_UPDATE_INFO;
 
+/* T4T definitions */
+typedef UINT16 tCE_T4T_AID_HANDLE;          /* Handle for AID registration  */
+#define CE_T4T_AID_HANDLE_INVALID   0xFFFF  /* Invalid tCE_T4T_AID_HANDLE               */
+#define CE_T4T_WILDCARD_AID_HANDLE  0xFFFE  /* reserved handle for wildcard aid */
+
 typedef struct
 {
-    tNFC_STATUS     status;
-    UINT8           aid_handle;
-    BT_HDR         *p_data;
+    tNFC_STATUS         status;
+    tCE_T4T_AID_HANDLE  aid_handle;
+    BT_HDR             *p_data;
 } tCE_RAW_FRAME;
 
 typedef union
@@ -84,11 +89,6 @@ typedef union
 typedef void (tCE_CBACK) (tCE_EVENT event, tCE_DATA *p_data);
 
 
-/* T4T definitions */
-typedef UINT8 tCE_T4T_AID_HANDLE;           /* Handle for AID registration  */
-#define CE_T4T_AID_HANDLE_INVALID   0xFF    /* Invalid tCE_T4T_AID_HANDLE               */
-#define CE_T4T_WILDCARD_AID_HANDLE  (CE_T4T_MAX_REG_AID)    /* reserved handle for wildcard aid */
-
 /*******************************************************************************
 **
 ** Function         CE_T3tSetLocalNDEFMsg
@@ -183,6 +183,26 @@ NFC_API extern tCE_T4T_AID_HANDLE CE_T4tRegisterAID (UINT8      aid_len,
                                                      UINT8      *p_aid,
                                                      tCE_CBACK  *p_cback);
 
+/*******************************************************************************
+**
+** Function         CE_T4tRegisterAIDPrefix
+**
+** Description      Register AID prefix in CE T4T. SELECT of any AID starting
+**                  with the prefix is forwarded to p_cback, unless an exact
+**                  or longer matching AID is registered.
+**
+**                  aid_len: length of AID prefix (1 to NFC_MAX_AID_LEN)
+**                  p_aid:   AID prefix
+**                  p_cback: Raw frame will be forwarded with CE_RAW_FRAME_EVT
+**
+** Returns          tCE_T4T_AID_HANDLE if successful,
+**                  CE_T4T_AID_HANDLE_INVALID otherwisse
+**
+*******************************************************************************/
+NFC_API extern tCE_T4T_AID_HANDLE CE_T4tRegisterAIDPrefix (UINT8      aid_len,
+                                                           UINT8      *p_aid,
+                                                           tCE_CBACK  *p_cback);
+
 /*******************************************************************************
 **
 ** Function         CE_T4tDeregisterAID
@@ -635,6 +635,8 @@ LLCP_API extern void LLCP_GetLinkMIU (UINT16 *p_local_link_miu, UINT16 *p_remote
 **
 ** Description      Return SAP of service name in connected device through callback
 **
+**                  A service name resolved by peer earlier in this link
+**                  activation is reported from cache without sending SNL.
 **
 ** Returns          LLCP_STATUS_SUCCESS if success
 **
@@ -65,6 +65,61 @@ enum
 };
 typedef UINT8 tNDEF_STATUS;
 
+/* Index entry describing one record of a validated NDEF message (see NDEF_MsgIndex)
+*/
+typedef struct
+{
+    UINT32  offset;         /* offset of the record from the start of the message   */
+    UINT32  payload_len;    /* payload length                                       */
+    UINT8   rec_hdr;        /* MB/ME/CF/SR/IL flags and TNF                         */
+    UINT8   hdr_len;        /* length of the record header up to the type field     */
+    UINT8   type_len;       /* type length                                          */
+    UINT8   id_len;         /* ID length                                            */
+} tNDEF_REC_IDX;
+
+/* Descriptor of one record to be encoded by NDEF_MsgBuild
+*/
+typedef struct
+{
+    UINT8   tnf;            /* Type Name Format                                     */
+    UINT8   type_len;       /* type length                                          */
+    UINT8   id_len;         /* ID length (0 if none)                                */
+    UINT8   *p_type;        /* type, or NULL to leave the field uninitialized       */
+    UINT8   *p_id;          /* ID, or NULL to leave the field uninitialized         */
+    UINT8   *p_payload;     /* payload, or NULL to leave the field uninitialized    */
+    UINT32  payload_len;    /* payload length                                       */
+} tNDEF_REC_DESC;
+
+/* A contiguous piece of a record payload
+*/
+typedef struct
+{
+    UINT8   *p_data;        /* start of the data    */
+    UINT32  len;            /* length of the data   */
+} tNDEF_SPAN;
+
+/* Iterator over the logical records of a message that may contain chunked records.
+** A chunked record is reported once, with the type and ID of its first chunk.
+*/
+typedef struct
+{
+    UINT8   *p_next;        /* next physical record, NULL at the end of the message */
+    UINT8   *p_rec;         /* first chunk of the current logical record           */
+    UINT8   *p_type;        /* type of the current record (NULL if none)           */
+    UINT8   *p_id;          /* ID of the current record (NULL if none)             */
+    UINT32  payload_len;    /* payload length summed over all chunks               */
+    UINT16  num_chunks;     /* number of physical records in the current record    */
+    UINT8   tnf;            /* Type Name Format                                    */
+    UINT8   type_len;       /* type length                                         */
+    UINT8   id_len;         /* ID length                                           */
+} tNDEF_ITER;
+
+/* Pointers to the fields of an indexed record */
+#define NDEF_IDX_REC(p_msg, p_idx)      ((p_msg) + (p_idx)->offset)
+#define NDEF_IDX_TYPE(p_msg, p_idx)     (NDEF_IDX_REC (p_msg, p_idx) + (p_idx)->hdr_len)
+#define NDEF_IDX_ID(p_msg, p_idx)       (NDEF_IDX_TYPE (p_msg, p_idx) + (p_idx)->type_len)
+#define NDEF_IDX_PAYLOAD(p_msg, p_idx)  (NDEF_IDX_ID (p_msg, p_idx) + (p_idx)->id_len)
+
 
 #define HR_REC_TYPE_LEN     2       /* Handover Request Record Type     */
 #define HS_REC_TYPE_LEN     2       /* Handover Select Record Type      */
@@ -241,6 +296,48 @@ EXPORT_NDEF_API extern UINT8 *NDEF_RecGetId (UINT8 *p_rec, UINT8 *p_id_len);
 *******************************************************************************/
 EXPORT_NDEF_API extern UINT8 *NDEF_RecGetPayload (UINT8 *p_rec, UINT32 *p_payload_len);
 
+/*******************************************************************************
+**
+** Function         NDEF_MsgIndex
+**
+** Description      This function validates an NDEF message and fills in one
+**                  index entry per record, so records can then be accessed
+**                  in any order without parsing the message again.
+**
+** Returns          NDEF_OK if all OK, NDEF_MSG_INSUFFICIENT_MEM if the message
+**                  has more than max_recs records, or the validation error.
+**                  *p_num_recs is filled in on success.
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern tNDEF_STATUS NDEF_MsgIndex (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chunks,
+                                                   tNDEF_REC_IDX *p_idx, INT32 max_recs, INT32 *p_num_recs);
+
+/*******************************************************************************
+**
+** Function         NDEF_IdxFindRecByType
+**
+** Description      This function searches the index of an NDEF message, from
+**                  entry start onwards, for a record of the given type.
+**
+** Returns          Index of the record, or -1 if none is found
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern INT32 NDEF_IdxFindRecByType (UINT8 *p_msg, tNDEF_REC_IDX *p_idx, INT32 num_recs, INT32 start,
+                                                    UINT8 tnf, UINT8 *p_type, UINT8 tlen);
+
+/*******************************************************************************
+**
+** Function         NDEF_IdxFindRecById
+**
+** Description      This function searches the index of an NDEF message, from
+**                  entry start onwards, for a record with the given ID.
+**
+** Returns          Index of the record, or -1 if none is found
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern INT32 NDEF_IdxFindRecById (UINT8 *p_msg, tNDEF_REC_IDX *p_idx, INT32 num_recs, INT32 start,
+                                                  UINT8 *p_id, UINT8 ilen);
+
 
 /* Functions to build an NDEF Message
 */
@@ -271,6 +368,35 @@ EXPORT_NDEF_API extern tNDEF_STATUS  NDEF_MsgAddRec (UINT8 *p_msg, UINT32 max_si
                                      UINT8 *p_id, UINT8  id_len,
                                      UINT8 *p_payload, UINT32 payload_len);
 
+/*******************************************************************************
+**
+** Function         NDEF_MsgGetBuildSize
+**
+** Description      This function gets the size of the message NDEF_MsgBuild
+**                  will produce from the given record descriptors.
+**
+** Returns          The message size in bytes
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern UINT32 NDEF_MsgGetBuildSize (tNDEF_REC_DESC *p_recs, INT32 num_recs);
+
+/*******************************************************************************
+**
+** Function         NDEF_MsgBuild
+**
+** Description      This function builds an NDEF message from an array of
+**                  record descriptors in one pass. The short record format
+**                  is used where the payload allows it, and the MB and ME
+**                  flags are set on the first and last records.
+**
+** Returns          NDEF_OK if all OK, NDEF_MSG_INSUFFICIENT_MEM if the message
+**                  does not fit in max_size bytes. *p_cur_size is set to the
+**                  message size.
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern tNDEF_STATUS NDEF_MsgBuild (UINT8 *p_msg, UINT32 max_size, UINT32 *p_cur_size,
+                                                   tNDEF_REC_DESC *p_recs, INT32 num_recs);
+
 /*******************************************************************************
 **
 ** Function         NDEF_MsgInsertRec
@@ -383,6 +509,46 @@ EXPORT_NDEF_API extern tNDEF_STATUS NDEF_MsgRemoveRec (UINT8 *p_msg, UINT32 *p_c
 *******************************************************************************/
 EXPORT_NDEF_API extern tNDEF_STATUS NDEF_MsgCopyAndDechunk (UINT8 *p_src, UINT32 src_len, UINT8 *p_dest, UINT32 *p_out_len);
 
+/*******************************************************************************
+**
+** Function         NDEF_IterInit
+**
+** Description      This function validates an NDEF message, which may contain
+**                  chunked records, and sets up an iterator over its logical
+**                  records. Nothing is copied; the message must stay valid
+**                  while the iterator is used.
+**
+** Returns          NDEF_OK if all OK, or the reason the message is invalid
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern tNDEF_STATUS NDEF_IterInit (tNDEF_ITER *p_iter, UINT8 *p_msg, UINT32 msg_len);
+
+/*******************************************************************************
+**
+** Function         NDEF_IterNextRec
+**
+** Description      This function moves the iterator to the next logical record
+**                  and fills in its TNF, type, ID and total payload length.
+**
+** Returns          TRUE if a record was found, FALSE at the end of the message
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern BOOLEAN NDEF_IterNextRec (tNDEF_ITER *p_iter);
+
+/*******************************************************************************
+**
+** Function         NDEF_IterGetPayloadSpans
+**
+** Description      This function gets the payload of the current logical record
+**                  as spans into the message, one per non-empty chunk,
+**                  skipping the first start_span spans.
+**
+** Returns          Number of spans filled in p_spans (up to max_spans)
+**
+*******************************************************************************/
+EXPORT_NDEF_API extern UINT16 NDEF_IterGetPayloadSpans (tNDEF_ITER *p_iter, UINT16 start_span,
+                                                        tNDEF_SPAN *p_spans, UINT16 max_spans);
+
 /*******************************************************************************
 **
 ** Function         NDEF_MsgCreateWktHr
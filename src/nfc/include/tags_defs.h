@@ -339,6 +339,8 @@ typedef UINT8 tT3T_POLL_RC;
 #define T4T_CMD_P1_SELECT_BY_FILE_ID    0x00
 #define T4T_CMD_P2_FIRST_OR_ONLY_00H    0x00
 #define T4T_CMD_P2_FIRST_OR_ONLY_0CH    0x0C
+#define T4T_CMD_P2_OCCURRENCE_MASK      0x03
+#define T4T_CMD_P2_NEXT_OCCURRENCE      0x02
 
 #define T4T_MAX_LENGTH_LE               0xFF    /* Max number of bytes to be read from file in ReadBinary Command */
 #define T4T_MAX_LENGTH_LC               0xFF    /* Max number of bytes written to NDEF file in UpdateBinary Command */
@@ -82,8 +82,12 @@ typedef struct
 /* CE Type 4 Tag control blocks */
 typedef struct
 {
-    UINT8               aid_len;
+    UINT8               aid_len;                /* 0 if the entry is free   */
     UINT8               aid[NFC_MAX_AID_LEN];
+
+#define CE_T4T_AID_MATCH_EXACT          0x00    /* SELECT must match the whole AID      */
+#define CE_T4T_AID_MATCH_PREFIX         0x01    /* SELECT of any AID starting with it   */
+    UINT8               match;
     tCE_CBACK          *p_cback;
 } tCE_T4T_REG_AID;      /* registered AID table */
 
@@ -107,8 +111,12 @@ typedef struct
     UINT8               status;
 
     tCE_CBACK          *p_wildcard_aid_cback;               /* registered wildcard AID callback */
-    tCE_T4T_REG_AID     reg_aid[CE_T4T_MAX_REG_AID];        /* registered AID table             */
-    UINT8               selected_aid_idx;
+    tCE_T4T_REG_AID    *p_reg_aid;                          /* registered AID table, by handle  */
+    tCE_T4T_AID_HANDLE *p_aid_sorted;                       /* handles in p_reg_aid, sorted by AID */
+    UINT16              max_reg_aid;                        /* number of entries in p_reg_aid   */
+    UINT16              num_reg_aid;                        /* number of handles in p_aid_sorted */
+    UINT16              num_prefix_aid[NFC_MAX_AID_LEN + 1];/* number of AID prefixes, by length */
+    tCE_T4T_AID_HANDLE  selected_aid_idx;
 } tCE_T4T_MEM;
 
 
@@ -164,6 +172,8 @@ void ce_t3t_init (void);
 tNFC_STATUS ce_select_t3t (UINT16 system_code, UINT8 nfcid2[NCI_RF_F_UID_LEN]);
 
 /* ce_t4t internal functions */
+extern UINT16 ce_t4t_max_reg_aid_cfg;
+void ce_t4t_init (void);
 extern tNFC_STATUS ce_select_t4t (void);
 extern void ce_t4t_process_timeout (TIMER_LIST_ENT *p_tle);
 
@@ -88,6 +88,25 @@ typedef struct
 
     BUFFER_Q            sig_xmit_q;             /* tx signaling PDU queue                       */
 
+    UINT16              symm_hold;              /* current delay of SYMM response in ms         */
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+    UINT8               hold_type;              /* LLCP_LINK_HOLD_xxx                           */
+    BOOLEAN             is_resp_expected;       /* TRUE if upper layer may respond to received PDU */
+    BOOLEAN             is_first_pdu_pending;   /* TRUE until first PDU of activation as initiator */
+    UINT32              resp_start_tick;        /* GKI tick when upper layer got PDU to respond */
+    UINT32              last_data_tick;         /* GKI tick when PDU other than SYMM was sent or received */
+    UINT16              resp_time;              /* smoothed response time of upper layer in ms  */
+    UINT8               resp_credit;            /* waits left without response from upper layer */
+    UINT16              first_pdu_time;         /* smoothed time to first PDU from upper layer in ms */
+    UINT8               first_pdu_credit;       /* activations left without first PDU from upper layer */
+#endif
+
+    UINT32              num_symm_tx;            /* number of SYMM PDU sent in this activation   */
+    UINT32              num_symm_rx;            /* number of SYMM PDU received in this activation */
+    UINT32              num_frames_tx;          /* number of PDU other than SYMM sent           */
+    UINT32              num_bytes_tx;           /* bytes of PDU other than SYMM sent            */
+    UINT32              num_bytes_rx;           /* bytes of PDU other than SYMM received        */
+
     /* runtime configuration parameters */
     UINT16              local_link_miu;         /* Maximum Information Unit                     */
     UINT8               local_opt;              /* Option parameter                             */
@@ -101,6 +120,12 @@ typedef struct
 
 } tLLCP_LCB;
 
+/* what link timer is waiting for from upper layer in LLCP_LINK_SYMM_LOCAL_XMIT_NEXT */
+#define LLCP_LINK_HOLD_NONE         0
+#define LLCP_LINK_HOLD_FIRST_PDU    1   /* first PDU as initiator   */
+#define LLCP_LINK_HOLD_SYMM         2   /* response before SYMM     */
+#define LLCP_LINK_HOLD_IDLE         3   /* any PDU on idle link     */
+
 /*
 ** LLCP Application's registration control block on service access point (SAP)
 */
@@ -115,6 +140,10 @@ typedef struct
     BUFFER_Q            ui_rx_q;                /* UI PDU queue for receiving                   */
     BOOLEAN             is_ui_tx_congested;     /* TRUE if transmitting UI PDU is congested     */
 
+    UINT8               sn_len;                 /* length of service name                       */
+    UINT16              sn_hash;                /* hash of service name                         */
+    UINT8               next_sn_sap;            /* next SAP in service name hash bucket, 0 if none */
+
 } tLLCP_APP_CB;
 
 /*
@@ -205,13 +234,34 @@ typedef struct
 {
     UINT8           tid;        /* transaction ID                           */
     tLLCP_SDP_CBACK *p_cback;   /* callback function for service discovery  */
+    UINT8           cache_idx;  /* 1 + index of cache entry to fill by SDRES, 0 if none */
+    UINT8           cached_sap; /* SAP from cache to report locally, 0 if none */
 } tLLCP_SDP_TRANSAC;
 
+/* states of remote service name cache entry */
+#define LLCP_SDP_CACHE_EMPTY        0
+#define LLCP_SDP_CACHE_PENDING      1   /* SDREQ has been sent */
+#define LLCP_SDP_CACHE_RESOLVED     2   /* SAP has been received in SDRES */
+
+typedef struct
+{
+    UINT8           state;      /* LLCP_SDP_CACHE_xxx                       */
+    UINT8           sap;        /* remote SAP if resolved                   */
+    UINT8           sn_len;     /* length of service name                   */
+    UINT16          sn_hash;    /* hash of service name                     */
+    UINT8           *p_sn;      /* GKI buffer containing service name       */
+} tLLCP_SDP_CACHE;
+
 typedef struct
 {
     UINT8               next_tid;                       /* next TID to use         */
     tLLCP_SDP_TRANSAC   transac[LLCP_MAX_SDP_TRANSAC];  /* active SDP transactions */
     BT_HDR              *p_snl;                         /* buffer for SNL PDU      */
+
+    UINT8               sn_hash_sap[LLCP_SDP_SN_HASH_SIZE]; /* first local SAP in service name hash bucket, 0 if none */
+    tLLCP_SDP_CACHE     cache[LLCP_SDP_CACHE_SIZE];     /* remote service names resolved in this link activation */
+    UINT8               next_cache_evict;               /* next cache entry to replace if full */
+    TIMER_LIST_ENT      timer;                          /* timer to report SAP from cache */
 } tLLCP_SDP_CB;
 
 
@@ -229,6 +279,8 @@ typedef struct
     tLLCP_APP_CB    server_cb[LLCP_MAX_SERVER];     /* Application's registration for SDP services  */
     tLLCP_APP_CB    client_cb[LLCP_MAX_CLIENT];     /* Application's registration for client        */
     tLLCP_DLCB      dlcb[LLCP_MAX_DATA_LINK];       /* Data link connection control block           */
+    UINT8           dlcb_idx[LLCP_NUM_SAPS][LLCP_NUM_SAPS]; /* 1 + index of dlcb by (local SAP, remote SAP), 0 if none */
+    UINT8           w4_cc_dlcb_idx[LLCP_NUM_SAPS];  /* 1 + index of dlcb waiting for CC by local SAP */
 
     UINT8           max_num_ll_tx_buff;             /* max number of tx UI PDU in queue             */
     UINT8           max_num_tx_buff;                /* max number of tx UI/I PDU in queue           */
@@ -308,6 +360,7 @@ void llcp_link_process_link_timeout (void);
 void llcp_link_deactivate (UINT8 reason);
 
 void llcp_link_check_send_data (void);
+void llcp_link_reset_resp_time (void);
 void llcp_link_connection_cback (UINT8 conn_id, tNFC_CONN_EVT event, tNFC_CONN *p_data);
 
 /*
@@ -321,6 +374,8 @@ tLLCP_STATUS llcp_util_send_ui (UINT8 ssap, UINT8 dsap, tLLCP_APP_CB *p_app_cb,
 void         llcp_util_send_disc (UINT8 dsap, UINT8 ssap);
 tLLCP_DLCB  *llcp_util_allocate_data_link (UINT8 reg_sap, UINT8 remote_sap);
 void         llcp_util_deallocate_data_link (tLLCP_DLCB *p_dlcb);
+void         llcp_util_set_data_link_remote_sap (tLLCP_DLCB *p_dlcb, UINT8 remote_sap);
+void         llcp_util_set_data_link_w4_remote_resp (tLLCP_DLCB *p_dlcb);
 tLLCP_STATUS llcp_util_send_connect (tLLCP_DLCB *p_dlcb, tLLCP_CONNECTION_PARAMS *p_params);
 tLLCP_STATUS llcp_util_parse_connect (UINT8 *p_bytes, UINT16 length, tLLCP_CONNECTION_PARAMS *p_params);
 tLLCP_STATUS llcp_util_send_cc (tLLCP_DLCB *p_dlcb, tLLCP_CONNECTION_PARAMS *p_params);
@@ -339,6 +394,8 @@ void         llcp_dlc_flush_q (tLLCP_DLCB *p_dlcb);
 void         llcp_dlc_proc_i_pdu (UINT8 dsap, UINT8 ssap, UINT16 i_pdu_length, UINT8 *p_i_pdu, BT_HDR *p_msg);
 void         llcp_dlc_proc_rx_pdu (UINT8 dsap, UINT8 ptype, UINT8 ssap, UINT16 length, UINT8 *p_data);
 void         llcp_dlc_check_to_send_rr_rnr (void);
+UINT16       llcp_dlc_get_rr_rnr_length (void);
+UINT16       llcp_dlc_get_rr_length_acked_by_i_pdu (tLLCP_DLCB *p_dlcb);
 BOOLEAN      llcp_dlc_is_rw_open (tLLCP_DLCB *p_dlcb);
 BT_HDR      *llcp_dlc_get_next_pdu (tLLCP_DLCB *p_dlcb);
 UINT16       llcp_dlc_get_next_pdu_length (tLLCP_DLCB *p_dlcb);
@@ -352,6 +409,11 @@ UINT8        llcp_sdp_get_sap_by_name (char *p_name, UINT8 length);
 tLLCP_STATUS llcp_sdp_proc_snl (UINT16 sdu_length, UINT8 *p);
 void         llcp_sdp_check_send_snl (void);
 void         llcp_sdp_proc_deactivation (void);
+void         llcp_sdp_add_service_name (UINT8 sap);
+void         llcp_sdp_remove_service_name (UINT8 sap);
+BOOLEAN      llcp_sdp_get_cached_sap (UINT8 idx, char *p_name);
+void         llcp_sdp_add_cache (UINT8 idx, char *p_name);
+void         llcp_sdp_proc_timeout (void);
 #ifdef __cplusplus
 }
 #endif
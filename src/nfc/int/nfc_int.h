@@ -62,6 +62,7 @@ extern "C" {
 #define NFC_TTYPE_RW_T4T_RESPONSE           107
 #define NFC_TTYPE_RW_I93_RESPONSE           108
 #define NFC_TTYPE_CE_T4T_UPDATE             109
+#define NFC_TTYPE_LLCP_SDP                  110
 #define NFC_TTYPE_VS_BASE                   200
 
 
@@ -115,6 +116,9 @@ typedef struct
     UINT8       buff_size;      /* the max buffer size for this connection.     .   */
     UINT8       num_buff;       /* num of buffers left to send on this connection   */
     UINT8       init_credits;   /* initial num of buffer credits                    */
+#if (NFC_CHAINED_REASSEMBLY == TRUE)
+    UINT16      rx_chain_len;   /* payload bytes in the fragments at the end of rx_q */
+#endif
 } tNFC_CONN_CB;
 
 /* This data type is for NFC task to send a NCI VS command to NCIT task */
@@ -142,6 +142,8 @@ void LLCP_SetConfig (UINT16 link_miu,
     llcp_cb.lcb.symm_delay           = symm_delay;
     llcp_cb.lcb.data_link_timeout    = data_link_timeout;
     llcp_cb.lcb.delay_first_pdu_timeout = delay_first_pdu_timeout;
+
+    llcp_link_reset_resp_time ();
 }
 
 /*******************************************************************************
@@ -464,6 +466,11 @@ UINT8 LLCP_RegisterServer (UINT8           reg_sap,
     p_app_cb->p_app_cback = p_app_cback;
     p_app_cb->link_type   = link_type;
 
+    if (p_app_cb->p_service_name)
+    {
+        llcp_sdp_add_service_name (reg_sap);
+    }
+
     if (reg_sap <= LLCP_UPPER_BOUND_WK_SAP)
     {
         llcp_cb.lcb.wks |= (1 << reg_sap);
@@ -573,7 +580,11 @@ tLLCP_STATUS LLCP_Deregister (UINT8 local_sap)
     }
 
     if (p_app_cb->p_service_name)
+    {
+        llcp_sdp_remove_service_name (local_sap);
         GKI_freebuf (p_app_cb->p_service_name);
+        p_app_cb->p_service_name = NULL;
+    }
 
     /* update WKS bit map */
     if (local_sap <= LLCP_UPPER_BOUND_WK_SAP)
@@ -1567,6 +1578,8 @@ LLCP_API void LLCP_GetLinkMIU (UINT16 *p_local_link_miu,
 **
 ** Description      Return SAP of service name in connected device through callback
 **
+**                  A service name resolved by peer earlier in this link
+**                  activation is reported from cache without sending SNL.
 **
 ** Returns          LLCP_STATUS_SUCCESS if success
 **
@@ -1608,11 +1621,23 @@ tLLCP_STATUS LLCP_DiscoverService (char            *p_name,
             llcp_cb.sdp_cb.next_tid++;
             llcp_cb.sdp_cb.transac[i].p_cback = p_cback;
 
-            status = llcp_sdp_send_sdreq (llcp_cb.sdp_cb.transac[i].tid, p_name);
-
-            if (status == LLCP_STATUS_FAIL)
+            /* if peer has already resolved this service name in this link activation */
+            if (llcp_sdp_get_cached_sap (i, p_name))
             {
-                llcp_cb.sdp_cb.transac[i].p_cback = NULL;
+                status = LLCP_STATUS_SUCCESS;
+            }
+            else
+            {
+                status = llcp_sdp_send_sdreq (llcp_cb.sdp_cb.transac[i].tid, p_name);
+
+                if (status == LLCP_STATUS_FAIL)
+                {
+                    llcp_cb.sdp_cb.transac[i].p_cback = NULL;
+                }
+                else
+                {
+                    llcp_sdp_add_cache (i, p_name);
+                }
             }
 
             *p_tid = llcp_cb.sdp_cb.transac[i].tid;
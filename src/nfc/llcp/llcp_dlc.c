@@ -124,7 +124,7 @@ static tLLCP_STATUS llcp_dlsm_idle (tLLCP_DLCB *p_dlcb, tLLCP_DLC_EVENT event, v
             p_dlcb->local_rw  = p_params->rw;
 
             /* wait for response from peer device */
-            p_dlcb->state     = LLCP_DLC_STATE_W4_REMOTE_RESP;
+            llcp_util_set_data_link_w4_remote_resp (p_dlcb);
 
             nfc_start_quick_timer (&p_dlcb->timer, NFC_TTYPE_LLCP_DATA_LINK,
                                    (UINT32) (llcp_cb.lcb.data_link_timeout * QUICK_TIMER_TICKS_PER_SEC) / 1000);
@@ -557,22 +557,34 @@ static tLLCP_STATUS llcp_dlsm_w4_remote_dm (tLLCP_DLCB *p_dlcb, tLLCP_DLC_EVENT
 *******************************************************************************/
 tLLCP_DLCB *llcp_dlc_find_dlcb_by_sap (UINT8 local_sap, UINT8 remote_sap)
 {
-    int i;
+    tLLCP_DLCB *p_dlcb;
+    UINT8       idx;
+
+    if (local_sap >= LLCP_NUM_SAPS)
+        return NULL;
 
-    for (i = 0; i < LLCP_MAX_DATA_LINK; i++)
+    if (remote_sap == LLCP_INVALID_SAP)
     {
-        if (  (llcp_cb.dlcb[i].state != LLCP_DLC_STATE_IDLE)
-            &&(llcp_cb.dlcb[i].local_sap == local_sap)  )
+        /* Remote SAP has not been finalized because we are watiing for CC */
+        idx = llcp_cb.w4_cc_dlcb_idx[local_sap];
+
+        if (  (idx)
+            &&(llcp_cb.dlcb[idx - 1].state == LLCP_DLC_STATE_W4_REMOTE_RESP)  )
         {
-            if ((remote_sap == LLCP_INVALID_SAP) && (llcp_cb.dlcb[i].state == LLCP_DLC_STATE_W4_REMOTE_RESP))
-            {
-                /* Remote SAP has not been finalized because we are watiing for CC */
-                return (&llcp_cb.dlcb[i]);
-            }
-            else if (llcp_cb.dlcb[i].remote_sap == remote_sap)
-            {
-                return (&llcp_cb.dlcb[i]);
-            }
+            return (&llcp_cb.dlcb[idx - 1]);
+        }
+    }
+    else if (remote_sap < LLCP_NUM_SAPS)
+    {
+        idx = llcp_cb.dlcb_idx[local_sap][remote_sap];
+
+        if (idx)
+        {
+            p_dlcb = &llcp_cb.dlcb[idx - 1];
+
+            /* not yet in state machine */
+            if (p_dlcb->state != LLCP_DLC_STATE_IDLE)
+                return (p_dlcb);
         }
     }
     return NULL;
@@ -785,7 +797,7 @@ static void llcp_dlc_proc_cc_pdu (UINT8 dsap, UINT8 ssap, UINT16 length, UINT8 *
     if (p_dlcb)
     {
         /* The CC may contain a SSAP that is different from the DSAP in the CONNECT */
-        p_dlcb->remote_sap = ssap;
+        llcp_util_set_data_link_remote_sap (p_dlcb, ssap);
 
         if (llcp_util_parse_cc (p_data, length, &(params.miu), &(params.rw)) == LLCP_STATUS_SUCCESS)
         {
@@ -1293,6 +1305,70 @@ void llcp_dlc_check_to_send_rr_rnr (void)
     }
 }
 
+/*******************************************************************************
+**
+** Function         llcp_dlc_get_rr_rnr_length
+**
+** Description      Get length in AGF PDU of RR or RNR PDUs to be sent by
+**                  llcp_dlc_check_to_send_rr_rnr () if no I PDU carries N(R)
+**
+** Returns          length in bytes
+**
+*******************************************************************************/
+UINT16 llcp_dlc_get_rr_rnr_length (void)
+{
+    UINT8   idx;
+    UINT16  length = 0;
+    tLLCP_DLCB *p_dlcb;
+
+    for (idx = 0; idx < LLCP_MAX_DATA_LINK; idx++)
+    {
+        p_dlcb = &llcp_cb.dlcb[idx];
+
+        if (p_dlcb->state == LLCP_DLC_STATE_CONNECTED)
+        {
+            /* same conditions as llcp_util_send_rr_rnr () */
+            if (  (p_dlcb->flags & LLCP_DATA_LINK_FLAG_PENDING_RR_RNR)
+                ||(  (p_dlcb->sent_ack_seq != p_dlcb->next_rx_seq)
+                   &&(!p_dlcb->local_busy)
+                   &&(!p_dlcb->is_rx_congested)
+                   &&(!llcp_cb.overall_rx_congested)  )  )
+            {
+                length += LLCP_PDU_AGF_LEN_SIZE + LLCP_PDU_RR_SIZE;
+            }
+        }
+    }
+
+    return length;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_dlc_get_rr_length_acked_by_i_pdu
+**
+** Description      Get length in AGF PDU of RR PDU counted for the data link by
+**                  llcp_dlc_get_rr_rnr_length () which is not sent if an I PDU
+**                  of the data link carries N(R)
+**
+** Returns          length in bytes
+**
+*******************************************************************************/
+UINT16 llcp_dlc_get_rr_length_acked_by_i_pdu (tLLCP_DLCB *p_dlcb)
+{
+    /* RR/RNR for change of local busy or rx congestion is sent anyway */
+    if (  (p_dlcb->state == LLCP_DLC_STATE_CONNECTED)
+        &&(!(p_dlcb->flags & LLCP_DATA_LINK_FLAG_PENDING_RR_RNR))
+        &&(p_dlcb->sent_ack_seq != p_dlcb->next_rx_seq)
+        &&(!p_dlcb->local_busy)
+        &&(!p_dlcb->is_rx_congested)
+        &&(!llcp_cb.overall_rx_congested)  )
+    {
+        return (LLCP_PDU_AGF_LEN_SIZE + LLCP_PDU_RR_SIZE);
+    }
+
+    return 0;
+}
+
 /*******************************************************************************
 **
 ** Function         llcp_dlc_is_rw_open
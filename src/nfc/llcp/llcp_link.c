@@ -63,7 +63,7 @@ static void    llcp_link_proc_agf_pdu (BT_HDR *p_msg);
 static void    llcp_link_proc_rx_pdu (UINT8 dsap, UINT8 ptype, UINT8 ssap, BT_HDR *p_msg);
 static void    llcp_link_proc_rx_data (BT_HDR *p_msg);
 
-static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 *p_next_pdu_length);
+static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 max_length, UINT16 reserved, UINT16 *p_next_pdu_length);
 static BT_HDR *llcp_link_build_next_pdu (BT_HDR *p_agf);
 static void    llcp_link_send_to_lower (BT_HDR *p_msg);
 
@@ -131,7 +131,7 @@ static void llcp_link_start_link_timer (void)
     {
         /* wait for application layer sending data */
         nfc_start_quick_timer (&llcp_cb.lcb.timer, NFC_TTYPE_LLCP_LINK_MANAGER,
-                               (((UINT32) llcp_cb.lcb.symm_delay) * QUICK_TIMER_TICKS_PER_SEC) / 1000);
+                               (((UINT32) llcp_cb.lcb.symm_hold) * QUICK_TIMER_TICKS_PER_SEC) / 1000);
     }
     else
     {
@@ -155,6 +155,172 @@ static void llcp_link_stop_link_timer (void)
     nfc_stop_quick_timer (&llcp_cb.lcb.timer);
 }
 
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+/*******************************************************************************
+**
+** Function         llcp_link_reset_resp_time
+**
+** Description      Start measuring response time of upper layer from the
+**                  configured delays.
+**
+** Returns          void
+**
+*******************************************************************************/
+void llcp_link_reset_resp_time (void)
+{
+    llcp_cb.lcb.resp_time        = llcp_cb.lcb.symm_delay;
+    llcp_cb.lcb.resp_credit      = LLCP_ADAPTIVE_SYMM_CREDIT;
+    llcp_cb.lcb.first_pdu_time   = llcp_cb.lcb.delay_first_pdu_timeout;
+    llcp_cb.lcb.first_pdu_credit = LLCP_ADAPTIVE_SYMM_CREDIT;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_link_get_hold_time
+**
+** Description      Get time to wait for upper layer from smoothed response
+**                  time. Twice the response time rounded up to timer ticks plus
+**                  a tick for the current one, bounded by configured delay and
+**                  half of local link timeout.
+**
+** Returns          time to wait in ms
+**
+*******************************************************************************/
+static UINT16 llcp_link_get_hold_time (UINT16 resp_time, UINT16 max_time)
+{
+    UINT32 tick_ms = 1000 / QUICK_TIMER_TICKS_PER_SEC;
+    UINT32 hold_time;
+
+    hold_time = ((2 * (UINT32) resp_time + tick_ms - 1) / tick_ms + 1) * tick_ms;
+
+    if (hold_time > max_time)
+        hold_time = max_time;
+
+    if (hold_time > llcp_cb.lcb.local_lto / 2)
+        hold_time = llcp_cb.lcb.local_lto / 2;
+
+    return (UINT16) hold_time;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_link_update_resp_time
+**
+** Description      Update smoothed response time of upper layer when it sent
+**                  PDU after receiving PDU to respond to.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void llcp_link_update_resp_time (void)
+{
+    UINT32 elapsed;
+
+    elapsed = GKI_TICKS_TO_MS (GKI_get_tick_count () - llcp_cb.lcb.resp_start_tick);
+
+    /* 3/4 of old and 1/4 of new sample */
+    if (llcp_cb.lcb.hold_type == LLCP_LINK_HOLD_FIRST_PDU)
+    {
+        if (elapsed > llcp_cb.lcb.delay_first_pdu_timeout)
+            elapsed = llcp_cb.lcb.delay_first_pdu_timeout;
+
+        llcp_cb.lcb.first_pdu_time   = (UINT16) ((3 * (UINT32) llcp_cb.lcb.first_pdu_time + elapsed) / 4);
+        llcp_cb.lcb.first_pdu_credit = LLCP_ADAPTIVE_SYMM_CREDIT;
+    }
+    else
+    {
+        if (elapsed > llcp_cb.lcb.symm_delay)
+            elapsed = llcp_cb.lcb.symm_delay;
+
+        llcp_cb.lcb.resp_time   = (UINT16) ((3 * (UINT32) llcp_cb.lcb.resp_time + elapsed) / 4);
+        llcp_cb.lcb.resp_credit = LLCP_ADAPTIVE_SYMM_CREDIT;
+    }
+
+    LLCP_TRACE_DEBUG3 ("llcp_link_update_resp_time (): elapsed:%d ms, resp_time:%d ms, first_pdu_time:%d ms",
+                       elapsed, llcp_cb.lcb.resp_time, llcp_cb.lcb.first_pdu_time);
+
+    llcp_cb.lcb.hold_type        = LLCP_LINK_HOLD_NONE;
+    llcp_cb.lcb.is_resp_expected = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_link_get_symm_delay
+**
+** Description      Decide how long to wait for upper layer before sending SYMM.
+**                  If upper layer has PDU to respond to, wait based on its
+**                  response time unless it did not respond to recent waits.
+**                  Otherwise no wait while PDUs are being exchanged, so peer
+**                  gets its turn sooner, and configured delay once link is idle.
+**
+** Returns          delay in ms
+**
+*******************************************************************************/
+static UINT16 llcp_link_get_symm_delay (void)
+{
+    if (llcp_cb.lcb.hold_type == LLCP_LINK_HOLD_FIRST_PDU)
+    {
+        /* upper layer didn't send first PDU in time */
+        if (llcp_cb.lcb.first_pdu_credit)
+            llcp_cb.lcb.first_pdu_credit--;
+
+        llcp_cb.lcb.hold_type = LLCP_LINK_HOLD_NONE;
+    }
+
+    if (  (llcp_cb.lcb.symm_delay == 0)
+        ||(llcp_cb.overall_tx_congested)  )
+    {
+        return 0;
+    }
+
+    if (  (llcp_cb.lcb.is_resp_expected)
+        &&(llcp_cb.lcb.resp_credit)  )
+    {
+        llcp_cb.lcb.hold_type = LLCP_LINK_HOLD_SYMM;
+
+        return llcp_link_get_hold_time (llcp_cb.lcb.resp_time, llcp_cb.lcb.symm_delay);
+    }
+
+    if (GKI_TICKS_TO_MS (GKI_get_tick_count () - llcp_cb.lcb.last_data_tick) < LLCP_ADAPTIVE_SYMM_IDLE_TIME)
+        return 0;
+
+    llcp_cb.lcb.hold_type = LLCP_LINK_HOLD_IDLE;
+
+    return llcp_cb.lcb.symm_delay;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_link_get_first_pdu_delay
+**
+** Description      Decide how long to wait for upper layer before sending the
+**                  first PDU as initiator.
+**
+** Returns          delay in ms
+**
+*******************************************************************************/
+static UINT16 llcp_link_get_first_pdu_delay (void)
+{
+    if (  (llcp_cb.lcb.delay_first_pdu_timeout == 0)
+        ||(llcp_cb.lcb.first_pdu_credit == 0)  )
+    {
+        return 0;
+    }
+
+    llcp_cb.lcb.hold_type       = LLCP_LINK_HOLD_FIRST_PDU;
+    llcp_cb.lcb.resp_start_tick = GKI_get_tick_count ();
+
+    return llcp_link_get_hold_time (llcp_cb.lcb.first_pdu_time, llcp_cb.lcb.delay_first_pdu_timeout);
+}
+#else
+void llcp_link_reset_resp_time (void)
+{
+}
+
+#define llcp_link_get_symm_delay()      (llcp_cb.lcb.symm_delay)
+#define llcp_link_get_first_pdu_delay() (llcp_cb.lcb.delay_first_pdu_timeout)
+#endif  /* LLCP_ADAPTIVE_SYMM_DELAY */
+
 /*******************************************************************************
 **
 ** Function         llcp_link_activate
@@ -226,6 +392,18 @@ tLLCP_STATUS llcp_link_activate (tLLCP_ACTIVATE_CONFIG *p_config)
     llcp_cb.lcb.received_first_packet = FALSE;
     llcp_cb.lcb.is_initiator = p_config->is_initiator;
 
+    llcp_cb.lcb.num_symm_tx   = 0;
+    llcp_cb.lcb.num_symm_rx   = 0;
+    llcp_cb.lcb.num_frames_tx = 0;
+    llcp_cb.lcb.num_bytes_tx  = 0;
+    llcp_cb.lcb.num_bytes_rx  = 0;
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+    llcp_cb.lcb.hold_type            = LLCP_LINK_HOLD_NONE;
+    llcp_cb.lcb.is_resp_expected     = FALSE;
+    llcp_cb.lcb.is_first_pdu_pending = llcp_cb.lcb.is_initiator;
+    llcp_cb.lcb.last_data_tick       = GKI_get_tick_count ();
+#endif
+
     /* reset internal flags */
     llcp_cb.lcb.flags = 0x00;
 
@@ -247,11 +425,13 @@ tLLCP_STATUS llcp_link_activate (tLLCP_ACTIVATE_CONFIG *p_config)
         llcp_cb.lcb.inact_timeout = llcp_cb.lcb.inact_timeout_init;
         llcp_cb.lcb.symm_state    = LLCP_LINK_SYMM_LOCAL_XMIT_NEXT;
 
-        if (llcp_cb.lcb.delay_first_pdu_timeout > 0)
+        llcp_cb.lcb.symm_hold = llcp_link_get_first_pdu_delay ();
+
+        if (llcp_cb.lcb.symm_hold > 0)
         {
             /* give a chance to upper layer to send PDU if need */
             nfc_start_quick_timer (&llcp_cb.lcb.timer, NFC_TTYPE_LLCP_DELAY_FIRST_PDU,
-                                   (((UINT32) llcp_cb.lcb.delay_first_pdu_timeout) * QUICK_TIMER_TICKS_PER_SEC) / 1000);
+                                   (((UINT32) llcp_cb.lcb.symm_hold) * QUICK_TIMER_TICKS_PER_SEC) / 1000);
         }
         else
         {
@@ -297,6 +477,19 @@ tLLCP_STATUS llcp_link_activate (tLLCP_ACTIVATE_CONFIG *p_config)
 *******************************************************************************/
 static void llcp_deactivate_cleanup  (UINT8 reason)
 {
+    LLCP_TRACE_DEBUG4 ("llcp_deactivate_cleanup (): SYMM sent:%d, received:%d, bytes sent:%d, received:%d",
+                       llcp_cb.lcb.num_symm_tx, llcp_cb.lcb.num_symm_rx,
+                       llcp_cb.lcb.num_bytes_tx, llcp_cb.lcb.num_bytes_rx);
+
+    /* average fill of sent PDU against the largest PDU in link MIU of peer */
+    if (llcp_cb.lcb.num_frames_tx)
+    {
+        LLCP_TRACE_DEBUG2 ("llcp_deactivate_cleanup (): PDU sent:%d, average fill:%d%%",
+                           llcp_cb.lcb.num_frames_tx,
+                           (llcp_cb.lcb.num_bytes_tx * 100)
+                           / (llcp_cb.lcb.num_frames_tx * (LLCP_PDU_HEADER_SIZE + llcp_cb.lcb.effective_miu)));
+    }
+
     /* report SDP failure for any pending request */
     llcp_sdp_proc_deactivation ();
 
@@ -332,6 +525,19 @@ void llcp_link_process_link_timeout (void)
         {
             /* upper layer doesn't have anything to send */
             LLCP_TRACE_DEBUG0 ("llcp_link_process_link_timeout (): LEVT_TIMEOUT in state of LLCP_LINK_SYMM_LOCAL_XMIT_NEXT");
+
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+            /* wait again in next turn only until credit runs out */
+            if (llcp_cb.lcb.hold_type == LLCP_LINK_HOLD_SYMM)
+            {
+                if (llcp_cb.lcb.resp_credit)
+                    llcp_cb.lcb.resp_credit--;
+
+                /* received PDU is taken as unanswered, so link may go idle */
+                if (llcp_cb.lcb.resp_credit == 0)
+                    llcp_cb.lcb.is_resp_expected = FALSE;
+            }
+#endif
             llcp_link_send_SYMM ();
 
             /* wait for data to receive from remote */
@@ -831,6 +1037,8 @@ static void llcp_link_send_SYMM (void)
         p = (UINT8 *) (p_msg + 1) + p_msg->offset;
         UINT16_TO_BE_STREAM (p, LLCP_GET_PDU_HEADER (LLCP_SAP_LM, LLCP_PDU_SYMM_TYPE, LLCP_SAP_LM ));
 
+        llcp_cb.lcb.num_symm_tx++;
+
         llcp_link_send_to_lower (p_msg);
     }
 }
@@ -911,6 +1119,30 @@ void llcp_link_check_send_data (void)
 
         if (p_pdu != NULL)
         {
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+            if (  (llcp_cb.lcb.hold_type == LLCP_LINK_HOLD_FIRST_PDU)
+                ||(llcp_cb.lcb.hold_type == LLCP_LINK_HOLD_SYMM)
+                ||((llcp_cb.lcb.is_resp_expected) && (llcp_cb.lcb.resp_credit == 0))  )
+            {
+                /* upper layer sent PDU while or without waiting for it */
+                llcp_link_update_resp_time ();
+            }
+            else
+            {
+                llcp_cb.lcb.is_resp_expected = FALSE;
+            }
+
+            if (llcp_cb.lcb.is_first_pdu_pending)
+            {
+                /* upper layer sent first PDU of activation, even if after waiting for it */
+                llcp_cb.lcb.first_pdu_credit     = LLCP_ADAPTIVE_SYMM_CREDIT;
+                llcp_cb.lcb.is_first_pdu_pending = FALSE;
+            }
+            llcp_cb.lcb.last_data_tick = GKI_get_tick_count ();
+#endif
+            llcp_cb.lcb.num_frames_tx++;
+            llcp_cb.lcb.num_bytes_tx += p_pdu->len;
+
             llcp_link_send_to_lower (p_pdu);
 
             /* stop inactivity timer */
@@ -924,7 +1156,18 @@ void llcp_link_check_send_data (void)
             /* There is no data to send, so send SYMM */
             if (llcp_cb.lcb.link_state == LLCP_LINK_STATE_ACTIVATED)
             {
-                if (llcp_cb.lcb.symm_delay > 0)
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+                if (  (llcp_cb.lcb.hold_type != LLCP_LINK_HOLD_NONE)
+                    &&(llcp_cb.lcb.timer.in_use)  )
+                {
+                    /* keep waiting for upper layer until link timer expires */
+                    llcp_cb.lcb.is_sending_data = FALSE;
+                    return;
+                }
+#endif
+                llcp_cb.lcb.symm_hold = llcp_link_get_symm_delay ();
+
+                if (llcp_cb.lcb.symm_hold > 0)
                 {
                     /* wait for application layer sending data */
                     llcp_link_start_link_timer ();
@@ -961,6 +1204,14 @@ void llcp_link_check_send_data (void)
             llcp_link_start_link_timer ();
         }
     }
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+    else if (  (llcp_cb.lcb.is_resp_expected)
+             &&(llcp_cb.lcb.resp_credit == 0)  )
+    {
+        /* upper layer responds after SYMM was sent without waiting for it */
+        llcp_link_update_resp_time ();
+    }
+#endif
 
     llcp_cb.lcb.is_sending_data = FALSE;
 }
@@ -1388,6 +1639,8 @@ static void llcp_link_proc_rx_data (BT_HDR *p_msg)
 
                     if (ptype == LLCP_PDU_SYMM_TYPE)
                     {
+                        llcp_cb.lcb.num_symm_rx++;
+
                         if (info_length > 0)
                         {
                             LLCP_TRACE_ERROR1 ("Received extra data (%d bytes) in SYMM PDU", info_length);
@@ -1397,10 +1650,25 @@ static void llcp_link_proc_rx_data (BT_HDR *p_msg)
                     else
                     {
                         /* received other than SYMM */
+                        llcp_cb.lcb.num_bytes_rx += p_msg->len;
+
                         llcp_link_stop_inactivity_timer ();
 
                         llcp_link_proc_rx_pdu (dsap, ptype, ssap, p_msg);
                         free_buffer = FALSE;
+
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+                        llcp_cb.lcb.last_data_tick       = GKI_get_tick_count ();
+                        llcp_cb.lcb.is_first_pdu_pending = FALSE;
+
+                        /* upper layer may respond to anything but acknowledgement */
+                        if (  (ptype != LLCP_PDU_RR_TYPE)
+                            &&(ptype != LLCP_PDU_RNR_TYPE)  )
+                        {
+                            llcp_cb.lcb.is_resp_expected = TRUE;
+                            llcp_cb.lcb.resp_start_tick  = GKI_get_tick_count ();
+                        }
+#endif
                     }
                 }
             }
@@ -1426,22 +1694,43 @@ static void llcp_link_proc_rx_data (BT_HDR *p_msg)
 **
 ** Description      Get next PDU from link manager or data links w/wo dequeue
 **
+**                  Signalling PDU is sent first and UI/I PDU doesn't overtake
+**                  it. Logical links and data link connections are served
+**                  alternately, each in round robin. UI/I PDU is skipped if it
+**                  doesn't fit into max_length with reserved bytes left, and
+**                  the skipped link keeps its turn for next time. Reserved
+**                  bytes for RR of a data link are not kept for its own I PDU
+**                  as the I PDU carries N(R) instead.
+**
 ** Returns          pointer of a PDU to send if length_only is FALSE
 **                  NULL otherwise
 **
 *******************************************************************************/
-static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 *p_next_pdu_length)
+static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 max_length,
+                                       UINT16 reserved, UINT16 *p_next_pdu_length)
 {
     BT_HDR *p_msg;
     int     count, xx;
+    UINT8   idx;
+    BOOLEAN in_turn;
+    UINT16  length, room, rr_length;
     tLLCP_APP_CB *p_app_cb;
 
     /* processing signalling PDU first */
     if (llcp_cb.lcb.sig_xmit_q.p_first)
     {
+        p_msg = (BT_HDR*) llcp_cb.lcb.sig_xmit_q.p_first;
+
+        if (p_msg->len > max_length)
+        {
+            /* doesn't fit into AGF PDU, so it starts next frame.
+            ** don't send any UI/I PDU before signalling PDU */
+            *p_next_pdu_length = 0;
+            return NULL;
+        }
+
         if (length_only)
         {
-            p_msg = (BT_HDR*) llcp_cb.lcb.sig_xmit_q.p_first;
             *p_next_pdu_length = p_msg->len;
             return NULL;
         }
@@ -1450,106 +1739,131 @@ static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 *p_next_pdu_l
 
         return p_msg;
     }
-    else
+
+    /* room for UI PDU */
+    room = (max_length > reserved) ? (max_length - reserved) : 0;
+
+    /* transmitting logical data link and data link connection equaly */
+    for (xx = 0; xx < 2; xx++)
     {
-        /* transmitting logical data link and data link connection equaly */
-        for (xx = 0; xx < 2; xx++)
+        /* TRUE until any link is skipped because its PDU doesn't fit */
+        in_turn = TRUE;
+
+        if (!llcp_cb.lcb.ll_served)
         {
-            if (!llcp_cb.lcb.ll_served)
+            /* Get one from logical link connection */
+            idx = llcp_cb.lcb.ll_idx;
+
+            for (count = 0; count < LLCP_NUM_SAPS; count++)
             {
-                /* Get one from logical link connection */
-                for (count = 0; count < LLCP_NUM_SAPS; count++)
+                /* round robin schedule without priority  */
+                p_app_cb = llcp_util_get_app_cb (idx);
+
+                if (  (p_app_cb)
+                    &&(p_app_cb->p_app_cback)
+                    &&(p_app_cb->ui_xmit_q.count)  )
                 {
-                    /* round robin schedule without priority  */
-                    p_app_cb = llcp_util_get_app_cb (llcp_cb.lcb.ll_idx);
+                    p_msg = (BT_HDR *) p_app_cb->ui_xmit_q.p_first;
 
-                    if (  (p_app_cb)
-                        &&(p_app_cb->p_app_cback)
-                        &&(p_app_cb->ui_xmit_q.count)  )
+                    if (p_msg->len <= room)
                     {
                         if (length_only)
                         {
-                            /* don't alternate next data link to return the same length of PDU */
-                            p_msg = (BT_HDR *) p_app_cb->ui_xmit_q.p_first;
+                            /* don't change scheduler to return the same PDU when dequeued */
                             *p_next_pdu_length = p_msg->len;
                             return NULL;
                         }
-                        else
-                        {
-                            /* check data link connection first in next time */
-                            llcp_cb.lcb.ll_served = !llcp_cb.lcb.ll_served;
 
-                            p_msg = (BT_HDR*) GKI_dequeue (&p_app_cb->ui_xmit_q);
-                            llcp_cb.total_tx_ui_pdu--;
+                        /* check data link connection first in next time */
+                        llcp_cb.lcb.ll_served = TRUE;
 
-                            /* this logical link has been served, so start from next logical link next time */
-                            llcp_cb.lcb.ll_idx = (llcp_cb.lcb.ll_idx + 1) % LLCP_NUM_SAPS;
+                        p_msg = (BT_HDR*) GKI_dequeue (&p_app_cb->ui_xmit_q);
+                        llcp_cb.total_tx_ui_pdu--;
 
-                            return p_msg;
-                        }
+                        /* this logical link has been served, so start from next logical link next time */
+                        if (in_turn)
+                            llcp_cb.lcb.ll_idx = (idx + 1) % LLCP_NUM_SAPS;
+
+                        return p_msg;
                     }
                     else
                     {
-                        /* check next logical link connection */
-                        llcp_cb.lcb.ll_idx = (llcp_cb.lcb.ll_idx + 1) % LLCP_NUM_SAPS;
+                        in_turn = FALSE;
                     }
                 }
+                else if (in_turn)
+                {
+                    /* no data, so start from next logical link */
+                    llcp_cb.lcb.ll_idx = (idx + 1) % LLCP_NUM_SAPS;
+                }
 
-                /* no data, so check data link connection if not checked yet */
-                llcp_cb.lcb.ll_served = !llcp_cb.lcb.ll_served;
+                /* check next logical link connection */
+                idx = (idx + 1) % LLCP_NUM_SAPS;
             }
-            else
+        }
+        else
+        {
+            /* Get one from data link connection */
+            idx = llcp_cb.lcb.dl_idx;
+
+            for (count = 0; count < LLCP_MAX_DATA_LINK; count++)
             {
-                /* Get one from data link connection */
-                for (count = 0; count < LLCP_MAX_DATA_LINK; count++)
+                /* round robin schedule without priority  */
+                if (llcp_cb.dlcb[idx].state != LLCP_DLC_STATE_IDLE)
                 {
-                    /* round robin schedule without priority  */
-                    if (llcp_cb.dlcb[llcp_cb.lcb.dl_idx].state != LLCP_DLC_STATE_IDLE)
+                    length = llcp_dlc_get_next_pdu_length (&llcp_cb.dlcb[idx]);
+
+                    /* room for I PDU, including any reserved for RR of this data link */
+                    rr_length = llcp_dlc_get_rr_length_acked_by_i_pdu (&llcp_cb.dlcb[idx]);
+                    if (rr_length > reserved)
+                        rr_length = reserved;
+
+                    if ((length > 0) && (length + reserved - rr_length <= max_length))
                     {
                         if (length_only)
                         {
-                            *p_next_pdu_length = llcp_dlc_get_next_pdu_length (&llcp_cb.dlcb[llcp_cb.lcb.dl_idx]);
-
-                            if (*p_next_pdu_length > 0 )
-                            {
-                                /* don't change data link connection to return the same length of PDU */
-                                return NULL;
-                            }
-                            else
-                            {
-                                /* no data, so check next data link connection */
-                                llcp_cb.lcb.dl_idx = (llcp_cb.lcb.dl_idx + 1) % LLCP_MAX_DATA_LINK;
-                            }
+                            /* don't change scheduler to return the same PDU when dequeued */
+                            *p_next_pdu_length = length;
+                            return NULL;
                         }
-                        else
-                        {
-                            p_msg = llcp_dlc_get_next_pdu (&llcp_cb.dlcb[llcp_cb.lcb.dl_idx]);
 
-                            /* this data link has been served, so start from next data link next time */
-                            llcp_cb.lcb.dl_idx = (llcp_cb.lcb.dl_idx + 1) % LLCP_MAX_DATA_LINK;
+                        p_msg = llcp_dlc_get_next_pdu (&llcp_cb.dlcb[idx]);
 
-                            if (p_msg)
-                            {
-                                /* serve logical data link next time */
-                                llcp_cb.lcb.ll_served = !llcp_cb.lcb.ll_served;
-                                return p_msg;
-                            }
+                        /* this data link has been served, so start from next data link next time */
+                        if (in_turn)
+                            llcp_cb.lcb.dl_idx = (idx + 1) % LLCP_MAX_DATA_LINK;
+
+                        if (p_msg)
+                        {
+                            /* serve logical data link next time */
+                            llcp_cb.lcb.ll_served = FALSE;
+                            return p_msg;
                         }
                     }
-                    else
+                    else if (length > 0)
+                    {
+                        in_turn = FALSE;
+                    }
+                    else if (!length_only)
                     {
-                        /* check next data link connection */
-                        llcp_cb.lcb.dl_idx = (llcp_cb.lcb.dl_idx + 1) % LLCP_MAX_DATA_LINK;
+                        /* nothing to send but let data link check if tx is complete */
+                        llcp_dlc_get_next_pdu (&llcp_cb.dlcb[idx]);
                     }
                 }
 
-                /* if all of data link connection doesn't have data to send */
-                if (count >= LLCP_MAX_DATA_LINK)
+                if (in_turn)
                 {
-                    llcp_cb.lcb.ll_served = !llcp_cb.lcb.ll_served;
+                    /* no data, so start from next data link connection */
+                    llcp_cb.lcb.dl_idx = (idx + 1) % LLCP_MAX_DATA_LINK;
                 }
+
+                /* check next data link connection */
+                idx = (idx + 1) % LLCP_MAX_DATA_LINK;
             }
         }
+
+        /* nothing fits, so check the other if not checked yet */
+        llcp_cb.lcb.ll_served = !llcp_cb.lcb.ll_served;
     }
 
     /* nothing to send */
@@ -1564,6 +1878,12 @@ static BT_HDR *llcp_link_get_next_pdu (BOOLEAN length_only, UINT16 *p_next_pdu_l
 ** Description      Build a PDU from Link Manager and Data Link
 **                  Perform aggregation procedure if necessary
 **
+**                  First PDU is bounded only by link MIU of its SDU, and not
+**                  at all if it is a signalling PDU. AGF PDU is filled up to
+**                  link MIU of peer with PDUs from all of logical links and
+**                  data link connections, keeping room for RR/RNR PDU of data
+**                  link connections.
+**
 ** Returns          BT_HDR* if sent any PDU
 **
 *******************************************************************************/
@@ -1571,7 +1891,7 @@ static BT_HDR *llcp_link_build_next_pdu (BT_HDR *p_pdu)
 {
     BT_HDR *p_agf = NULL, *p_msg = NULL, *p_next_pdu;
     UINT8  *p, ptype;
-    UINT16  next_pdu_length, pdu_hdr;
+    UINT16  next_pdu_length, pdu_hdr, info_length, max_length, reserved;
 
     LLCP_TRACE_DEBUG0 ("llcp_link_build_next_pdu ()");
 
@@ -1596,10 +1916,21 @@ static BT_HDR *llcp_link_build_next_pdu (BT_HDR *p_pdu)
             p_msg = p_pdu;
         }
     }
+    else if (llcp_cb.lcb.sig_xmit_q.p_first)
+    {
+        /* signalling PDU starting a frame is sent even if it is too long to aggregate */
+        p_msg = (BT_HDR*) GKI_dequeue (&llcp_cb.lcb.sig_xmit_q);
+    }
     else
     {
-        /* Get a PDU from link manager or data links */
-        p_msg = llcp_link_get_next_pdu (FALSE, &next_pdu_length);
+        /* PDU sent alone may carry SDU up to link MIU */
+        max_length = LLCP_PDU_HEADER_SIZE + LLCP_SEQUENCE_SIZE + llcp_cb.lcb.effective_miu;
+
+        /* Get a PDU from link manager or data links, leaving room for RR/RNR PDU if possible */
+        p_msg = llcp_link_get_next_pdu (FALSE, max_length, llcp_dlc_get_rr_rnr_length (), &next_pdu_length);
+
+        if (!p_msg)
+            p_msg = llcp_link_get_next_pdu (FALSE, max_length, 0, &next_pdu_length);
 
         if (!p_msg)
         {
@@ -1607,66 +1938,68 @@ static BT_HDR *llcp_link_build_next_pdu (BT_HDR *p_pdu)
         }
     }
 
-    /* Get length of next PDU from link manager or data links without dequeue */
-    llcp_link_get_next_pdu (TRUE, &next_pdu_length);
-    while (next_pdu_length > 0)
+    while (TRUE)
     {
-        /* if it's first visit */
+        /* keep room for RR/RNR PDU to be added after this unless I PDU carries N(R) */
+        reserved = llcp_dlc_get_rr_rnr_length ();
+
+        /* length of information field of AGF PDU */
+        if (p_agf)
+            info_length = p_agf->len - LLCP_PDU_HEADER_SIZE;
+        else
+            info_length = LLCP_PDU_AGF_LEN_SIZE + p_msg->len;
+
+        if (info_length + LLCP_PDU_AGF_LEN_SIZE >= llcp_cb.lcb.effective_miu)
+            break;
+
+        max_length = llcp_cb.lcb.effective_miu - info_length - LLCP_PDU_AGF_LEN_SIZE;
+
+        /* Get length of next PDU fitting into MIU from link manager or data links without dequeue */
+        llcp_link_get_next_pdu (TRUE, max_length, reserved, &next_pdu_length);
+
+        if (next_pdu_length == 0)
+            break;
+
+        /* if it's first visit, allocate AGF PDU and copy the first PDU */
         if (!p_agf)
         {
-            /* if next PDU fits into MIU, allocate AGF PDU and copy the first PDU */
-            if (2 + p_msg->len + 2 + next_pdu_length <= llcp_cb.lcb.effective_miu)
+            p_agf = (BT_HDR*) GKI_getpoolbuf (LLCP_POOL_ID);
+            if (p_agf)
             {
-                p_agf = (BT_HDR*) GKI_getpoolbuf (LLCP_POOL_ID);
-                if (p_agf)
-                {
-                    p_agf->offset = NCI_MSG_OFFSET_SIZE + NCI_DATA_HDR_SIZE;
+                p_agf->offset = NCI_MSG_OFFSET_SIZE + NCI_DATA_HDR_SIZE;
 
-                    p = (UINT8 *) (p_agf + 1) + p_agf->offset;
+                p = (UINT8 *) (p_agf + 1) + p_agf->offset;
 
-                    UINT16_TO_BE_STREAM (p, LLCP_GET_PDU_HEADER (LLCP_SAP_LM, LLCP_PDU_AGF_TYPE, LLCP_SAP_LM ));
-                    UINT16_TO_BE_STREAM (p, p_msg->len);
-                    memcpy(p, (UINT8 *) (p_msg + 1) + p_msg->offset, p_msg->len);
+                UINT16_TO_BE_STREAM (p, LLCP_GET_PDU_HEADER (LLCP_SAP_LM, LLCP_PDU_AGF_TYPE, LLCP_SAP_LM ));
+                UINT16_TO_BE_STREAM (p, p_msg->len);
+                memcpy(p, (UINT8 *) (p_msg + 1) + p_msg->offset, p_msg->len);
 
-                    p_agf->len      = LLCP_PDU_HEADER_SIZE + 2 + p_msg->len;
+                p_agf->len      = LLCP_PDU_HEADER_SIZE + 2 + p_msg->len;
 
-                    GKI_freebuf (p_msg);
-                    p_msg = p_agf;
-                }
-                else
-                {
-                    LLCP_TRACE_ERROR0 ("llcp_link_build_next_pdu (): Out of buffer");
-                    return p_msg;
-                }
+                GKI_freebuf (p_msg);
+                p_msg = p_agf;
             }
             else
             {
-                break;
+                LLCP_TRACE_ERROR0 ("llcp_link_build_next_pdu (): Out of buffer");
+                return p_msg;
             }
         }
 
-        /* if next PDU fits into MIU, copy the next PDU into AGF */
-        if (p_agf->len - LLCP_PDU_HEADER_SIZE + 2 + next_pdu_length <= llcp_cb.lcb.effective_miu)
-        {
-            /* Get a next PDU from link manager or data links */
-            p_next_pdu = llcp_link_get_next_pdu (FALSE, &next_pdu_length);
+        /* Get a next PDU from link manager or data links */
+        p_next_pdu = llcp_link_get_next_pdu (FALSE, max_length, reserved, &next_pdu_length);
 
-            p = (UINT8 *) (p_agf + 1) + p_agf->offset + p_agf->len;
+        if (!p_next_pdu)
+            break;
 
-            UINT16_TO_BE_STREAM (p, p_next_pdu->len);
-            memcpy (p, (UINT8 *) (p_next_pdu + 1) + p_next_pdu->offset, p_next_pdu->len);
+        p = (UINT8 *) (p_agf + 1) + p_agf->offset + p_agf->len;
 
-            p_agf->len += 2 + p_next_pdu->len;
+        UINT16_TO_BE_STREAM (p, p_next_pdu->len);
+        memcpy (p, (UINT8 *) (p_next_pdu + 1) + p_next_pdu->offset, p_next_pdu->len);
 
-            GKI_freebuf (p_next_pdu);
+        p_agf->len += 2 + p_next_pdu->len;
 
-            /* Get next PDU length from link manager or data links without dequeue */
-            llcp_link_get_next_pdu (TRUE, &next_pdu_length);
-        }
-        else
-        {
-            break;
-        }
+        GKI_freebuf (p_next_pdu);
     }
 
     if (p_agf)
@@ -1691,6 +2024,9 @@ static void llcp_link_send_to_lower (BT_HDR *p_pdu)
 #endif
 
     llcp_cb.lcb.symm_state = LLCP_LINK_SYMM_REMOTE_XMIT_NEXT;
+#if (LLCP_ADAPTIVE_SYMM_DELAY == TRUE)
+    llcp_cb.lcb.hold_type  = LLCP_LINK_HOLD_NONE;
+#endif
 
     NFC_SendData (NFC_RF_CONN_ID, p_pdu);
 }
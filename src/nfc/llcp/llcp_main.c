@@ -66,6 +66,7 @@ void llcp_init (void)
     llcp_cb.lcb.symm_delay           = LLCP_DELAY_RESP_TIME;
     llcp_cb.lcb.data_link_timeout    = LLCP_DATA_LINK_CONNECTION_TOUT;
     llcp_cb.lcb.delay_first_pdu_timeout = LLCP_DELAY_TIME_TO_SEND_FIRST_PDU;
+    llcp_link_reset_resp_time ();
 
     llcp_cb.lcb.wks  = LLCP_WKS_MASK_LM;
 
@@ -129,6 +130,7 @@ void llcp_cleanup (void)
 
     nfc_stop_quick_timer (&llcp_cb.lcb.inact_timer);
     nfc_stop_quick_timer (&llcp_cb.lcb.timer);
+    nfc_stop_quick_timer (&llcp_cb.sdp_cb.timer);
 }
 
 /*******************************************************************************
@@ -167,6 +169,10 @@ void llcp_process_timeout (TIMER_LIST_ENT *p_tle)
         llcp_link_check_send_data ();
         break;
 
+    case NFC_TTYPE_LLCP_SDP:
+        llcp_sdp_proc_timeout ();
+        break;
+
     default:
         break;
     }
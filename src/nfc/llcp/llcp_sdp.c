@@ -30,6 +30,7 @@
 #include "llcp_api.h"
 #include "llcp_int.h"
 #include "llcp_defs.h"
+#include "nfc_int.h"
 
 /*******************************************************************************
 **
@@ -288,6 +289,87 @@ static tLLCP_STATUS llcp_sdp_send_sdres (UINT8 tid, UINT8 sap)
     return status;
 }
 
+/*******************************************************************************
+**
+** Function         llcp_sdp_hash_name
+**
+** Description      Hash service name
+**
+**
+** Returns          hash value
+**
+*******************************************************************************/
+static UINT16 llcp_sdp_hash_name (UINT8 *p_name, UINT8 length)
+{
+    UINT16 hash = 0;
+
+    while (length--)
+    {
+        hash = (UINT16) (hash * 31 + *p_name++);
+    }
+    return hash;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_sdp_add_service_name
+**
+** Description      Add service name of registered SAP into hash table.
+**                  SAPs in a bucket are kept in ascending order so the lowest
+**                  SAP is found first if a service name is registered twice.
+**
+**
+** Returns          void
+**
+*******************************************************************************/
+void llcp_sdp_add_service_name (UINT8 sap)
+{
+    tLLCP_APP_CB *p_app_cb = llcp_util_get_app_cb (sap);
+    UINT8        *p_next_sap;
+
+    p_app_cb->sn_len  = (UINT8) strlen ((char *) p_app_cb->p_service_name);
+    p_app_cb->sn_hash = llcp_sdp_hash_name (p_app_cb->p_service_name, p_app_cb->sn_len);
+
+    p_next_sap = &llcp_cb.sdp_cb.sn_hash_sap[p_app_cb->sn_hash % LLCP_SDP_SN_HASH_SIZE];
+
+    while ((*p_next_sap) && (*p_next_sap < sap))
+    {
+        p_next_sap = &llcp_util_get_app_cb (*p_next_sap)->next_sn_sap;
+    }
+
+    p_app_cb->next_sn_sap = *p_next_sap;
+    *p_next_sap = sap;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_sdp_remove_service_name
+**
+** Description      Remove service name of SAP from hash table
+**
+**
+** Returns          void
+**
+*******************************************************************************/
+void llcp_sdp_remove_service_name (UINT8 sap)
+{
+    tLLCP_APP_CB *p_app_cb = llcp_util_get_app_cb (sap);
+    UINT8        *p_next_sap;
+
+    p_next_sap = &llcp_cb.sdp_cb.sn_hash_sap[p_app_cb->sn_hash % LLCP_SDP_SN_HASH_SIZE];
+
+    while (*p_next_sap)
+    {
+        if (*p_next_sap == sap)
+        {
+            *p_next_sap = p_app_cb->next_sn_sap;
+            break;
+        }
+        p_next_sap = &llcp_util_get_app_cb (*p_next_sap)->next_sn_sap;
+    }
+    p_app_cb->next_sn_sap = 0;
+}
+
 /*******************************************************************************
 **
 ** Function         llcp_sdp_get_sap_by_name
@@ -301,23 +383,200 @@ static tLLCP_STATUS llcp_sdp_send_sdres (UINT8 tid, UINT8 sap)
 UINT8 llcp_sdp_get_sap_by_name (char *p_name, UINT8 length)
 {
     UINT8        sap;
+    UINT16       hash;
     tLLCP_APP_CB *p_app_cb;
 
-    for (sap = LLCP_SAP_SDP; sap <= LLCP_UPPER_BOUND_SDP_SAP; sap++)
+    hash = llcp_sdp_hash_name ((UINT8 *) p_name, length);
+    sap  = llcp_cb.sdp_cb.sn_hash_sap[hash % LLCP_SDP_SN_HASH_SIZE];
+
+    while (sap)
     {
         p_app_cb = llcp_util_get_app_cb (sap);
 
-        if (  (p_app_cb)
-            &&(p_app_cb->p_app_cback)
-            &&(strlen((char*)p_app_cb->p_service_name) == length)
-            &&(!strncmp((char*)p_app_cb->p_service_name, p_name, length))  )
+        if (  (p_app_cb->sn_hash == hash)
+            &&(p_app_cb->sn_len == length)
+            &&(!memcmp (p_app_cb->p_service_name, p_name, length))  )
         {
             return (sap);
         }
+        sap = p_app_cb->next_sn_sap;
     }
     return 0;
 }
 
+/*******************************************************************************
+**
+** Function         llcp_sdp_find_cache
+**
+** Description      Search remote service name in cache
+**
+**
+** Returns          cache entry if found
+**
+*******************************************************************************/
+static tLLCP_SDP_CACHE *llcp_sdp_find_cache (char *p_name, UINT8 length, UINT16 hash)
+{
+    UINT8           i;
+    tLLCP_SDP_CACHE *p_cache = llcp_cb.sdp_cb.cache;
+
+    for (i = 0; i < LLCP_SDP_CACHE_SIZE; i++, p_cache++)
+    {
+        if (  (p_cache->state != LLCP_SDP_CACHE_EMPTY)
+            &&(p_cache->sn_hash == hash)
+            &&(p_cache->sn_len == length)
+            &&(!memcmp (p_cache->p_sn, p_name, length))  )
+        {
+            return p_cache;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_sdp_get_cached_sap
+**
+** Description      If service name of transaction has been resolved by peer in
+**                  this link activation, report cached SAP to requester with
+**                  timer instead of sending SDREQ.
+**
+**
+** Returns          TRUE if SAP is found in cache
+**
+*******************************************************************************/
+BOOLEAN llcp_sdp_get_cached_sap (UINT8 idx, char *p_name)
+{
+    UINT16            length  = (UINT16) strlen (p_name);
+    tLLCP_SDP_TRANSAC *p_transac = &llcp_cb.sdp_cb.transac[idx];
+    tLLCP_SDP_CACHE   *p_cache;
+
+    p_transac->cache_idx  = 0;
+    p_transac->cached_sap = 0;
+
+    if (length > LLCP_MAX_SN_LEN)
+        return FALSE;
+
+    p_cache = llcp_sdp_find_cache (p_name, (UINT8) length,
+                                   llcp_sdp_hash_name ((UINT8 *) p_name, (UINT8) length));
+
+    if ((p_cache) && (p_cache->state == LLCP_SDP_CACHE_RESOLVED))
+    {
+        LLCP_TRACE_DEBUG2 ("llcp_sdp_get_cached_sap (): tid=0x%x, SAP=0x%x",
+                           p_transac->tid, p_cache->sap);
+
+        p_transac->cached_sap = p_cache->sap;
+
+        /* report after returning TID to requester */
+        nfc_start_quick_timer (&llcp_cb.sdp_cb.timer, NFC_TTYPE_LLCP_SDP, 0);
+
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_sdp_add_cache
+**
+** Description      Reserve cache entry for service name of transaction to be
+**                  filled by SDRES. Resolved entries are replaced in turn
+**                  if cache is full.
+**
+**
+** Returns          void
+**
+*******************************************************************************/
+void llcp_sdp_add_cache (UINT8 idx, char *p_name)
+{
+    UINT16          length = (UINT16) strlen (p_name);
+    UINT16          hash;
+    UINT8           i, xx;
+    tLLCP_SDP_CACHE *p_cache = NULL;
+
+    if (length > LLCP_MAX_SN_LEN)
+        return;
+
+    hash = llcp_sdp_hash_name ((UINT8 *) p_name, (UINT8) length);
+
+    /* SDREQ for the same service name is already pending */
+    if (llcp_sdp_find_cache (p_name, (UINT8) length, hash))
+        return;
+
+    for (i = 0; i < LLCP_SDP_CACHE_SIZE; i++)
+    {
+        if (llcp_cb.sdp_cb.cache[i].state == LLCP_SDP_CACHE_EMPTY)
+        {
+            p_cache = &llcp_cb.sdp_cb.cache[i];
+            break;
+        }
+    }
+
+    if (!p_cache)
+    {
+        for (i = 0; i < LLCP_SDP_CACHE_SIZE; i++)
+        {
+            xx = (UINT8) ((llcp_cb.sdp_cb.next_cache_evict + i) % LLCP_SDP_CACHE_SIZE);
+
+            if (llcp_cb.sdp_cb.cache[xx].state == LLCP_SDP_CACHE_RESOLVED)
+            {
+                p_cache = &llcp_cb.sdp_cb.cache[xx];
+                llcp_cb.sdp_cb.next_cache_evict = (UINT8) ((xx + 1) % LLCP_SDP_CACHE_SIZE);
+                GKI_freebuf (p_cache->p_sn);
+                p_cache->state = LLCP_SDP_CACHE_EMPTY;
+                break;
+            }
+        }
+
+        /* all entries are waiting for SDRES */
+        if (!p_cache)
+            return;
+    }
+
+    if ((p_cache->p_sn = (UINT8 *) GKI_getbuf ((UINT16) (length + 1))) != NULL)
+    {
+        memcpy (p_cache->p_sn, p_name, length);
+        p_cache->sn_len  = (UINT8) length;
+        p_cache->sn_hash = hash;
+        p_cache->state   = LLCP_SDP_CACHE_PENDING;
+
+        llcp_cb.sdp_cb.transac[idx].cache_idx = (UINT8) (p_cache - llcp_cb.sdp_cb.cache + 1);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         llcp_sdp_proc_timeout
+**
+** Description      Report cached SAP to requesters
+**
+**
+** Returns          void
+**
+*******************************************************************************/
+void llcp_sdp_proc_timeout (void)
+{
+    UINT8           i, tid, sap;
+    tLLCP_SDP_CBACK *p_cback;
+
+    for (i = 0; i < LLCP_MAX_SDP_TRANSAC; i++)
+    {
+        if (  (llcp_cb.sdp_cb.transac[i].p_cback)
+            &&(llcp_cb.sdp_cb.transac[i].cached_sap)  )
+        {
+            tid     = llcp_cb.sdp_cb.transac[i].tid;
+            sap     = llcp_cb.sdp_cb.transac[i].cached_sap;
+            p_cback = llcp_cb.sdp_cb.transac[i].p_cback;
+
+            llcp_cb.sdp_cb.transac[i].p_cback    = NULL;
+            llcp_cb.sdp_cb.transac[i].cached_sap = 0;
+
+            LLCP_TRACE_DEBUG2 ("llcp_sdp_proc_timeout (): tid=0x%x, SAP=0x%x", tid, sap);
+
+            (*p_cback) (tid, sap);
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         llcp_sdp_return_sap
@@ -330,7 +589,8 @@ UINT8 llcp_sdp_get_sap_by_name (char *p_name, UINT8 length)
 *******************************************************************************/
 static void llcp_sdp_return_sap (UINT8 tid, UINT8 sap)
 {
-    UINT8 i;
+    UINT8           i;
+    tLLCP_SDP_CACHE *p_cache;
 
     LLCP_TRACE_DEBUG2 ("llcp_sdp_return_sap (): tid=0x%x, SAP=0x%x", tid, sap);
 
@@ -339,6 +599,24 @@ static void llcp_sdp_return_sap (UINT8 tid, UINT8 sap)
         if (  (llcp_cb.sdp_cb.transac[i].p_cback)
             &&(llcp_cb.sdp_cb.transac[i].tid == tid)  )
         {
+            if (llcp_cb.sdp_cb.transac[i].cache_idx)
+            {
+                p_cache = &llcp_cb.sdp_cb.cache[llcp_cb.sdp_cb.transac[i].cache_idx - 1];
+                llcp_cb.sdp_cb.transac[i].cache_idx = 0;
+
+                /* cache only found services, peer may register others later */
+                if (sap)
+                {
+                    p_cache->sap   = sap;
+                    p_cache->state = LLCP_SDP_CACHE_RESOLVED;
+                }
+                else
+                {
+                    GKI_freebuf (p_cache->p_sn);
+                    p_cache->state = LLCP_SDP_CACHE_EMPTY;
+                }
+            }
+
             (*llcp_cb.sdp_cb.transac[i].p_cback) (tid, sap);
 
             llcp_cb.sdp_cb.transac[i].p_cback = NULL;
@@ -351,6 +629,7 @@ static void llcp_sdp_return_sap (UINT8 tid, UINT8 sap)
 ** Function         llcp_sdp_proc_deactivation
 **
 ** Description      Report SDP failure for any pending request because of deactivation
+**                  and clear cache of remote service names
 **
 **
 ** Returns          void
@@ -362,6 +641,8 @@ void llcp_sdp_proc_deactivation (void)
 
     LLCP_TRACE_DEBUG0 ("llcp_sdp_proc_deactivation ()");
 
+    nfc_stop_quick_timer (&llcp_cb.sdp_cb.timer);
+
     for (i = 0; i < LLCP_MAX_SDP_TRANSAC; i++)
     {
         if (llcp_cb.sdp_cb.transac[i].p_cback)
@@ -379,6 +660,16 @@ void llcp_sdp_proc_deactivation (void)
         llcp_cb.sdp_cb.p_snl = NULL;
     }
 
+    for (i = 0; i < LLCP_SDP_CACHE_SIZE; i++)
+    {
+        if (llcp_cb.sdp_cb.cache[i].state != LLCP_SDP_CACHE_EMPTY)
+        {
+            GKI_freebuf (llcp_cb.sdp_cb.cache[i].p_sn);
+            llcp_cb.sdp_cb.cache[i].state = LLCP_SDP_CACHE_EMPTY;
+        }
+    }
+    llcp_cb.sdp_cb.next_cache_evict = 0;
+
     llcp_cb.sdp_cb.next_tid = 0;
 }
 
@@ -330,6 +330,57 @@ void llcp_util_send_disc (UINT8 dsap, UINT8 ssap)
     }
 }
 
+/*******************************************************************************
+**
+** Function         llcp_util_index_data_link
+**
+** Description      Add or remove tLLCP_DLCB in index by local and remote SAP.
+**                  If more than one data link has the same SAPs, the index
+**                  keeps the active one it already has.
+**
+** Returns          void
+**
+******************************************************************************/
+static void llcp_util_index_data_link (tLLCP_DLCB *p_dlcb, BOOLEAN add)
+{
+    UINT8 *p_idx, idx, xx;
+
+    if ((p_dlcb->local_sap >= LLCP_NUM_SAPS) || (p_dlcb->remote_sap >= LLCP_NUM_SAPS))
+        return;
+
+    p_idx = &llcp_cb.dlcb_idx[p_dlcb->local_sap][p_dlcb->remote_sap];
+    idx   = (UINT8) (p_dlcb - llcp_cb.dlcb) + 1;
+
+    if (add)
+    {
+        if ((*p_idx == 0) || (llcp_cb.dlcb[*p_idx - 1].state == LLCP_DLC_STATE_IDLE))
+            *p_idx = idx;
+    }
+    else
+    {
+        if (llcp_cb.w4_cc_dlcb_idx[p_dlcb->local_sap] == idx)
+            llcp_cb.w4_cc_dlcb_idx[p_dlcb->local_sap] = 0;
+
+        if (*p_idx == idx)
+        {
+            *p_idx = 0;
+
+            /* look for another data link with the same SAPs */
+            for (xx = 0; xx < LLCP_MAX_DATA_LINK; xx++)
+            {
+                if (  (xx + 1 != idx)
+                    &&(llcp_cb.dlcb[xx].state != LLCP_DLC_STATE_IDLE)
+                    &&(llcp_cb.dlcb[xx].local_sap == p_dlcb->local_sap)
+                    &&(llcp_cb.dlcb[xx].remote_sap == p_dlcb->remote_sap)  )
+                {
+                    *p_idx = xx + 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         llcp_util_allocate_data_link
@@ -353,6 +404,7 @@ tLLCP_DLCB *llcp_util_allocate_data_link (UINT8 reg_sap, UINT8 remote_sap)
         {
             p_dlcb = &(llcp_cb.dlcb[idx]);
 
+            llcp_util_index_data_link (p_dlcb, FALSE);
             memset (p_dlcb, 0, sizeof (tLLCP_DLCB));
             break;
         }
@@ -369,6 +421,8 @@ tLLCP_DLCB *llcp_util_allocate_data_link (UINT8 reg_sap, UINT8 remote_sap)
         p_dlcb->remote_sap  = remote_sap;
         p_dlcb->timer.param = (TIMER_PARAM_TYPE) p_dlcb;
 
+        llcp_util_index_data_link (p_dlcb, TRUE);
+
         /* this is for inactivity timer and congestion control. */
         llcp_cb.num_data_link_connection++;
 
@@ -393,6 +447,8 @@ void llcp_util_deallocate_data_link (tLLCP_DLCB *p_dlcb)
     {
         LLCP_TRACE_DEBUG1 ("llcp_util_deallocate_data_link (): local_sap = 0x%x", p_dlcb->local_sap);
 
+        llcp_util_index_data_link (p_dlcb, FALSE);
+
         if (p_dlcb->state != LLCP_DLC_STATE_IDLE)
         {
             nfc_stop_quick_timer (&p_dlcb->timer);
@@ -410,6 +466,45 @@ void llcp_util_deallocate_data_link (tLLCP_DLCB *p_dlcb)
     }
 }
 
+/*******************************************************************************
+**
+** Function         llcp_util_set_data_link_remote_sap
+**
+** Description      Change remote SAP of tLLCP_DLCB, i.e. SSAP in CC
+**
+** Returns          void
+**
+******************************************************************************/
+void llcp_util_set_data_link_remote_sap (tLLCP_DLCB *p_dlcb, UINT8 remote_sap)
+{
+    UINT8 w4_cc_idx = llcp_cb.w4_cc_dlcb_idx[p_dlcb->local_sap];
+
+    llcp_util_index_data_link (p_dlcb, FALSE);
+    p_dlcb->remote_sap = remote_sap;
+    llcp_util_index_data_link (p_dlcb, TRUE);
+
+    /* the data link may still be waiting for CC */
+    llcp_cb.w4_cc_dlcb_idx[p_dlcb->local_sap] = w4_cc_idx;
+}
+
+/*******************************************************************************
+**
+** Function         llcp_util_set_data_link_w4_remote_resp
+**
+** Description      Move tLLCP_DLCB to LLCP_DLC_STATE_W4_REMOTE_RESP, so CC or
+**                  DM from any remote SAP can be matched to it
+**
+** Returns          void
+**
+******************************************************************************/
+void llcp_util_set_data_link_w4_remote_resp (tLLCP_DLCB *p_dlcb)
+{
+    p_dlcb->state = LLCP_DLC_STATE_W4_REMOTE_RESP;
+
+    if (p_dlcb->local_sap < LLCP_NUM_SAPS)
+        llcp_cb.w4_cc_dlcb_idx[p_dlcb->local_sap] = (UINT8) (p_dlcb - llcp_cb.dlcb) + 1;
+}
+
 /*******************************************************************************
 **
 ** Function         llcp_util_send_connect
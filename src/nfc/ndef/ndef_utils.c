@@ -42,12 +42,7 @@
 *******************************************************************************/
 static void shiftdown (UINT8 *p_mem, UINT32 len, UINT32 shift_amount)
 {
-    register UINT8 *ps = p_mem + len - 1;
-    register UINT8 *pd = ps + shift_amount;
-    register UINT32 xx;
-
-    for (xx = 0; xx < len; xx++)
-        *pd-- = *ps--;
+    memmove (p_mem + shift_amount, p_mem, len);
 }
 
 /*******************************************************************************
@@ -59,27 +54,99 @@ static void shiftdown (UINT8 *p_mem, UINT32 len, UINT32 shift_amount)
 *******************************************************************************/
 static void shiftup (UINT8 *p_dest, UINT8 *p_src, UINT32 len)
 {
-    register UINT8 *ps = p_src;
-    register UINT8 *pd = p_dest;
-    register UINT32 xx;
+    memmove (p_dest, p_src, len);
+}
 
-    for (xx = 0; xx < len; xx++)
-        *pd++ = *ps++;
+/*******************************************************************************
+**
+** Function         ndef_rec_size
+**
+** Description      get the encoded size of a record
+**
+*******************************************************************************/
+static UINT32 ndef_rec_size (UINT8 type_len, UINT8 id_len, UINT32 payload_len)
+{
+    return (2 + ((payload_len < 256) ? 1 : 4) + ((id_len == 0) ? 0 : 1)
+            + type_len + id_len + payload_len);
 }
 
 /*******************************************************************************
 **
-** Function         NDEF_MsgValidate
+** Function         ndef_rec_write
 **
-** Description      This function validates an NDEF message.
+** Description      encode a record at p_rec. rec_hdr holds the TNF and the
+**                  MB/ME/CF flags; SR and IL are set from the lengths.
+**                  A NULL field pointer leaves that field uninitialized.
 **
-** Returns          TRUE if all OK, or FALSE if the message is invalid.
+** Returns          pointer to the byte after the record
 **
 *******************************************************************************/
-tNDEF_STATUS NDEF_MsgValidate (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chunks)
+static UINT8 *ndef_rec_write (UINT8 *p_rec, UINT8 rec_hdr, UINT8 *p_type, UINT8 type_len,
+                              UINT8 *p_id, UINT8 id_len, UINT8 *p_payload, UINT32 payload_len)
+{
+    if (payload_len < 256)
+        rec_hdr |= NDEF_SR_MASK;
+
+    if (id_len != 0)
+        rec_hdr |= NDEF_IL_MASK;
+
+    *p_rec++ = rec_hdr;
+
+    /* The next byte is the type field length */
+    *p_rec++ = type_len;
+
+    /* Payload length - can be 1 or 4 bytes */
+    if (rec_hdr & NDEF_SR_MASK)
+        *p_rec++ = (UINT8)payload_len;
+    else
+         UINT32_TO_BE_STREAM (p_rec, payload_len);
+
+    /* ID field Length (optional) */
+    if (id_len != 0)
+        *p_rec++ = id_len;
+
+    /* Next comes the type */
+    if (type_len)
+    {
+        if (p_type)
+            memcpy (p_rec, p_type, type_len);
+
+        p_rec += type_len;
+    }
+
+    /* Next comes the ID */
+    if (id_len)
+    {
+        if (p_id)
+            memcpy (p_rec, p_id, id_len);
+
+        p_rec += id_len;
+    }
+
+    /* And lastly the payload. If NULL, the app just wants to reserve memory */
+    if (p_payload)
+        memcpy (p_rec, p_payload, payload_len);
+
+    return (p_rec + payload_len);
+}
+
+/*******************************************************************************
+**
+** Function         ndef_msg_parse
+**
+** Description      This function validates an NDEF message. If p_idx is not
+**                  NULL, the position and field lengths of each record are
+**                  stored in p_idx[], which holds up to max_recs entries.
+**
+** Returns          NDEF_OK if all OK, or the reason the message is invalid.
+**
+*******************************************************************************/
+static tNDEF_STATUS ndef_msg_parse (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chunks,
+                                    tNDEF_REC_IDX *p_idx, INT32 max_recs, INT32 *p_num_recs)
 {
     UINT8   *p_rec = p_msg;
     UINT8   *p_end = p_msg + msg_len;
+    UINT8   *p_rec_start;
     UINT8   rec_hdr=0, type_len, id_len;
     int     count;
     UINT32  payload_len;
@@ -102,6 +169,7 @@ tNDEF_STATUS NDEF_MsgValidate (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chu
         if (p_rec + 3 > p_end)
             return (NDEF_MSG_TOO_SHORT);
 
+        p_rec_start = p_rec;
         rec_hdr = *p_rec++;
 
         /* The second and all subsequent records must NOT have the MB bit set */
@@ -187,6 +255,19 @@ tNDEF_STATUS NDEF_MsgValidate (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chu
                 return (NDEF_MSG_LENGTH_MISMATCH);
         }
 
+        if (p_idx)
+        {
+            if (count >= max_recs)
+                return (NDEF_MSG_INSUFFICIENT_MEM);
+
+            p_idx[count].offset      = (UINT32) (p_rec_start - p_msg);
+            p_idx[count].payload_len = payload_len;
+            p_idx[count].rec_hdr     = rec_hdr;
+            p_idx[count].hdr_len     = (UINT8) (p_rec - p_rec_start);
+            p_idx[count].type_len    = type_len;
+            p_idx[count].id_len      = id_len;
+        }
+
         /* Point to next record */
         p_rec += (payload_len + type_len + id_len);
 
@@ -204,9 +285,98 @@ tNDEF_STATUS NDEF_MsgValidate (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chu
     if (p_rec != p_end)
         return (NDEF_MSG_LENGTH_MISMATCH);
 
+    if (p_num_recs)
+        *p_num_recs = count + 1;
+
     return (NDEF_OK);
 }
 
+/*******************************************************************************
+**
+** Function         NDEF_MsgValidate
+**
+** Description      This function validates an NDEF message.
+**
+** Returns          TRUE if all OK, or FALSE if the message is invalid.
+**
+*******************************************************************************/
+tNDEF_STATUS NDEF_MsgValidate (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chunks)
+{
+    return (ndef_msg_parse (p_msg, msg_len, b_allow_chunks, NULL, 0, NULL));
+}
+
+/*******************************************************************************
+**
+** Function         NDEF_MsgIndex
+**
+** Description      This function validates an NDEF message and fills in one
+**                  index entry per record, so records can then be accessed
+**                  in any order without parsing the message again.
+**
+** Returns          NDEF_OK if all OK, NDEF_MSG_INSUFFICIENT_MEM if the message
+**                  has more than max_recs records, or the validation error.
+**                  *p_num_recs is filled in on success.
+**
+*******************************************************************************/
+tNDEF_STATUS NDEF_MsgIndex (UINT8 *p_msg, UINT32 msg_len, BOOLEAN b_allow_chunks,
+                            tNDEF_REC_IDX *p_idx, INT32 max_recs, INT32 *p_num_recs)
+{
+    if ((p_idx == NULL) || (p_num_recs == NULL))
+        return (NDEF_MSG_INSUFFICIENT_MEM);
+
+    *p_num_recs = 0;
+    return (ndef_msg_parse (p_msg, msg_len, b_allow_chunks, p_idx, max_recs, p_num_recs));
+}
+
+/*******************************************************************************
+**
+** Function         NDEF_IdxFindRecByType
+**
+** Description      This function searches the index of an NDEF message, from
+**                  entry start onwards, for a record of the given type.
+**
+** Returns          Index of the record, or -1 if none is found
+**
+*******************************************************************************/
+INT32 NDEF_IdxFindRecByType (UINT8 *p_msg, tNDEF_REC_IDX *p_idx, INT32 num_recs, INT32 start,
+                             UINT8 tnf, UINT8 *p_type, UINT8 tlen)
+{
+    INT32   xx;
+
+    for (xx = start; xx < num_recs; xx++)
+    {
+        if (  ((p_idx[xx].rec_hdr & NDEF_TNF_MASK) == tnf)
+            &&(p_idx[xx].type_len == tlen)
+            &&(!memcmp (NDEF_IDX_TYPE (p_msg, &p_idx[xx]), p_type, tlen))  )
+            return (xx);
+    }
+    return (-1);
+}
+
+/*******************************************************************************
+**
+** Function         NDEF_IdxFindRecById
+**
+** Description      This function searches the index of an NDEF message, from
+**                  entry start onwards, for a record with the given ID.
+**
+** Returns          Index of the record, or -1 if none is found
+**
+*******************************************************************************/
+INT32 NDEF_IdxFindRecById (UINT8 *p_msg, tNDEF_REC_IDX *p_idx, INT32 num_recs, INT32 start,
+                           UINT8 *p_id, UINT8 ilen)
+{
+    INT32   xx;
+
+    for (xx = start; xx < num_recs; xx++)
+    {
+        if (  (p_idx[xx].id_len == ilen)
+            &&(!memcmp (NDEF_IDX_ID (p_msg, &p_idx[xx]), p_id, ilen))  )
+            return (xx);
+    }
+    return (-1);
+}
+
 /*******************************************************************************
 **
 ** Function         NDEF_MsgGetNumRecs
@@ -840,8 +1010,7 @@ extern tNDEF_STATUS  NDEF_MsgAddRec (UINT8 *p_msg, UINT32 max_size, UINT32 *p_cu
 {
     UINT8   *p_rec = p_msg + *p_cur_size;
     UINT32  recSize;
-    int     plen = (payload_len < 256) ? 1 : 4;
-    int     ilen = (id_len == 0) ? 0 : 1;
+    UINT8   rec_hdr;
 
     if (tnf > NDEF_TNF_RESERVED)
     {
@@ -850,14 +1019,14 @@ extern tNDEF_STATUS  NDEF_MsgAddRec (UINT8 *p_msg, UINT32 max_size, UINT32 *p_cu
     }
 
     /* First, make sure the record will fit. we need at least 2 bytes for header and type length */
-    recSize = payload_len + 2 + type_len + plen + ilen + id_len;
+    recSize = ndef_rec_size (type_len, id_len, payload_len);
 
     if ((*p_cur_size + recSize) > max_size)
         return (NDEF_MSG_INSUFFICIENT_MEM);
 
     /* Construct the record header. For the first record, set both begin and end bits */
     if (*p_cur_size == 0)
-        *p_rec = tnf | NDEF_MB_MASK | NDEF_ME_MASK;
+        rec_hdr = tnf | NDEF_MB_MASK | NDEF_ME_MASK;
     else
     {
         /* Find the previous last and clear his 'Message End' bit */
@@ -867,53 +1036,86 @@ extern tNDEF_STATUS  NDEF_MsgAddRec (UINT8 *p_msg, UINT32 max_size, UINT32 *p_cu
             return (NDEF_MSG_NO_MSG_END);
 
         *pLast &= ~NDEF_ME_MASK;
-        *p_rec   = tnf | NDEF_ME_MASK;
+        rec_hdr = tnf | NDEF_ME_MASK;
     }
 
-    if (plen == 1)
-        *p_rec |= NDEF_SR_MASK;
+    ndef_rec_write (p_rec, rec_hdr, p_type, type_len, p_id, id_len, p_payload, payload_len);
 
-    if (ilen != 0)
-        *p_rec |= NDEF_IL_MASK;
-
-    p_rec++;
-
-    /* The next byte is the type field length */
-    *p_rec++ = type_len;
+    *p_cur_size += recSize;
 
-    /* Payload length - can be 1 or 4 bytes */
-    if (plen == 1)
-        *p_rec++ = (UINT8)payload_len;
-    else
-         UINT32_TO_BE_STREAM (p_rec, payload_len);
+    return (NDEF_OK);
+}
 
-    /* ID field Length (optional) */
-    if (ilen > 0)
-        *p_rec++ = id_len;
+/*******************************************************************************
+**
+** Function         NDEF_MsgGetBuildSize
+**
+** Description      This function gets the size of the message NDEF_MsgBuild
+**                  will produce from the given record descriptors.
+**
+** Returns          The message size in bytes
+**
+*******************************************************************************/
+UINT32 NDEF_MsgGetBuildSize (tNDEF_REC_DESC *p_recs, INT32 num_recs)
+{
+    UINT32  size = 0;
+    UINT8   type_len;
+    INT32   xx;
 
-    /* Next comes the type */
-    if (type_len)
+    for (xx = 0; xx < num_recs; xx++)
     {
-        if (p_type)
-            memcpy (p_rec, p_type, type_len);
-
-        p_rec += type_len;
+        type_len = (p_recs[xx].tnf > NDEF_TNF_RESERVED) ? 0 : p_recs[xx].type_len;
+        size    += ndef_rec_size (type_len, p_recs[xx].id_len, p_recs[xx].payload_len);
     }
+    return (size);
+}
 
-    /* Next comes the ID */
-    if (id_len)
+/*******************************************************************************
+**
+** Function         NDEF_MsgBuild
+**
+** Description      This function builds an NDEF message from an array of
+**                  record descriptors in one pass. The short record format
+**                  is used where the payload allows it, and the MB and ME
+**                  flags are set on the first and last records.
+**
+** Returns          NDEF_OK if all OK, NDEF_MSG_INSUFFICIENT_MEM if the message
+**                  does not fit in max_size bytes. *p_cur_size is set to the
+**                  message size.
+**
+*******************************************************************************/
+tNDEF_STATUS NDEF_MsgBuild (UINT8 *p_msg, UINT32 max_size, UINT32 *p_cur_size,
+                            tNDEF_REC_DESC *p_recs, INT32 num_recs)
+{
+    UINT8   *p_rec = p_msg;
+    UINT8   rec_hdr, tnf, type_len;
+    INT32   xx;
+
+    if (NDEF_MsgGetBuildSize (p_recs, num_recs) > max_size)
+        return (NDEF_MSG_INSUFFICIENT_MEM);
+
+    for (xx = 0; xx < num_recs; xx++)
     {
-        if (p_id)
-            memcpy (p_rec, p_id, id_len);
+        tnf      = p_recs[xx].tnf;
+        type_len = p_recs[xx].type_len;
+        if (tnf > NDEF_TNF_RESERVED)
+        {
+            tnf      = NDEF_TNF_UNKNOWN;
+            type_len = 0;
+        }
 
-        p_rec += id_len;
-    }
+        rec_hdr = tnf;
+        if (xx == 0)
+            rec_hdr |= NDEF_MB_MASK;
+        if (xx == num_recs - 1)
+            rec_hdr |= NDEF_ME_MASK;
 
-    /* And lastly the payload. If NULL, the app just wants to reserve memory */
-    if (p_payload)
-        memcpy (p_rec, p_payload, payload_len);
+        p_rec = ndef_rec_write (p_rec, rec_hdr, p_recs[xx].p_type, type_len,
+                                p_recs[xx].p_id, p_recs[xx].id_len,
+                                p_recs[xx].p_payload, p_recs[xx].payload_len);
+    }
 
-    *p_cur_size += recSize;
+    *p_cur_size = (UINT32) (p_rec - p_msg);
 
     return (NDEF_OK);
 }
@@ -936,11 +1138,9 @@ extern tNDEF_STATUS NDEF_MsgInsertRec (UINT8 *p_msg, UINT32 max_size, UINT32 *p_
 {
     UINT8   *p_rec;
     UINT32  recSize;
-    INT32   plen = (payload_len < 256) ? 1 : 4;
-    INT32   ilen = (id_len == 0) ? 0 : 1;
 
     /* First, make sure the record will fit. we need at least 2 bytes for header and type length */
-    recSize = payload_len + 2 + type_len + plen + ilen + id_len;
+    recSize = ndef_rec_size (type_len, id_len, payload_len);
 
     if ((*p_cur_size + recSize) > max_size)
         return (NDEF_MSG_INSUFFICIENT_MEM);
@@ -961,53 +1161,8 @@ extern tNDEF_STATUS NDEF_MsgInsertRec (UINT8 *p_msg, UINT32 max_size, UINT32 *p_
     shiftdown (p_rec, (UINT32)(*p_cur_size - (p_rec - p_msg)), recSize);
 
     /* If adding at the beginning, set begin bit */
-    if (index == 0)
-        *p_rec = tnf | NDEF_MB_MASK;
-    else
-        *p_rec = tnf;
-
-    if (plen == 1)
-        *p_rec |= NDEF_SR_MASK;
-
-    if (ilen != 0)
-        *p_rec |= NDEF_IL_MASK;
-
-    p_rec++;
-
-    /* The next byte is the type field length */
-    *p_rec++ = type_len;
-
-    /* Payload length - can be 1 or 4 bytes */
-    if (plen == 1)
-        *p_rec++ = (UINT8)payload_len;
-    else
-         UINT32_TO_BE_STREAM (p_rec, payload_len);
-
-    /* ID field Length (optional) */
-    if (ilen != 0)
-        *p_rec++ = id_len;
-
-    /* Next comes the type */
-    if (type_len)
-    {
-        if (p_type)
-            memcpy (p_rec, p_type, type_len);
-
-        p_rec += type_len;
-    }
-
-    /* Next comes the ID */
-    if (ilen != 0)
-    {
-        if (p_id)
-            memcpy (p_rec, p_id, id_len);
-
-        p_rec += id_len;
-    }
-
-    /* And lastly the payload. If NULL, the app just wants to reserve memory */
-    if (p_payload)
-        memcpy (p_rec, p_payload, payload_len);
+    ndef_rec_write (p_rec, (UINT8) ((index == 0) ? (tnf | NDEF_MB_MASK) : tnf),
+                    p_type, type_len, p_id, id_len, p_payload, payload_len);
 
     *p_cur_size += recSize;
 
@@ -1568,3 +1723,107 @@ tNDEF_STATUS NDEF_MsgCopyAndDechunk (UINT8 *p_src, UINT32 src_len, UINT8 *p_dest
     return (status);
 }
 
+/*******************************************************************************
+**
+** Function         NDEF_IterInit
+**
+** Description      This function validates an NDEF message, which may contain
+**                  chunked records, and sets up an iterator over its logical
+**                  records. Nothing is copied; the message must stay valid
+**                  while the iterator is used.
+**
+** Returns          NDEF_OK if all OK, or the reason the message is invalid
+**
+*******************************************************************************/
+tNDEF_STATUS NDEF_IterInit (tNDEF_ITER *p_iter, UINT8 *p_msg, UINT32 msg_len)
+{
+    tNDEF_STATUS    status;
+
+    memset (p_iter, 0, sizeof (tNDEF_ITER));
+
+    if ((status = NDEF_MsgValidate (p_msg, msg_len, TRUE)) == NDEF_OK)
+        p_iter->p_next = p_msg;
+
+    return (status);
+}
+
+/*******************************************************************************
+**
+** Function         NDEF_IterNextRec
+**
+** Description      This function moves the iterator to the next logical record
+**                  and fills in its TNF, type, ID and total payload length.
+**
+** Returns          TRUE if a record was found, FALSE at the end of the message
+**
+*******************************************************************************/
+BOOLEAN NDEF_IterNextRec (tNDEF_ITER *p_iter)
+{
+    UINT8   *p_rec = p_iter->p_next;
+    UINT32  pay_len;
+
+    if (p_rec == NULL)
+        return (FALSE);
+
+    p_iter->p_rec       = p_rec;
+    p_iter->p_type      = NDEF_RecGetType (p_rec, &p_iter->tnf, &p_iter->type_len);
+    p_iter->p_id        = NDEF_RecGetId (p_rec, &p_iter->id_len);
+    p_iter->payload_len = 0;
+    p_iter->num_chunks  = 0;
+
+    /* Add up the payload of each chunk. The last chunk has the CF bit cleared */
+    for ( ; ; )
+    {
+        NDEF_RecGetPayload (p_rec, &pay_len);
+        p_iter->payload_len += pay_len;
+        p_iter->num_chunks++;
+
+        if ((*p_rec & NDEF_CF_MASK) == 0)
+            break;
+
+        p_rec = NDEF_MsgGetNextRec (p_rec);
+    }
+
+    p_iter->p_next = NDEF_MsgGetNextRec (p_rec);
+
+    return (TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         NDEF_IterGetPayloadSpans
+**
+** Description      This function gets the payload of the current logical record
+**                  as spans into the message, one per non-empty chunk,
+**                  skipping the first start_span spans.
+**
+** Returns          Number of spans filled in p_spans (up to max_spans)
+**
+*******************************************************************************/
+UINT16 NDEF_IterGetPayloadSpans (tNDEF_ITER *p_iter, UINT16 start_span,
+                                 tNDEF_SPAN *p_spans, UINT16 max_spans)
+{
+    UINT8   *p_rec = p_iter->p_rec;
+    UINT8   *p_pay;
+    UINT32  pay_len;
+    UINT16  xx, num_spans = 0;
+
+    for (xx = 0; (xx < p_iter->num_chunks) && (num_spans < max_spans); xx++)
+    {
+        if ((p_pay = NDEF_RecGetPayload (p_rec, &pay_len)) != NULL)
+        {
+            if (start_span)
+                start_span--;
+            else
+            {
+                p_spans[num_spans].p_data = p_pay;
+                p_spans[num_spans].len    = pay_len;
+                num_spans++;
+            }
+        }
+        p_rec = NDEF_MsgGetNextRec (p_rec);
+    }
+
+    return (num_spans);
+}
+
@@ -1459,6 +1459,113 @@ void nfc_data_event (tNFC_CONN_CB * p_cb)
     }
 }
 
+#if (NFC_CHAINED_REASSEMBLY == TRUE)
+/*******************************************************************************
+**
+** Function         nfc_ncif_proc_rx_chain
+**
+** Description      p_msg was just added to the chain of fragments at the end of
+**                  the rx queue. When the chain is complete, copy it into one
+**                  buffer. If the chain grew too big for one buffer, copy the
+**                  fragments before p_msg into one buffer to be reported with
+**                  status Continue, and start a new chain at p_msg.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void nfc_ncif_proc_rx_chain (tNFC_CONN_CB *p_cb, BT_HDR *p_msg)
+{
+    BT_HDR  *p, *p_start = NULL, *p_end, *p_next, *p_new;
+    UINT8   *ps, *pd;
+    UINT16  hdr_size, len, chain_len;
+
+    /* the chain starts after the last buffer that is not an open fragment */
+    for (p = (BT_HDR *) GKI_getfirst (&p_cb->rx_q); p != p_msg; p = (BT_HDR *) GKI_getnext (p))
+    {
+        if ((p->layer_specific & (NFC_RAS_FRAGMENTED | NFC_RAS_TOO_BIG)) == NFC_RAS_FRAGMENTED)
+        {
+            if (p_start == NULL)
+                p_start = p;
+        }
+        else
+            p_start = NULL;
+    }
+    if (p_start == NULL)
+        return;
+
+    hdr_size = BT_HDR_SIZE + p_start->offset + NCI_MSG_HDR_SIZE;
+    if (p_cb->rx_chain_len <= GKI_MAX_BUF_SIZE - hdr_size)
+    {
+        if (p_msg->layer_specific & NFC_RAS_FRAGMENTED)
+        {
+            /* wait for the last fragment */
+            return;
+        }
+        p_end       = NULL;
+        chain_len   = p_cb->rx_chain_len;
+    }
+    else
+    {
+        /* p_msg does not fit; report the data before it with status Continue */
+        p_end               = p_msg;
+        chain_len           = p_cb->rx_chain_len - (p_msg->len - NCI_MSG_HDR_SIZE);
+        p_cb->rx_chain_len  = p_msg->len - NCI_MSG_HDR_SIZE;
+    }
+
+    if (  (GKI_getnext (p_start) == p_end)
+        ||((p_new = (BT_HDR *) GKI_getbuf ((UINT16) (hdr_size + chain_len))) == NULL)  )
+    {
+        /* nothing to copy or not enough memory, report the fragments one by one */
+        for (p = p_start; p != p_end; p = (BT_HDR *) GKI_getnext (p))
+        {
+            if (p->layer_specific & NFC_RAS_FRAGMENTED)
+                p->layer_specific |= NFC_RAS_TOO_BIG;
+        }
+        return;
+    }
+
+    /* keep the NCI header of the first fragment, append the payload of the others */
+    memcpy (p_new, p_start, BT_HDR_SIZE);
+    pd          = (UINT8 *) (p_new + 1) + p_new->offset;
+    p_new->len  = 0;
+    for (p = p_start; p != p_end; p = p_next)
+    {
+        p_next  = (BT_HDR *) GKI_getnext (p);
+        ps      = (UINT8 *) (p + 1) + p->offset;
+        len     = p->len;
+        if (p != p_start)
+        {
+            ps  += NCI_MSG_HDR_SIZE;
+            len -= NCI_MSG_HDR_SIZE;
+        }
+        memcpy (pd + p_new->len, ps, len);
+        p_new->len += len;
+
+        GKI_remove_from_queue (&p_cb->rx_q, p);
+        GKI_freebuf (p);
+    }
+
+    if (p_end)
+    {
+        /* p_msg goes back behind the copied data */
+        p_new->layer_specific = NFC_RAS_FRAGMENTED | NFC_RAS_TOO_BIG;
+        GKI_remove_from_queue (&p_cb->rx_q, p_msg);
+        GKI_enqueue (&p_cb->rx_q, p_new);
+        GKI_enqueue (&p_cb->rx_q, p_msg);
+    }
+    else
+    {
+        p_new->layer_specific = 0;
+        GKI_enqueue (&p_cb->rx_q, p_new);
+#ifdef DISP_NCI
+        /* this packet was reassembled. display the complete packet */
+        DISP_NCI ((UINT8 *) (p_new + 1) + p_new->offset, p_new->len, TRUE);
+#endif
+    }
+    NFC_TRACE_DEBUG1 ("nfc_ncif_proc_rx_chain len:%d", p_new->len);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         nfc_ncif_proc_data
@@ -1476,9 +1583,11 @@ void nfc_ncif_proc_data (BT_HDR *p_msg)
     tNFC_CONN_CB * p_cb;
     UINT8   pbf;
     BT_HDR  *p_last;
+#if (NFC_CHAINED_REASSEMBLY == FALSE)
     UINT8   *ps, *pd;
     UINT16  size;
     BT_HDR  *p_max = NULL;
+#endif
     UINT16  len;
 
     pp   = (UINT8 *) (p_msg+1) + p_msg->offset;
@@ -1495,6 +1604,14 @@ void nfc_ncif_proc_data (BT_HDR *p_msg)
         p_last = (BT_HDR *)GKI_getlast (&p_cb->rx_q);
         if (p_last && (p_last->layer_specific & NFC_RAS_FRAGMENTED))
         {
+#if (NFC_CHAINED_REASSEMBLY == TRUE)
+            /* last data buffer is not last fragment, keep this new packet in its own buffer
+             * behind it. The fragments are copied together once the chain is complete. */
+            p_cb->rx_chain_len += p_msg->len - NCI_MSG_HDR_SIZE;
+            GKI_enqueue (&p_cb->rx_q, p_msg);
+            nfc_ncif_proc_rx_chain (p_cb, p_msg);
+            nfc_data_event (p_cb);
+#else
             /* last data buffer is not last fragment, append this new packet to the last */
             size = GKI_get_buf_size(p_last);
             if (size < (BT_HDR_SIZE + p_last->len + p_last->offset + len))
@@ -1557,9 +1674,13 @@ void nfc_ncif_proc_data (BT_HDR *p_msg)
                 /* now enqueue the new buffer to the rx queue */
                 GKI_enqueue (&p_cb->rx_q, p_msg);
             }
+#endif
         }
         else
         {
+#if (NFC_CHAINED_REASSEMBLY == TRUE)
+            p_cb->rx_chain_len = p_msg->len - NCI_MSG_HDR_SIZE;
+#endif
             /* if this is the first fragment on RF link */
             if (  (p_msg->layer_specific & NFC_RAS_FRAGMENTED)
                 &&(p_cb->conn_id == NFC_RF_CONN_ID)
@@ -31,6 +31,15 @@
 #include "nfc_api.h"
 #include "nfc_hal_api.h"
 #include "nfc_int.h"
+#ifdef NFC_HAL_SHARED_GKI
+#include "nfc_hal_target.h"
+
+/* HAL hands its receive buffers to NFC_TASK without copying, so it must leave
+** the room NFC_TASK reserves in front of received messages */
+#if (NFC_HAL_NCI_RX_MSG_OFFSET_SIZE != NFC_RECEIVE_MSGS_OFFSET)
+#error "NFC_HAL_NCI_RX_MSG_OFFSET_SIZE must be NFC_RECEIVE_MSGS_OFFSET with NFC_HAL_SHARED_GKI"
+#endif
+#endif
 #include "nci_hmsgs.h"
 #include "rw_int.h"
 #include "ce_int.h"
@@ -260,6 +269,7 @@ void nfc_process_quick_timer_evt (void)
         case NFC_TTYPE_LLCP_LINK_INACT:
         case NFC_TTYPE_LLCP_DATA_LINK:
         case NFC_TTYPE_LLCP_DELAY_FIRST_PDU:
+        case NFC_TTYPE_LLCP_SDP:
             llcp_process_timeout (p_tle);
             break;
 #endif
@@ -41,11 +41,16 @@ tCE_CB  ce_cb;
 *******************************************************************************/
 void ce_init (void)
 {
+    /* Release the T4T AID table of a previous initialization */
+    if (ce_cb.mem.t4t.p_reg_aid)
+        GKI_os_free (ce_cb.mem.t4t.p_reg_aid);
+
     memset (&ce_cb, 0, sizeof (tCE_CB));
     ce_cb.trace_level = NFC_INITIAL_TRACE_LEVEL;
 
     /* Initialize tag-specific fields of ce control block */
     ce_t3t_init ();
+    ce_t4t_init ();
 }
 
 /*******************************************************************************
@@ -41,6 +41,45 @@ BOOLEAN mapping_aid_test_enabled = FALSE;
 UINT8   ce_test_tag_app_id[T4T_V20_NDEF_TAG_AID_LEN] = {0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01};
 #endif
 
+/* Max number of registered AIDs; may be changed before NFC_Init () */
+UINT16 ce_t4t_max_reg_aid_cfg = CE_T4T_MAX_REG_AID;
+
+/*******************************************************************************
+**
+** Function         ce_t4t_init
+**
+** Description      Initialize tag-specific fields of ce control block
+**
+** Returns          none
+**
+*******************************************************************************/
+void ce_t4t_init (void)
+{
+    tCE_T4T_MEM *p_t4t = &ce_cb.mem.t4t;
+    UINT16      max_reg_aid = ce_t4t_max_reg_aid_cfg;
+
+    p_t4t->selected_aid_idx = CE_T4T_AID_HANDLE_INVALID;
+
+    /* handles of registered AIDs stay below the reserved ones */
+    if (max_reg_aid > CE_T4T_WILDCARD_AID_HANDLE)
+        max_reg_aid = CE_T4T_WILDCARD_AID_HANDLE;
+
+    if (max_reg_aid == 0)
+        return;
+
+    /* registered AID table, followed by the sorted handles */
+    p_t4t->p_reg_aid = (tCE_T4T_REG_AID *) GKI_os_malloc ((UINT32) max_reg_aid * (sizeof (tCE_T4T_REG_AID) + sizeof (tCE_T4T_AID_HANDLE)));
+    if (p_t4t->p_reg_aid == NULL)
+    {
+        CE_TRACE_ERROR1 ("ce_t4t_init (): unable to allocate table for %d AIDs", max_reg_aid);
+        return;
+    }
+
+    memset (p_t4t->p_reg_aid, 0, max_reg_aid * sizeof (tCE_T4T_REG_AID));
+    p_t4t->p_aid_sorted = (tCE_T4T_AID_HANDLE *) (p_t4t->p_reg_aid + max_reg_aid);
+    p_t4t->max_reg_aid  = max_reg_aid;
+}
+
 /*******************************************************************************
 **
 ** Function         ce_t4t_send_to_lower
@@ -408,6 +447,139 @@ static BOOLEAN ce_t4t_process_select_file_cmd (UINT8 *p_cmd)
     return FALSE;
 }
 
+/*******************************************************************************
+**
+** Function         ce_t4t_cmp_aid
+**
+** Description      Compare registered AID with AID in the order of
+**                  p_aid_sorted: bytewise, a prefix before longer AIDs
+**
+** Returns          <0, 0 or >0 if registered AID is before, same as or after
+**
+*******************************************************************************/
+static int ce_t4t_cmp_aid (tCE_T4T_REG_AID *p_reg, UINT8 aid_len, UINT8 *p_aid)
+{
+    int cmp;
+
+    cmp = memcmp (p_reg->aid, p_aid, (p_reg->aid_len < aid_len) ? p_reg->aid_len : aid_len);
+    if (cmp == 0)
+        cmp = (int) p_reg->aid_len - (int) aid_len;
+
+    return cmp;
+}
+
+/*******************************************************************************
+**
+** Function         ce_t4t_find_aid
+**
+** Description      Binary search of p_aid_sorted for AID
+**
+** Returns          position of the first registered AID not before AID
+**                  (num_reg_aid if none). *p_found is TRUE if it is AID.
+**
+*******************************************************************************/
+static UINT16 ce_t4t_find_aid (UINT8 aid_len, UINT8 *p_aid, BOOLEAN *p_found)
+{
+    tCE_T4T_MEM *p_t4t = &ce_cb.mem.t4t;
+    UINT16      lo = 0, hi = p_t4t->num_reg_aid, mid;
+    int         cmp;
+
+    *p_found = FALSE;
+
+    while (lo < hi)
+    {
+        mid = (UINT16) (((UINT32) lo + hi) / 2);
+        cmp = ce_t4t_cmp_aid (&p_t4t->p_reg_aid[p_t4t->p_aid_sorted[mid]], aid_len, p_aid);
+
+        if (cmp < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            if (cmp == 0)
+                *p_found = TRUE;
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*******************************************************************************
+**
+** Function         ce_t4t_find_reg_aid
+**
+** Description      Find registered AID for SELECT by name: the AID itself,
+**                  else the longest AID prefix registered for it, else
+**                  (partial selection) the first or next registered AID
+**                  starting with it, as asked by P2.
+**
+** Returns          handle of registered AID, or CE_T4T_AID_HANDLE_INVALID
+**
+*******************************************************************************/
+static tCE_T4T_AID_HANDLE ce_t4t_find_reg_aid (UINT8 p2, UINT8 aid_len, UINT8 *p_aid)
+{
+    tCE_T4T_MEM     *p_t4t = &ce_cb.mem.t4t;
+    UINT16          pos, xx;
+    BOOLEAN         found;
+    UINT8           len;
+
+    if (p_t4t->num_reg_aid == 0)
+        return CE_T4T_AID_HANDLE_INVALID;
+
+    pos = ce_t4t_find_aid (aid_len, p_aid, &found);
+    if (found)
+        return p_t4t->p_aid_sorted[pos];
+
+    /* Longest AID prefix registered for the AID */
+    if (aid_len > NFC_MAX_AID_LEN)
+        len = NFC_MAX_AID_LEN;
+    else if (aid_len > 0)
+        len = aid_len - 1;
+    else
+        len = 0;
+
+    for ( ; len > 0; len--)
+    {
+        if (p_t4t->num_prefix_aid[len])
+        {
+            xx = ce_t4t_find_aid (len, p_aid, &found);
+            if (  (found)
+                &&(p_t4t->p_reg_aid[p_t4t->p_aid_sorted[xx]].match == CE_T4T_AID_MATCH_PREFIX)  )
+            {
+                return p_t4t->p_aid_sorted[xx];
+            }
+        }
+    }
+
+#if (CE_T4T_PARTIAL_AID_SELECT == TRUE)
+    /* Partial AID: registered AIDs starting with it follow pos in p_aid_sorted */
+    if ((aid_len > 0) && (aid_len < NFC_MAX_AID_LEN))
+    {
+        tCE_T4T_REG_AID *p_reg;
+
+        if (  ((p2 & T4T_CMD_P2_OCCURRENCE_MASK) == T4T_CMD_P2_NEXT_OCCURRENCE)
+            &&(p_t4t->status & CE_T4T_STATUS_REG_AID_SELECTED)
+            &&(p_t4t->selected_aid_idx < p_t4t->max_reg_aid)  )
+        {
+            p_reg = &p_t4t->p_reg_aid[p_t4t->selected_aid_idx];
+            if ((p_reg->aid_len > aid_len) && (!memcmp (p_reg->aid, p_aid, aid_len)))
+                pos = ce_t4t_find_aid (p_reg->aid_len, p_reg->aid, &found) + 1;
+        }
+
+        if (pos < p_t4t->num_reg_aid)
+        {
+            p_reg = &p_t4t->p_reg_aid[p_t4t->p_aid_sorted[pos]];
+            if ((p_reg->aid_len > aid_len) && (!memcmp (p_reg->aid, p_aid, aid_len)))
+                return p_t4t->p_aid_sorted[pos];
+        }
+    }
+#endif
+
+    return CE_T4T_AID_HANDLE_INVALID;
+}
+
 /*******************************************************************************
 **
 ** Function         ce_t4t_process_select_app_cmd
@@ -422,11 +594,12 @@ static void ce_t4t_process_select_app_cmd (UINT8 *p_cmd, BT_HDR *p_c_apdu)
     UINT8    data_len;
     UINT16   status_words = 0x0000; /* invalid status words */
     tCE_DATA ce_data;
-    UINT8    xx;
+    UINT8    p2;
 
     CE_TRACE_DEBUG0 ("ce_t4t_process_select_app_cmd ()");
 
-    p_cmd++; /* skip P2 */
+    /* P2 Byte */
+    BE_STREAM_TO_UINT8 (p2, p_cmd);
 
     /* Lc Byte */
     BE_STREAM_TO_UINT8 (data_len, p_cmd);
@@ -450,20 +623,10 @@ static void ce_t4t_process_select_app_cmd (UINT8 *p_cmd, BT_HDR *p_c_apdu)
     ** if found, use callback of the application
     ** otherwise, return error and maintain the same status
     */
-    ce_cb.mem.t4t.selected_aid_idx = CE_T4T_MAX_REG_AID;
-    for (xx = 0; xx < CE_T4T_MAX_REG_AID; xx++)
-    {
-        if (  (ce_cb.mem.t4t.reg_aid[xx].aid_len > 0)
-            &&(ce_cb.mem.t4t.reg_aid[xx].aid_len == data_len)
-            &&(!(memcmp(ce_cb.mem.t4t.reg_aid[xx].aid, p_cmd, data_len)))  )
-        {
-            ce_cb.mem.t4t.selected_aid_idx = xx;
-            break;
-        }
-    }
+    ce_cb.mem.t4t.selected_aid_idx = ce_t4t_find_reg_aid (p2, data_len, p_cmd);
 
     /* if found matched AID */
-    if (ce_cb.mem.t4t.selected_aid_idx < CE_T4T_MAX_REG_AID)
+    if (ce_cb.mem.t4t.selected_aid_idx != CE_T4T_AID_HANDLE_INVALID)
     {
         ce_cb.mem.t4t.status &= ~ (CE_T4T_STATUS_CC_FILE_SELECTED);
         ce_cb.mem.t4t.status &= ~ (CE_T4T_STATUS_NDEF_SELECTED);
@@ -472,10 +635,10 @@ static void ce_t4t_process_select_app_cmd (UINT8 *p_cmd, BT_HDR *p_c_apdu)
         ce_cb.mem.t4t.status |= CE_T4T_STATUS_REG_AID_SELECTED;
 
         CE_TRACE_DEBUG4 ("ce_t4t_process_select_app_cmd (): Registered AID[%02X%02X%02X%02X...] is selected",
-                         ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[0],
-                         ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[1],
-                         ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[2],
-                         ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[3]);
+                         ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[0],
+                         ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[1],
+                         ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[2],
+                         ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].aid[3]);
 
         ce_data.raw_frame.status = NFC_STATUS_OK;
         ce_data.raw_frame.p_data = p_c_apdu;
@@ -483,7 +646,7 @@ static void ce_t4t_process_select_app_cmd (UINT8 *p_cmd, BT_HDR *p_c_apdu)
 
         p_c_apdu = NULL;
 
-        (*(ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].p_cback)) (CE_T4T_RAW_FRAME_EVT, &ce_data);
+        (*(ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].p_cback)) (CE_T4T_RAW_FRAME_EVT, &ce_data);
     }
     else if (  (data_len == T4T_V20_NDEF_TAG_AID_LEN)
              &&(!memcmp(p_cmd, t4t_v20_ndef_tag_aid, data_len - 1))
@@ -657,18 +820,18 @@ static void ce_t4t_data_cback (UINT8 conn_id, tNFC_CONN_EVT event, tNFC_CONN *p_
         CE_TRACE_DEBUG0 ("CET4T: Forward raw frame to registered AID");
 
         /* forward raw frame to upper layer */
-        if (ce_cb.mem.t4t.selected_aid_idx < CE_T4T_MAX_REG_AID)
+        if (ce_cb.mem.t4t.selected_aid_idx < ce_cb.mem.t4t.max_reg_aid)
         {
             ce_data.raw_frame.status = p_data->data.status;
             ce_data.raw_frame.p_data = p_c_apdu;
             ce_data.raw_frame.aid_handle = ce_cb.mem.t4t.selected_aid_idx;
             p_c_apdu = NULL;
 
-            (*(ce_cb.mem.t4t.reg_aid[ce_cb.mem.t4t.selected_aid_idx].p_cback)) (CE_T4T_RAW_FRAME_EVT, &ce_data);
+            (*(ce_cb.mem.t4t.p_reg_aid[ce_cb.mem.t4t.selected_aid_idx].p_cback)) (CE_T4T_RAW_FRAME_EVT, &ce_data);
         }
         else
         {
-            GKI_freebuf (p_c_apdu);
+            /* p_c_apdu is freed below */
             ce_t4t_send_status (T4T_RSP_NOT_FOUND);
         }
     }
@@ -929,6 +1092,72 @@ tNFC_STATUS CE_T4tSetLocalNDEFMsg (BOOLEAN    read_only,
     return NFC_STATUS_OK;
 }
 
+/*******************************************************************************
+**
+** Function         ce_t4t_register_aid
+**
+** Description      Add AID to the registered AID table
+**
+** Returns          tCE_T4T_AID_HANDLE if successful,
+**                  CE_T4T_AID_HANDLE_INVALID otherwisse
+**
+*******************************************************************************/
+static tCE_T4T_AID_HANDLE ce_t4t_register_aid (UINT8 aid_len, UINT8 *p_aid, UINT8 match, tCE_CBACK *p_cback)
+{
+    tCE_T4T_MEM *p_t4t = &ce_cb.mem.t4t;
+    UINT16      xx, pos;
+    BOOLEAN     found;
+
+    if (aid_len > NFC_MAX_AID_LEN)
+    {
+        CE_TRACE_ERROR1 ("CE_T4tRegisterAID (): AID is up to %d bytes", NFC_MAX_AID_LEN);
+        return CE_T4T_AID_HANDLE_INVALID;
+    }
+
+    if (p_cback == NULL)
+    {
+        CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): callback must be provided");
+        return CE_T4T_AID_HANDLE_INVALID;
+    }
+
+    pos = ce_t4t_find_aid (aid_len, p_aid, &found);
+    if (found)
+    {
+        CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): already registered");
+        return CE_T4T_AID_HANDLE_INVALID;
+    }
+
+    if (p_t4t->num_reg_aid >= p_t4t->max_reg_aid)
+    {
+        CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): No resource");
+        return CE_T4T_AID_HANDLE_INVALID;
+    }
+
+    for (xx = 0; xx < p_t4t->max_reg_aid; xx++)
+    {
+        if (p_t4t->p_reg_aid[xx].aid_len == 0)
+            break;
+    }
+
+    p_t4t->p_reg_aid[xx].aid_len = aid_len;
+    p_t4t->p_reg_aid[xx].match   = match;
+    p_t4t->p_reg_aid[xx].p_cback = p_cback;
+    memcpy (p_t4t->p_reg_aid[xx].aid, p_aid, aid_len);
+
+    /* keep p_aid_sorted in order */
+    memmove (&p_t4t->p_aid_sorted[pos + 1], &p_t4t->p_aid_sorted[pos],
+             (p_t4t->num_reg_aid - pos) * sizeof (tCE_T4T_AID_HANDLE));
+    p_t4t->p_aid_sorted[pos] = xx;
+    p_t4t->num_reg_aid++;
+
+    if (match == CE_T4T_AID_MATCH_PREFIX)
+        p_t4t->num_prefix_aid[aid_len]++;
+
+    CE_TRACE_DEBUG1 ("CE_T4tRegisterAID (): handle 0x%02x registered", xx);
+
+    return (xx);
+}
+
 /*******************************************************************************
 **
 ** Function         CE_T4tRegisterAID
@@ -946,7 +1175,6 @@ tNFC_STATUS CE_T4tSetLocalNDEFMsg (BOOLEAN    read_only,
 tCE_T4T_AID_HANDLE CE_T4tRegisterAID (UINT8 aid_len, UINT8 *p_aid, tCE_CBACK *p_cback)
 {
     tCE_T4T_MEM *p_t4t = &ce_cb.mem.t4t;
-    UINT8       xx;
 
     /* Handle registering callback for wildcard AID (all AIDs) */
     if (aid_len == 0)
@@ -969,50 +1197,36 @@ tCE_T4T_AID_HANDLE CE_T4tRegisterAID (UINT8 aid_len, UINT8 *p_aid, tCE_CBACK *p_
     CE_TRACE_API5 ("CE_T4tRegisterAID () AID [%02X%02X%02X%02X...], %d bytes",
                    *p_aid, *(p_aid+1), *(p_aid+2), *(p_aid+3), aid_len);
 
-    if (aid_len > NFC_MAX_AID_LEN)
-    {
-        CE_TRACE_ERROR1 ("CE_T4tRegisterAID (): AID is up to %d bytes", NFC_MAX_AID_LEN);
-        return CE_T4T_AID_HANDLE_INVALID;
-    }
-
-    if (p_cback == NULL)
-    {
-        CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): callback must be provided");
-        return CE_T4T_AID_HANDLE_INVALID;
-    }
-
-    for (xx = 0; xx < CE_T4T_MAX_REG_AID; xx++)
-    {
-        if (  (p_t4t->reg_aid[xx].aid_len == aid_len)
-            &&(!(memcmp(p_t4t->reg_aid[xx].aid, p_aid, aid_len)))  )
-        {
-            CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): already registered");
-            return CE_T4T_AID_HANDLE_INVALID;
-        }
-    }
+    return ce_t4t_register_aid (aid_len, p_aid, CE_T4T_AID_MATCH_EXACT, p_cback);
+}
 
-    for (xx = 0; xx < CE_T4T_MAX_REG_AID; xx++)
-    {
-        if (p_t4t->reg_aid[xx].aid_len == 0)
-        {
-            p_t4t->reg_aid[xx].aid_len = aid_len;
-            p_t4t->reg_aid[xx].p_cback = p_cback;
-            memcpy (p_t4t->reg_aid[xx].aid, p_aid, aid_len);
-            break;
-        }
-    }
+/*******************************************************************************
+**
+** Function         CE_T4tRegisterAIDPrefix
+**
+** Description      Register AID prefix in CE T4T. SELECT of any AID starting
+**                  with the prefix is forwarded to p_cback, unless an exact
+**                  or longer matching AID is registered.
+**
+**                  aid_len: length of AID prefix (1 to NFC_MAX_AID_LEN)
+**                  p_aid:   AID prefix
+**                  p_cback: Raw frame will be forwarded with CE_RAW_FRAME_EVT
+**
+** Returns          tCE_T4T_AID_HANDLE if successful,
+**                  CE_T4T_AID_HANDLE_INVALID otherwisse
+**
+*******************************************************************************/
+tCE_T4T_AID_HANDLE CE_T4tRegisterAIDPrefix (UINT8 aid_len, UINT8 *p_aid, tCE_CBACK *p_cback)
+{
+    CE_TRACE_API2 ("CE_T4tRegisterAIDPrefix () AID [%02X...], %d bytes", (aid_len) ? *p_aid : 0, aid_len);
 
-    if (xx >= CE_T4T_MAX_REG_AID)
+    if (aid_len == 0)
     {
-        CE_TRACE_ERROR0 ("CE_T4tRegisterAID (): No resource");
+        CE_TRACE_ERROR0 ("CE_T4tRegisterAIDPrefix (): use CE_T4tRegisterAID () for wildcard AID");
         return CE_T4T_AID_HANDLE_INVALID;
     }
-    else
-    {
-        CE_TRACE_DEBUG1 ("CE_T4tRegisterAID (): handle 0x%02x registered", xx);
-    }
 
-    return (xx);
+    return ce_t4t_register_aid (aid_len, p_aid, CE_T4T_AID_MATCH_PREFIX, p_cback);
 }
 
 /*******************************************************************************
@@ -1026,7 +1240,10 @@ tCE_T4T_AID_HANDLE CE_T4tRegisterAID (UINT8 aid_len, UINT8 *p_aid, tCE_CBACK *p_
 *******************************************************************************/
 NFC_API extern void CE_T4tDeregisterAID (tCE_T4T_AID_HANDLE aid_handle)
 {
-    tCE_T4T_MEM *p_t4t = &ce_cb.mem.t4t;
+    tCE_T4T_MEM     *p_t4t = &ce_cb.mem.t4t;
+    tCE_T4T_REG_AID *p_reg;
+    UINT16          pos;
+    BOOLEAN         found;
 
     CE_TRACE_API1 ("CE_T4tDeregisterAID () handle 0x%02x", aid_handle);
 
@@ -1045,14 +1262,28 @@ NFC_API extern void CE_T4tDeregisterAID (tCE_T4T_AID_HANDLE aid_handle)
     }
 
     /* Deregister AID */
-    if ((aid_handle >= CE_T4T_MAX_REG_AID) || (p_t4t->reg_aid[aid_handle].aid_len==0))
+    if ((aid_handle >= p_t4t->max_reg_aid) || (p_t4t->p_reg_aid[aid_handle].aid_len==0))
     {
         CE_TRACE_ERROR0 ("CE_T4tDeregisterAID (): Invalid handle");
     }
     else
     {
-        p_t4t->reg_aid[aid_handle].aid_len = 0;
-        p_t4t->reg_aid[aid_handle].p_cback = NULL;
+        p_reg = &p_t4t->p_reg_aid[aid_handle];
+
+        pos = ce_t4t_find_aid (p_reg->aid_len, p_reg->aid, &found);
+        p_t4t->num_reg_aid--;
+        memmove (&p_t4t->p_aid_sorted[pos], &p_t4t->p_aid_sorted[pos + 1],
+                 (p_t4t->num_reg_aid - pos) * sizeof (tCE_T4T_AID_HANDLE));
+
+        if (p_reg->match == CE_T4T_AID_MATCH_PREFIX)
+            p_t4t->num_prefix_aid[p_reg->aid_len]--;
+
+        p_reg->aid_len = 0;
+        p_reg->p_cback = NULL;
+
+        /* frames for the deregistered AID are no longer forwarded */
+        if (p_t4t->selected_aid_idx == aid_handle)
+            p_t4t->selected_aid_idx = CE_T4T_AID_HANDLE_INVALID;
     }
 }
 